@@ -16,7 +16,7 @@ public class KartWorld : ModuleRules
 	
 		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "Json", "IniParser", "SkyCreatorPlugin", "RealtimeMeshComponent" });
 
-		PrivateDependencyModuleNames.AddRange(new string[] {  });
+		PrivateDependencyModuleNames.AddRange(new string[] { "MeshDescription", "StaticMeshDescription", "RenderCore", "RHI" });
 
 		// DDSTextureLoader
         PublicIncludePaths.Add(Path.Combine(ThirdPartyPath, "DirextXTex/include"));
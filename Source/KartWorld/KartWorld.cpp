@@ -2,5 +2,21 @@
 
 #include "KartWorld.h"
 #include "Modules/ModuleManager.h"
+#include "Loader/TextureLoader/TextureCache.h"
 
-IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, KartWorld, "KartWorld" );
+class FKartWorldModule : public FDefaultGameModuleImpl
+{
+public:
+	virtual void StartupModule() override
+	{
+		FTextureCache::Startup();
+	}
+
+	// Before the garbage collection and the core ticker shut down
+	virtual void ShutdownModule() override
+	{
+		FTextureCache::Shutdown();
+	}
+};
+
+IMPLEMENT_PRIMARY_GAME_MODULE( FKartWorldModule, KartWorld, "KartWorld" );
@@ -0,0 +1,26 @@
+// Copyright @ 2023 Fynn Haupt
+
+
+#include "Commandlets/BakeTexturesCommandlet.h"
+#include "Loader/TextureLoader/TexturePack.h"
+
+DEFINE_LOG_CATEGORY(LogBakeTexturesCommandlet);
+
+UBakeTexturesCommandlet::UBakeTexturesCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UBakeTexturesCommandlet::Main(const FString& Params)
+{
+	FString Folder;
+	if (!FParse::Value(*Params, TEXT("Folder="), Folder) || !FPaths::DirectoryExists(Folder)) {
+		UE_LOG(LogBakeTexturesCommandlet, Error, TEXT("Usage: -run=BakeTextures -Folder=<ModFolder>"));
+		return 1;
+	}
+
+	return FTexturePack::Bake(Folder) ? 0 : 1;
+}
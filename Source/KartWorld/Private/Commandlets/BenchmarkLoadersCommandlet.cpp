@@ -0,0 +1,370 @@
+// Copyright @ 2023 Fynn Haupt
+
+
+#include "Commandlets/BenchmarkLoadersCommandlet.h"
+#include "Loader/MeshLoader.h"
+#include "Loader/MaterialLoader.h"
+#include "Loader/ModLoader/TrackLoader.h"
+#include "Loader/ModLoader/ChassiLoader.h"
+#include "Loader/ModLoader/TireLoader.h"
+#include "Loader/TextureLoader/DirectDrawSurfaceLoader.h"
+#include "Loader/TextureLoader/TextureCache.h"
+#include "Loader/MaterialFileCache.h"
+#include "Tests/SyntheticDirectDrawSurface.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonSerializer.h"
+#include "Async/Async.h"
+#include <atomic>
+
+DEFINE_LOG_CATEGORY(LogBenchmarkLoadersCommandlet);
+
+#if WITH_SYNTHETIC_FILES
+
+// Grid of quads per object, every object uses the next material
+static bool WriteSyntheticModel(const FString& FilePath, const FString& MaterialLibrary, const TArray<FString>& MaterialNames, int32 NumObjects, int32 GridSize)
+{
+	FString Model = FString::Printf(TEXT("mtllib %s\n"), *MaterialLibrary);
+	int32 FirstVertex = 1;
+	for (int32 ObjectIndex = 0; ObjectIndex < NumObjects; ObjectIndex++)
+	{
+		Model.Appendf(TEXT("o Object_%d\nusemtl %s\n"), ObjectIndex, *MaterialNames[ObjectIndex % MaterialNames.Num()]);
+
+		for (int32 Y = 0; Y <= GridSize; Y++)
+			for (int32 X = 0; X <= GridSize; X++)
+				Model.Appendf(TEXT("v %d %d %d\nvt %f %f\nvn 0 1 0\n"), ObjectIndex * GridSize + X, 0, Y, (float)X / GridSize, (float)Y / GridSize);
+
+		for (int32 Y = 0; Y < GridSize; Y++)
+		{
+			for (int32 X = 0; X < GridSize; X++)
+			{
+				int32 A = FirstVertex + Y * (GridSize + 1) + X;
+				int32 B = A + GridSize + 1;
+				Model.Appendf(TEXT("f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n"), A, A, A, B, B, B, B + 1, B + 1, B + 1, A + 1, A + 1, A + 1);
+			}
+		}
+		FirstVertex += (GridSize + 1) * (GridSize + 1);
+	}
+
+	return FFileHelper::SaveStringToFile(Model, *FilePath);
+}
+
+// Every texture gets a material file with a normal map, every material exists twice like exported duplicates
+static bool WriteSyntheticMaterials(const FString& Folder, const FString& MaterialLibrary, int32 NumTextures, int32 TextureSize, TArray<FString>& OutMaterialNames)
+{
+	const uint32 MipCount = FMath::FloorLog2(TextureSize) + 1;
+	FString Library;
+	for (int32 TextureIndex = 0; TextureIndex < NumTextures; TextureIndex++)
+	{
+		FString TextureName = FString::Printf(TEXT("Texture_%d"), TextureIndex);
+		FString TexturePath = FPaths::Combine(Folder, TEXT("Textures"), TextureName + TEXT(".dds"));
+		FString NormalPath = FPaths::Combine(Folder, TEXT("Textures"), TextureName + TEXT("_n.dds"));
+		if (!FSyntheticDirectDrawSurface::Write(TexturePath, TextureSize, TextureSize, MipCount)
+			|| !FSyntheticDirectDrawSurface::Write(NormalPath, TextureSize / 2, TextureSize / 2, MipCount - 1))
+			return false;
+
+		FString MaterialFile = FString::Printf(TEXT("{ \"Mode\": 0, \"Maps\": { \"OcclusionRoughnessMetallic\": { \"RoughnessStrength\": 0.5 }, \"Normal\": { \"Strength\": 1.0, \"Path\": \"%s_n.dds\" } } }"), *TextureName);
+		if (!FFileHelper::SaveStringToFile(MaterialFile, *FPaths::Combine(Folder, TEXT("Textures"), TextureName + TEXT(".mat"))))
+			return false;
+
+		for (const TCHAR* Suffix : { TEXT(""), TEXT(".001") })
+		{
+			FString MaterialName = FString::Printf(TEXT("Material_%d%s"), TextureIndex, Suffix);
+			Library.Appendf(TEXT("newmtl %s\nKd 1 1 1\nmap_Kd Textures/%s.dds\n\n"), *MaterialName, *TextureName);
+			OutMaterialNames.Add(MaterialName);
+		}
+	}
+
+	return FFileHelper::SaveStringToFile(Library, *FPaths::Combine(Folder, MaterialLibrary));
+}
+
+static bool WriteSyntheticMods(const FString& ModsDir, int32 Scale)
+{
+	const int32 TextureSize = 1024;
+	bool bSuccess = true;
+
+	// Track, scales with the number of objects and textures
+	FString TrackDir = FPaths::Combine(ModsDir, TEXT("Tracks"), TEXT("BenchmarkTrack"));
+	TArray<FString> TrackMaterials;
+	bSuccess &= WriteSyntheticMaterials(TrackDir, TEXT("BenchmarkTrack.mtl"), 8 * Scale, TextureSize, TrackMaterials);
+	bSuccess &= WriteSyntheticModel(FPaths::Combine(TrackDir, TEXT("BenchmarkTrack.obj")), TEXT("BenchmarkTrack.mtl"), TrackMaterials, 32 * Scale, 64);
+	bSuccess &= FFileHelper::SaveStringToFile(TEXT("[Details]\nName=BenchmarkTrack\nDescription=Synthetic\nLength=1000\nAltitude=0\nAuthor=Benchmark\n\n[Location]\nLatitude=0\nLongitude=0\nTimezone=0\nDst=false\n\n[Gfx]\nModel=BenchmarkTrack.obj\n"),
+		*FPaths::Combine(TrackDir, TEXT("BenchmarkTrack.ini")));
+
+	// Chassis
+	FString ChassiDir = FPaths::Combine(ModsDir, TEXT("Chassis"), TEXT("BenchmarkChassi"));
+	TArray<FString> ChassiMaterials;
+	bSuccess &= WriteSyntheticMaterials(ChassiDir, TEXT("BenchmarkChassi.mtl"), 2 * Scale, TextureSize, ChassiMaterials);
+	bSuccess &= WriteSyntheticModel(FPaths::Combine(ChassiDir, TEXT("BenchmarkChassi.obj")), TEXT("BenchmarkChassi.mtl"), ChassiMaterials, 16 * Scale, 32);
+	bSuccess &= FFileHelper::SaveStringToFile(TEXT("{}"), *FPaths::Combine(ChassiDir, TEXT("Linking.json")));
+	bSuccess &= FFileHelper::SaveStringToFile(TEXT("[Details]\nName=BenchmarkChassi\nDescription=Synthetic\nAuthor=Benchmark\n\n[Gfx]\nModel=BenchmarkChassi.obj\nLinking=Linking.json\n"),
+		*FPaths::Combine(ChassiDir, TEXT("BenchmarkChassi.ini")));
+
+	// Tires, four models sharing their materials
+	FString TireDir = FPaths::Combine(ModsDir, TEXT("Tires"), TEXT("BenchmarkTire"));
+	TArray<FString> TireMaterials;
+	bSuccess &= WriteSyntheticMaterials(TireDir, TEXT("BenchmarkTire.mtl"), 1, TextureSize, TireMaterials);
+	for (const TCHAR* Wheel : { TEXT("Fl"), TEXT("Fr"), TEXT("Rl"), TEXT("Rr") })
+		bSuccess &= WriteSyntheticModel(FPaths::Combine(TireDir, FString(Wheel) + TEXT(".obj")), TEXT("BenchmarkTire.mtl"), TireMaterials, 2, 32 * Scale);
+	bSuccess &= FFileHelper::SaveStringToFile(TEXT("[Details]\nName=BenchmarkTire\nDescription=Synthetic\nAuthor=Benchmark\n\n[Gfx]\nModelFl=Fl.obj\nModelFr=Fr.obj\nModelRl=Rl.obj\nModelRr=Rr.obj\n"),
+		*FPaths::Combine(TireDir, TEXT("BenchmarkTire.ini")));
+
+	return bSuccess;
+}
+
+// Loose textures like on a large track, for comparing preloaded against one by one loading
+static bool WriteSyntheticTextures(const FString& Folder, int32 NumTextures, int32 TextureSize, TArray<FString>& OutTexturePaths)
+{
+	const uint32 MipCount = FMath::FloorLog2(TextureSize) + 1;
+	for (int32 TextureIndex = 0; TextureIndex < NumTextures; TextureIndex++)
+	{
+		FString TexturePath = FPaths::Combine(Folder, FString::Printf(TEXT("Texture_%d.dds"), TextureIndex));
+		if (!FSyntheticDirectDrawSurface::Write(TexturePath, TextureSize, TextureSize, MipCount))
+			return false;
+		OutTexturePaths.Add(TexturePath);
+	}
+	return true;
+}
+
+// Cached material files live in the saved folder instead of next to the mods, so deleting the mods doesn't remove them
+static void DeleteMaterialFileCaches(const FString& ModsDir)
+{
+	TArray<FString> MaterialPaths;
+	IFileManager::Get().FindFilesRecursive(MaterialPaths, *ModsDir, TEXT("*.mat"), true, false);
+	for (const FString& MaterialPath : MaterialPaths)
+		IFileManager::Get().Delete(*FMaterialFileCache::GetCachePath(MaterialPath), false, true, true);
+}
+
+// Calls of the allocator so far, -1 when it doesn't count them (builds without stats)
+struct FAllocatorCalls
+{
+	int64 Mallocs = -1;
+	int64 Reallocs = -1;
+	int64 Frees = -1;
+};
+
+static FAllocatorCalls GetAllocatorCalls()
+{
+	FGenericMemoryStats MemoryStats;
+	GMalloc->GetAllocatorStats(MemoryStats);
+
+	FAllocatorCalls Calls;
+	for (const auto& Stat : MemoryStats.Data)
+	{
+		FString Name(Stat.Key);
+		if (Name == TEXT("Total Malloc Calls"))
+			Calls.Mallocs = (int64)Stat.Value;
+		else if (Name == TEXT("Total Realloc Calls"))
+			Calls.Reallocs = (int64)Stat.Value;
+		else if (Name == TEXT("Total Free Calls"))
+			Calls.Frees = (int64)Stat.Value;
+	}
+	return Calls;
+}
+
+static int64 GetCallDelta(int64 Start, int64 End)
+{
+	return Start < 0 || End < 0 ? -1 : End - Start;
+}
+
+#endif
+
+UBenchmarkLoadersCommandlet::UBenchmarkLoadersCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UBenchmarkLoadersCommandlet::Main(const FString& Params)
+{
+#if !WITH_SYNTHETIC_FILES
+	UE_LOG(LogBenchmarkLoadersCommandlet, Error, TEXT("Synthetic mods are only available in builds with automation tests or the editor!"));
+	return 1;
+#else
+	int32 Scale = 1;
+	int32 NumIterations = 3;
+	FString OutputPath = FPaths::Combine(FPaths::ProfilingDir(), TEXT("LoaderBenchmark.json"));
+	FParse::Value(*Params, TEXT("Scale="), Scale);
+	FParse::Value(*Params, TEXT("Iterations="), NumIterations);
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+	Scale = FMath::Max(1, Scale);
+	NumIterations = FMath::Max(1, NumIterations);
+
+	FString GameUserDir = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("KartWorld"), TEXT("Benchmark"));
+	FString ModsDir = FPaths::Combine(GameUserDir, TEXT("mods"));
+	IFileManager::Get().DeleteDirectory(*GameUserDir, false, true);
+
+	UE_LOG(LogBenchmarkLoadersCommandlet, Log, TEXT("Writing synthetic mods with scale %d to %s!"), Scale, *ModsDir);
+	if (!WriteSyntheticMods(ModsDir, Scale))
+	{
+		UE_LOG(LogBenchmarkLoadersCommandlet, Error, TEXT("Synthetic mods can't be written!"));
+		return 1;
+	}
+
+	// Material files are at the same paths as in earlier runs, their caches would make the first iteration warm
+	DeleteMaterialFileCaches(ModsDir);
+
+	TArray<FString> TextureSetPaths;
+	if (!WriteSyntheticTextures(FPaths::Combine(GameUserDir, TEXT("TextureSet")), 256 * Scale, 256, TextureSetPaths))
+	{
+		UE_LOG(LogBenchmarkLoadersCommandlet, Error, TEXT("Synthetic textures can't be written!"));
+		return 1;
+	}
+
+	TArray<TSharedPtr<FJsonValue>> StageValues;
+	bool bAllSucceeded = true;
+
+	auto RunStage = [&](int32 Iteration, const TCHAR* StageName, TFunctionRef<bool()> Stage)
+	{
+		FPlatformMemoryStats StartStats = FPlatformMemory::GetStats();
+		FAllocatorCalls StartCalls = GetAllocatorCalls();
+
+		// Process wide peak can't be reset, so the peak of the stage is sampled on its own thread
+		std::atomic<bool> bSampling { true };
+		std::atomic<uint64> PeakUsedPhysical { StartStats.UsedPhysical };
+		TFuture<void> Sampler = Async(EAsyncExecution::Thread, [&bSampling, &PeakUsedPhysical]()
+		{
+			while (bSampling)
+			{
+				uint64 UsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+				if (UsedPhysical > PeakUsedPhysical)
+					PeakUsedPhysical = UsedPhysical;
+				FPlatformProcess::Sleep(0.001f);
+			}
+		});
+
+		double StartTime = FPlatformTime::Seconds();
+		bool bSucceeded = Stage();
+		double WallTime = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+
+		bSampling = false;
+		Sampler.Wait();
+
+		FAllocatorCalls EndCalls = GetAllocatorCalls();
+		FPlatformMemoryStats EndStats = FPlatformMemory::GetStats();
+		int64 UsedBytes = (int64)EndStats.UsedPhysical - (int64)StartStats.UsedPhysical;
+		int64 PeakBytes = (int64)FMath::Max<uint64>(PeakUsedPhysical, EndStats.UsedPhysical) - (int64)StartStats.UsedPhysical;
+		int64 Allocations = GetCallDelta(StartCalls.Mallocs, EndCalls.Mallocs);
+		int64 Reallocations = GetCallDelta(StartCalls.Reallocs, EndCalls.Reallocs);
+		int64 Frees = GetCallDelta(StartCalls.Frees, EndCalls.Frees);
+		bAllSucceeded &= bSucceeded;
+
+		UE_LOG(LogBenchmarkLoadersCommandlet, Display, TEXT("%d %-10s %9.2f ms, %8.1f MB used, %8.1f MB peak, %9lld allocations, %9lld frees%s"),
+			Iteration, StageName, WallTime, UsedBytes / (1024.0 * 1024.0), PeakBytes / (1024.0 * 1024.0), Allocations, Frees, bSucceeded ? TEXT("") : TEXT(", failed!"));
+
+		TSharedRef<FJsonObject> StageObject = MakeShared<FJsonObject>();
+		StageObject->SetNumberField(TEXT("Iteration"), Iteration);
+		StageObject->SetStringField(TEXT("Stage"), StageName);
+		StageObject->SetBoolField(TEXT("Succeeded"), bSucceeded);
+		StageObject->SetNumberField(TEXT("WallTimeMs"), WallTime);
+		StageObject->SetNumberField(TEXT("UsedPhysicalBytes"), (double)UsedBytes);
+		StageObject->SetNumberField(TEXT("PeakUsedPhysicalBytes"), (double)PeakBytes);
+		StageObject->SetNumberField(TEXT("Allocations"), (double)Allocations);
+		StageObject->SetNumberField(TEXT("Reallocations"), (double)Reallocations);
+		StageObject->SetNumberField(TEXT("Frees"), (double)Frees);
+		StageValues.Add(MakeShared<FJsonValueObject>(StageObject));
+
+		// Every stage starts without loaded textures
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+		FTextureCache::Get().Trim(0);
+	};
+
+	FString TrackDir = FPaths::Combine(ModsDir, TEXT("Tracks"), TEXT("BenchmarkTrack"));
+	TArray<FString> TexturePaths;
+	IFileManager::Get().FindFilesRecursive(TexturePaths, *TrackDir, TEXT("*.dds"), true, false);
+
+	// The first iteration runs without the model and material file caches, the following ones with them
+	for (int32 Iteration = 0; Iteration < NumIterations; Iteration++)
+	{
+		RunStage(Iteration, TEXT("Textures"), [&]()
+		{
+			UDirectDrawSurfaceLoader* Loader = NewObject<UDirectDrawSurfaceLoader>();
+			bool bSucceeded = true;
+			for (const FString& TexturePath : TexturePaths)
+				bSucceeded &= Loader->LoadTexture(TexturePath) == EErrorCode_OK;
+			return bSucceeded;
+		});
+
+		// Same textures through the cache, one by one and preloaded in parallel
+		RunStage(Iteration, TEXT("Acquire"), [&]()
+		{
+			UObject* Owner = NewObject<UDirectDrawSurfaceLoader>();
+			bool bSucceeded = true;
+			for (const FString& TexturePath : TextureSetPaths)
+				bSucceeded &= FTextureCache::Get().Acquire(TexturePath, Owner) != nullptr;
+			return bSucceeded;
+		});
+
+		RunStage(Iteration, TEXT("Preload"), [&]()
+		{
+			UObject* Owner = NewObject<UDirectDrawSurfaceLoader>();
+			FTextureCache::Get().Preload(TextureSetPaths);
+			bool bSucceeded = true;
+			for (const FString& TexturePath : TextureSetPaths)
+				bSucceeded &= FTextureCache::Get().Acquire(TexturePath, Owner) != nullptr;
+			FTextureCache::Get().ReleasePreloaded();
+			return bSucceeded;
+		});
+
+		FModelData TrackModelData;
+		RunStage(Iteration, TEXT("Mesh"), [&]()
+		{
+			return NewObject<UMeshLoader>()->LoadWorld(FPaths::Combine(TrackDir, TEXT("BenchmarkTrack.obj")), TrackModelData) == EMeshLoadingResult_OK;
+		});
+
+		RunStage(Iteration, TEXT("Materials"), [&]()
+		{
+			UMaterialLoader* MaterialLoader = NewObject<UMaterialLoader>();
+			MaterialLoader->LoadMaterials(TrackDir, TrackModelData.MaterialReferences);
+			return MaterialLoader->bSuccess;
+		});
+
+		RunStage(Iteration, TEXT("Track"), [&]()
+		{
+			UTrackLoader* TrackLoader = NewObject<UTrackLoader>();
+			TrackLoader->Initialize(GameUserDir);
+			return TrackLoader->Load(TEXT("BenchmarkTrack")).bSuccess;
+		});
+
+		RunStage(Iteration, TEXT("Chassi"), [&]()
+		{
+			UChassiLoader* ChassiLoader = NewObject<UChassiLoader>();
+			ChassiLoader->Initialize(GameUserDir);
+			return ChassiLoader->Load(TEXT("BenchmarkChassi")).bSuccess;
+		});
+
+		RunStage(Iteration, TEXT("Tire"), [&]()
+		{
+			UTireLoader* TireLoader = NewObject<UTireLoader>();
+			TireLoader->Initialize(GameUserDir);
+			return TireLoader->Load(TEXT("BenchmarkTire")).bSuccess;
+		});
+	}
+
+	FPlatformMemoryStats MemoryStats = FPlatformMemory::GetStats();
+
+	TSharedRef<FJsonObject> JsonObject = MakeShared<FJsonObject>();
+	JsonObject->SetNumberField(TEXT("Scale"), Scale);
+	JsonObject->SetNumberField(TEXT("Iterations"), NumIterations);
+	JsonObject->SetNumberField(TEXT("PeakUsedPhysical"), (double)MemoryStats.PeakUsedPhysical);
+	JsonObject->SetArrayField(TEXT("Stages"), StageValues);
+
+	FString JsonString;
+	TSharedRef<TJsonWriter<TCHAR>> JsonWriter = TJsonWriterFactory<TCHAR>::Create(&JsonString);
+	if (!FJsonSerializer::Serialize(JsonObject, JsonWriter) || !FFileHelper::SaveStringToFile(JsonString, *OutputPath))
+	{
+		UE_LOG(LogBenchmarkLoadersCommandlet, Error, TEXT("%s - Results can't be written!"), *OutputPath);
+		return 1;
+	}
+	UE_LOG(LogBenchmarkLoadersCommandlet, Log, TEXT("%s - Results were written!"), *OutputPath);
+
+	if (!FParse::Param(*Params, TEXT("KeepFiles")))
+	{
+		DeleteMaterialFileCaches(ModsDir);
+		IFileManager::Get().DeleteDirectory(*GameUserDir, false, true);
+	}
+
+	return bAllSucceeded ? 0 : 1;
+#endif
+}
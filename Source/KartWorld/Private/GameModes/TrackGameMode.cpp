@@ -20,21 +20,34 @@ void ATrackGameMode::StartPlay()
 	TimeComponent->RegisterComponent();
 	SkyCreator->AddInstanceComponent(TimeComponent);
 
-	// Setup track
+	// Setup track, it gets loaded in background so the game thread isn't blocked
 	TrackMesh = World->SpawnActor<ATrackMesh>();
 	TrackMesh->TrackName = "ForestFynn";
-	TrackMesh->LoadMesh();
+	TrackMesh->OnLoaded.AddDynamic(this, &ATrackGameMode::OnTrackLoaded);
+	TrackMesh->OnLoadFailed.AddDynamic(this, &ATrackGameMode::OnTrackLoadFailed);
+	TrackMesh->LoadMeshAsync();
+
+	// Setup chassi
+	ChassiMesh = World->SpawnActor<AChassiMesh>();
+	ChassiMesh->ChassiName = "OTK-DD2";
+	ChassiMesh->TireName = "MOJO-D5";
+	ChassiMesh->LoadMesh();
+}
+
+void ATrackGameMode::OnTrackLoaded(ATrackMesh* LoadedTrackMesh)
+{
+	if (SkyCreator == nullptr) return;
 
 	// Setup location
-	FTrackConfiguration TrackConfiguration = TrackMesh->GetConfiguration();
+	FTrackConfiguration TrackConfiguration = LoadedTrackMesh->GetConfiguration();
 	SkyCreator->SetLatitude(TrackConfiguration.Latitude);
 	SkyCreator->SetLongitude(TrackConfiguration.Longitude);
 	SkyCreator->SetTimeZone(TrackConfiguration.Timezone);
 	SkyCreator->SetbDaylightSavingTime(TrackConfiguration.bDst);
+}
 
-	// Setup chassi
-	ChassiMesh = World->SpawnActor<AChassiMesh>();
-	ChassiMesh->ChassiName = "OTK-DD2";
-	ChassiMesh->TireName = "MOJO-D5";
-	ChassiMesh->LoadMesh();
+void ATrackGameMode::OnTrackLoadFailed(ATrackMesh* FailedTrackMesh, TEnumAsByte<EMeshLoadingResult> Result)
+{
+	// Track stays empty, the weather and sky keep their defaults
+	UE_LOG(LogTrackMesh, Error, TEXT("%s - Track failed to load with result %d!"), *FailedTrackMesh->TrackName, (int32)Result.GetValue());
 }
@@ -0,0 +1,62 @@
+// Copyright @ 2023 Fynn Haupt
+
+#include "Loader/LoadSummary.h"
+
+DEFINE_LOG_CATEGORY(LogLoadSummary);
+
+DEFINE_STAT(STAT_KartWorldLoad_Ini);
+DEFINE_STAT(STAT_KartWorldLoad_Link);
+DEFINE_STAT(STAT_KartWorldLoad_ModelCache);
+DEFINE_STAT(STAT_KartWorldLoad_Assimp);
+DEFINE_STAT(STAT_KartWorldLoad_Lod);
+DEFINE_STAT(STAT_KartWorldLoad_Convert);
+DEFINE_STAT(STAT_KartWorldLoad_MaterialFiles);
+DEFINE_STAT(STAT_KartWorldLoad_Textures);
+DEFINE_STAT(STAT_KartWorldLoad_Materials);
+
+FLoadStage& FLoadSummary::FindOrAddStage(const FString& Name)
+{
+	for (FLoadStage& Stage : Stages)
+		if (Stage.Name == Name)
+			return Stage;
+
+	FLoadStage& Stage = Stages.AddDefaulted_GetRef();
+	Stage.Name = Name;
+	return Stage;
+}
+
+void FLoadSummary::AddTime(const FString& Name, double Milliseconds)
+{
+	FLoadStage& Stage = FindOrAddStage(Name);
+	Stage.Milliseconds += (float)Milliseconds;
+	Stage.Count++;
+}
+
+void FLoadSummary::AddBytes(const FString& Name, int64 Bytes)
+{
+	FindOrAddStage(Name).Bytes += Bytes;
+}
+
+void FLoadSummary::Append(const FLoadSummary& Other)
+{
+	for (const FLoadStage& OtherStage : Other.Stages)
+	{
+		FLoadStage& Stage = FindOrAddStage(OtherStage.Name);
+		Stage.Milliseconds += OtherStage.Milliseconds;
+		Stage.Count += OtherStage.Count;
+		Stage.Bytes += OtherStage.Bytes;
+	}
+}
+
+void FLoadSummary::Log(const FString& Name) const
+{
+	FString StagesString;
+	for (const FLoadStage& Stage : Stages)
+	{
+		StagesString.Appendf(TEXT(", %s %.2f ms"), *Stage.Name, Stage.Milliseconds);
+		if (Stage.Bytes > 0)
+			StagesString.Appendf(TEXT(" (%.1f MB)"), Stage.Bytes / (1024.0 * 1024.0));
+	}
+
+	UE_LOG(LogLoadSummary, Log, TEXT("%s - %.2f ms%s"), *Name, TotalMilliseconds, *StagesString);
+}
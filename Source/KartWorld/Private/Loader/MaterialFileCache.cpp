@@ -0,0 +1,244 @@
+// Copyright @ 2023 Fynn Haupt
+
+#include "Loader/MaterialFileCache.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+DEFINE_LOG_CATEGORY(LogMaterialFileCache);
+
+static TAutoConsoleVariable<int32> CVarMaterialFileCacheUseCache(
+	TEXT("kw.MaterialFileCache.UseCache"),
+	1,
+	TEXT("Whether parsed material files are written to and read from the .kwmat cache in the saved folder."),
+	ECVF_Default);
+
+FCriticalSection FMaterialFileCache::EntriesLock;
+TMap<FString, FMaterialFileCache::FEntry> FMaterialFileCache::Entries;
+
+FString FMaterialFileCache::GetCachePath(const FString& MaterialPath)
+{
+	FString FullPath = FPaths::ConvertRelativePathToFull(MaterialPath);
+	FPaths::NormalizeFilename(FullPath);
+	FString FileName = FPaths::GetBaseFilename(FullPath) + TEXT("_") + FMD5::HashAnsiString(*FullPath.ToLower()) + TEXT(".kwmat");
+	return FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("KartWorld"), TEXT("MaterialFileCache"), FileName);
+}
+
+TSharedPtr<const FMaterialFile, ESPMode::ThreadSafe> FMaterialFileCache::Get(const FString& MaterialPath)
+{
+	FFileStatData StatData = IFileManager::Get().GetStatData(*MaterialPath);
+	if (!StatData.bIsValid)
+		return nullptr;
+
+	{
+		FScopeLock Lock(&EntriesLock);
+		const FEntry* Entry = Entries.Find(MaterialPath);
+		if (Entry != nullptr && Entry->Size == StatData.FileSize && Entry->Timestamp == StatData.ModificationTime)
+			return Entry->MaterialFile;
+	}
+
+	TSharedPtr<FMaterialFile, ESPMode::ThreadSafe> MaterialFile = MakeShared<FMaterialFile, ESPMode::ThreadSafe>();
+	bool bUseCache = CVarMaterialFileCacheUseCache.GetValueOnAnyThread() != 0;
+	FMD5Hash RefreshHash;
+	if (!bUseCache || !Load(MaterialPath, StatData, *MaterialFile, RefreshHash)) {
+		if (Parse(MaterialPath, *MaterialFile)) {
+			if (bUseCache)
+				Save(MaterialPath, StatData, FMD5Hash::HashFile(*MaterialPath), *MaterialFile);
+		}
+		else
+			MaterialFile.Reset();
+	}
+	else if (RefreshHash.IsValid()) {
+		// Content is unchanged, the new timestamp saves hashing it next time
+		Save(MaterialPath, StatData, RefreshHash, *MaterialFile);
+	}
+
+	if (MaterialFile.IsValid())
+		ResolvePaths(MaterialPath, *MaterialFile);
+
+	// Failed files are remembered as well, so their errors are only reported once
+	FScopeLock Lock(&EntriesLock);
+	Entries.Add(MaterialPath, { StatData.FileSize, StatData.ModificationTime, MaterialFile });
+	return MaterialFile;
+}
+
+void FMaterialFileCache::ResolvePaths(const FString& MaterialPath, FMaterialFile& MaterialFile)
+{
+	// Maps are relative to the material file
+	FString MaterialFolder = FPaths::GetPath(MaterialPath);
+	for (FMaterialFileMap* Map : { &MaterialFile.OcclusionRoughnessMetallic, &MaterialFile.SpecGloss, &MaterialFile.Normal, &MaterialFile.Emissive })
+		if (!Map->Path.IsEmpty())
+			Map->ResolvedPath = UMaterialLoader::ResolveTexturePath(Map->Path, MaterialFolder);
+}
+
+static void ReadScalar(const FString& MaterialPath, const FString& FieldName, const TSharedPtr<FJsonValue>& Value, TOptional<float>& OutScalar)
+{
+	double Number;
+	if (Value->TryGetNumber(Number))
+		OutScalar = (float)Number;
+	else
+		UE_LOG(LogMaterialFileCache, Warning, TEXT("%s - %s is not a number!"), *MaterialPath, *FieldName);
+}
+
+static void ReadMap(const FString& MaterialPath, const FString& MapName, const TSharedPtr<FJsonValue>& Value, FMaterialFileMap& OutMap, const TMap<FString, TOptional<float>*>& Scalars)
+{
+	const TSharedPtr<FJsonObject>* MapObject;
+	if (!Value->TryGetObject(MapObject)) {
+		UE_LOG(LogMaterialFileCache, Warning, TEXT("%s - %s is not an object!"), *MaterialPath, *MapName);
+		return;
+	}
+
+	OutMap.bIsSet = true;
+	for (const TPair<FString, TSharedPtr<FJsonValue>>& Field : (*MapObject)->Values) {
+		FString FieldName = MapName + TEXT(".") + Field.Key;
+
+		if (Field.Key == TEXT("Path")) {
+			if (!Field.Value->TryGetString(OutMap.Path))
+				UE_LOG(LogMaterialFileCache, Warning, TEXT("%s - %s is not a string!"), *MaterialPath, *FieldName);
+		}
+		else if (TOptional<float>* const* Scalar = Scalars.Find(Field.Key))
+			ReadScalar(MaterialPath, FieldName, Field.Value, **Scalar);
+		else
+			UE_LOG(LogMaterialFileCache, Warning, TEXT("%s - Unknown field %s!"), *MaterialPath, *FieldName);
+	}
+}
+
+bool FMaterialFileCache::Parse(const FString& MaterialPath, FMaterialFile& MaterialFile)
+{
+	FString MaterialFileContent;
+	TSharedPtr<FJsonObject> JsonObject;
+	if (!FFileHelper::LoadFileToString(MaterialFileContent, *MaterialPath)
+		|| !FJsonSerializer::Deserialize(TJsonReaderFactory<TCHAR>::Create(MaterialFileContent), JsonObject) || !JsonObject.IsValid())
+	{
+		UE_LOG(LogMaterialFileCache, Error, TEXT("%s - Material file can't be read!"), *MaterialPath);
+		return false;
+	}
+
+	// Unknown modes fall back to metal roughness
+	if (TSharedPtr<FJsonValue> ModeValue = JsonObject->TryGetField(TEXT("Mode"))) {
+		int32 Mode = 0;
+		if (ModeValue->TryGetNumber(Mode) && Mode >= EMaterialBase_MetalRoughness && Mode <= EMaterialBase_SpecGloss_Tiling)
+			MaterialFile.MaterialBase = (EMaterialBase)Mode;
+		else
+			UE_LOG(LogMaterialFileCache, Warning, TEXT("%s - Unknown mode, using MetalRoughness!"), *MaterialPath);
+	}
+
+	const TSharedPtr<FJsonObject>* MapsObject;
+	if (!JsonObject->TryGetObjectField(TEXT("Maps"), MapsObject)) {
+		if (JsonObject->HasField(TEXT("Maps")))
+			UE_LOG(LogMaterialFileCache, Warning, TEXT("%s - Maps is not an object!"), *MaterialPath);
+		return true;
+	}
+	MaterialFile.bHasMaps = true;
+
+	bool bIsTiling = MaterialFile.MaterialBase == EMaterialBase_MetalRoughness_Tiling || MaterialFile.MaterialBase == EMaterialBase_SpecGloss_Tiling;
+	bool bIsSpecGloss = MaterialFile.MaterialBase == EMaterialBase_SpecGloss || MaterialFile.MaterialBase == EMaterialBase_SpecGloss_Tiling;
+
+	for (const TPair<FString, TSharedPtr<FJsonValue>>& Map : (*MapsObject)->Values) {
+		if (bIsTiling && Map.Key == TEXT("TilingScale"))
+			ReadScalar(MaterialPath, Map.Key, Map.Value, MaterialFile.TilingScale);
+		else if (bIsTiling && Map.Key == TEXT("TilingVariation"))
+			ReadScalar(MaterialPath, Map.Key, Map.Value, MaterialFile.TilingVariation);
+		else if (!bIsSpecGloss && Map.Key == TEXT("OcclusionRoughnessMetallic"))
+			ReadMap(MaterialPath, Map.Key, Map.Value, MaterialFile.OcclusionRoughnessMetallic, {
+				{ TEXT("OcclusionStrength"), &MaterialFile.OcclusionStrength },
+				{ TEXT("RoughnessStrength"), &MaterialFile.RoughnessStrength },
+				{ TEXT("MetallicStrength"), &MaterialFile.MetallicStrength } });
+		else if (bIsSpecGloss && Map.Key == TEXT("SpecGloss"))
+			ReadMap(MaterialPath, Map.Key, Map.Value, MaterialFile.SpecGloss, {
+				{ TEXT("SpecStrength"), &MaterialFile.SpecStrength },
+				{ TEXT("GlossStrength"), &MaterialFile.GlossStrength } });
+		else if (Map.Key == TEXT("Normal"))
+			ReadMap(MaterialPath, Map.Key, Map.Value, MaterialFile.Normal, { { TEXT("Strength"), &MaterialFile.NormalStrength } });
+		else if (!bIsSpecGloss && Map.Key == TEXT("Emissive"))
+			ReadMap(MaterialPath, Map.Key, Map.Value, MaterialFile.Emissive, { { TEXT("Strength"), &MaterialFile.EmissiveStrength } });
+		else
+			UE_LOG(LogMaterialFileCache, Warning, TEXT("%s - %s is not used by this mode!"), *MaterialPath, *Map.Key);
+	}
+
+	return true;
+}
+
+bool FMaterialFileCache::Load(const FString& MaterialPath, const FFileStatData& StatData, FMaterialFile& MaterialFile, FMD5Hash& OutRefreshHash)
+{
+	FString CachePath = GetCachePath(MaterialPath);
+
+	TArray<uint8> CacheArray;
+	if (!FFileHelper::LoadFileToArray(CacheArray, *CachePath, FILEREAD_Silent))
+		return false;
+
+	FMemoryReader Reader(CacheArray);
+
+	uint32 CacheMagic = 0;
+	uint32 CacheVersion = 0;
+	int64 CacheSize = 0;
+	FDateTime CacheTimestamp;
+	FMD5Hash CacheHash;
+	Reader << CacheMagic;
+	Reader << CacheVersion;
+	Reader << CacheSize;
+	Reader << CacheTimestamp;
+	Reader << CacheHash;
+
+	if (Reader.IsError() || CacheMagic != Magic || CacheVersion != Version || CacheSize != StatData.FileSize)
+	{
+		UE_LOG(LogMaterialFileCache, Log, TEXT("%s - Cache is outdated!"), *CachePath);
+		return false;
+	}
+
+	// Modification time can change without the content changing (eg. copied mods), so compare the hash in that case
+	if (CacheTimestamp != StatData.ModificationTime)
+	{
+		FMD5Hash Hash = FMD5Hash::HashFile(*MaterialPath);
+		if (CacheHash != Hash)
+		{
+			UE_LOG(LogMaterialFileCache, Log, TEXT("%s - Cache is outdated!"), *CachePath);
+			return false;
+		}
+		OutRefreshHash = Hash;
+	}
+
+	Reader << MaterialFile;
+
+	if (Reader.IsError())
+	{
+		UE_LOG(LogMaterialFileCache, Warning, TEXT("%s - Cache is corrupt!"), *CachePath);
+		MaterialFile = FMaterialFile();
+		OutRefreshHash = FMD5Hash();
+		return false;
+	}
+
+	return true;
+}
+
+bool FMaterialFileCache::Save(const FString& MaterialPath, const FFileStatData& StatData, const FMD5Hash& Hash, FMaterialFile& MaterialFile)
+{
+	FString CachePath = GetCachePath(MaterialPath);
+
+	TArray<uint8> CacheArray;
+	FMemoryWriter Writer(CacheArray);
+
+	uint32 CacheMagic = Magic;
+	uint32 CacheVersion = Version;
+	int64 CacheSize = StatData.FileSize;
+	FDateTime CacheTimestamp = StatData.ModificationTime;
+	FMD5Hash CacheHash = Hash;
+	Writer << CacheMagic;
+	Writer << CacheVersion;
+	Writer << CacheSize;
+	Writer << CacheTimestamp;
+	Writer << CacheHash;
+	Writer << MaterialFile;
+
+	// Write to a temporary file first, so a concurrent load never sees a half written cache
+	FString TempPath = FPaths::CreateTempFilename(*FPaths::GetPath(CachePath), *FPaths::GetCleanFilename(CachePath), TEXT(".tmp"));
+	if (!FFileHelper::SaveArrayToFile(CacheArray, *TempPath) || !IFileManager::Get().Move(*CachePath, *TempPath))
+	{
+		UE_LOG(LogMaterialFileCache, Warning, TEXT("%s - Cache can't be written!"), *CachePath);
+		IFileManager::Get().Delete(*TempPath);
+		return false;
+	}
+
+	return true;
+}
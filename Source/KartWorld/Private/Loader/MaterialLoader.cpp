@@ -2,8 +2,9 @@
 
 
 #include "Loader/MaterialLoader.h"
+#include "Loader/TextureLoader/TextureCache.h"
 #include "Kismet/KismetMaterialLibrary.h"
-#include "Serialization/JsonReader.h"
+#include "Loader/MaterialFileCache.h"
 
 DEFINE_LOG_CATEGORY(LogMaterialLoader);
 
@@ -30,515 +31,384 @@ UMaterialLoader::UMaterialLoader()
 	BaseSpecGlossTiling = (UMaterialInstance*)BaseSpecGlossTilingFinder.Object;
 }
 
+TArray<FMaterialReference> UMaterialLoader::GetMaterialReferences(const aiScene* Scene)
+{
+	TArray<FMaterialReference> MaterialReferences;
+	MaterialReferences.SetNum((int32)Scene->mNumMaterials);
+
+	for (int32 MaterialIndex = 0; MaterialIndex < MaterialReferences.Num(); MaterialIndex++) {
+		aiMaterial* Material = Scene->mMaterials[MaterialIndex];
+		FMaterialReference& MaterialReference = MaterialReferences[MaterialIndex];
+		MaterialReference.Name = FString(UTF8_TO_TCHAR(Material->GetName().C_Str()));
+
+		if (Material->GetTextureCount(aiTextureType_DIFFUSE) == 0)
+			continue;
+
+		// Get diffuse texture path
+		aiString MatkeyResult;
+		Material->Get(AI_MATKEY_TEXTURE(aiTextureType_DIFFUSE, 0), MatkeyResult);
+		MaterialReference.DiffusePath = FString(UTF8_TO_TCHAR(MatkeyResult.C_Str()));
+	}
+
+	return MaterialReferences;
+}
+
+FString UMaterialLoader::ResolveTexturePath(FString Path, const FString& FolderPath)
+{
+	if (!FPaths::FileExists(Path))
+		Path = FPaths::Combine(FolderPath, Path);
+	FPaths::MakePlatformFilename(Path);
+	FPaths::CollapseRelativeDirectories(Path);
+	return Path;
+}
+
+void FMaterialFile::GetTexturePaths(TArray<FString>& OutPaths) const
+{
+	for (const FMaterialFileMap* Map : { &OcclusionRoughnessMetallic, &SpecGloss, &Normal, &Emissive })
+		if (!Map->ResolvedPath.IsEmpty())
+			OutPaths.Add(Map->ResolvedPath);
+}
+
+FString FMaterialFile::GetParameterKey() const
+{
+	auto ScalarKey = [](const TOptional<float>& Scalar) {
+		return Scalar.IsSet() ? FString::Printf(TEXT("%.9g"), Scalar.GetValue()) : FString(TEXT("-"));
+	};
+	auto MapKey = [](const FMaterialFileMap& Map) {
+		return Map.bIsSet ? TEXT("+") + Map.ResolvedPath : FString(TEXT("-"));
+	};
+
+	return FString::Join(TArray<FString>{
+		FString::FromInt(MaterialBase), bHasMaps ? TEXT("1") : TEXT("0"),
+		ScalarKey(TilingScale), ScalarKey(TilingVariation),
+		MapKey(OcclusionRoughnessMetallic), ScalarKey(OcclusionStrength), ScalarKey(RoughnessStrength), ScalarKey(MetallicStrength),
+		MapKey(SpecGloss), ScalarKey(SpecStrength), ScalarKey(GlossStrength),
+		MapKey(Normal), ScalarKey(NormalStrength),
+		MapKey(Emissive), ScalarKey(EmissiveStrength)
+	}, TEXT("|"));
+}
+
 TArray<UMaterialInstanceDynamic*> UMaterialLoader::LoadMaterials(FString FolderPath, const aiScene* Scene)
+{
+	return LoadMaterials(FolderPath, GetMaterialReferences(Scene));
+}
+
+TArray<UMaterialInstanceDynamic*> UMaterialLoader::LoadMaterials(FString FolderPath, const TArray<FMaterialReference>& MaterialReferences)
 {
 	// Reset
 	Materials.Empty();
+	LoadSummary = FLoadSummary();
 	bSuccess = false;
 
+	if (!HasBaseMaterials())
+		return Materials;
+
+	FMaterialPreload Preload;
+	PrepareMaterials(FolderPath, MaterialReferences, Preload, LoadSummary);
+
+	// Read all textures in parallel, the materials below only pick them up from the cache
+	int32 NumLoadedTextures;
+	{
+		SCOPE_LOAD_STAGE(LoadSummary, Textures);
+		int64 ResidentBytes = FTextureCache::Get().GetStats().ResidentBytes;
+		NumLoadedTextures = FTextureCache::Get().Preload(Preload.TexturePaths);
+		LoadSummary.AddBytes(TEXT("Textures"), FMath::Max<int64>(0, FTextureCache::Get().GetStats().ResidentBytes - ResidentBytes));
+	}
+
+	return CreateMaterials(MaterialReferences, Preload, NumLoadedTextures);
+}
+
+bool UMaterialLoader::HasBaseMaterials() const
+{
 	if (BaseMetalRoughness == nullptr || BaseSpecGloss == nullptr) {
 		UE_LOG(LogMaterialLoader, Error, TEXT("Base materials are missing!"));
-		return Materials;
+		return false;
 	}
+	return true;
+}
 
-	// Setup array length
-	NumMaterials = (int32)Scene->mNumMaterials;
-	Materials.SetNum(NumMaterials);
+void UMaterialLoader::PrepareMaterials(FString FolderPath, const TArray<FMaterialReference>& MaterialReferences, FMaterialPreload& Preload, FLoadSummary& Summary)
+{
+	Preload.StartTime = FPlatformTime::Seconds();
 
-	for (int32 MaterialIndex = 0; MaterialIndex < NumMaterials; MaterialIndex++) {
-		aiMaterial* Material = Scene->mMaterials[MaterialIndex];
+	// Materials without a material file only get their diffuse texture
+	TSharedPtr<const FMaterialFile, ESPMode::ThreadSafe> DefaultMaterialFile = MakeShared<FMaterialFile, ESPMode::ThreadSafe>();
+
+	// Collect materials and the textures they need
+	SCOPE_LOAD_STAGE(Summary, MaterialFiles);
+	for (int32 MaterialIndex = 0; MaterialIndex < MaterialReferences.Num(); MaterialIndex++) {
+		const FMaterialReference& Material = MaterialReferences[MaterialIndex];
 
-		if (Material->GetTextureCount(aiTextureType_DIFFUSE) == 0) {
-			UE_LOG(LogMaterialLoader, Warning, TEXT("%s - Has no diffuse texture!"), *FString(Material->GetName().C_Str()));
+		if (Material.DiffusePath.IsEmpty()) {
+			UE_LOG(LogMaterialLoader, Warning, TEXT("%s - Has no diffuse texture!"), *Material.Name);
 			continue;
 		}
 
 		// Get diffuse texture path
-		aiString MatkeyResult;
-		Material->Get(AI_MATKEY_TEXTURE(aiTextureType_DIFFUSE, 0), MatkeyResult);
-		FString TexturePath(MatkeyResult.C_Str());
-		if (!FPaths::FileExists(TexturePath))
-			TexturePath = FPaths::Combine(FolderPath, TexturePath);
-		FPaths::MakePlatformFilename(TexturePath);
-		FPaths::CollapseRelativeDirectories(TexturePath);
+		FString TexturePath = ResolveTexturePath(Material.DiffusePath, FolderPath);
 
 		if (!FPaths::FileExists(TexturePath)) {
-			UE_LOG(LogMaterialLoader, Warning, TEXT("%s - Diffuse texture can't be found!"), *FString(Material->GetName().C_Str()));
+			UE_LOG(LogMaterialLoader, Warning, TEXT("%s - Diffuse texture can't be found!"), *Material.Name);
 			continue;
 		}
 
-		// Split path to get material file path
-		FString TextureFolder;
-		FString TextureName;
-		FString TextureExtension;
-		FPaths::Split(TexturePath, TextureFolder, TextureName, TextureExtension);
-
-		FString MaterialFileName(TextureName + ".mat");
-		FString MaterialFilePath = FPaths::Combine(TextureFolder, MaterialFileName);
+		// Material file is named after the diffuse texture
+		FString MaterialFilePath = FPaths::ChangeExtension(TexturePath, TEXT("mat"));
 
-		EMaterialBase UsedMaterialBase = EMaterialBase_MetalRoughness;
-		TSharedPtr<FJsonObject> JsonObject = MakeShareable(new FJsonObject);
+		TSharedPtr<const FMaterialFile, ESPMode::ThreadSafe> MaterialFile = DefaultMaterialFile;
 		if (FPaths::FileExists(MaterialFilePath)) {
-			// Load Json
-			FString MaterialFileContent;
-			FFileHelper::LoadFileToString(MaterialFileContent, *MaterialFilePath);
-			TSharedRef<TJsonReader<TCHAR>> JsonReader = TJsonReaderFactory<TCHAR>::Create(MaterialFileContent);
-			FJsonSerializer::Deserialize(JsonReader, JsonObject);
-
-			if (!JsonObject.IsValid()) {
-				UE_LOG(LogMaterialLoader, Error, TEXT("%s - Material file can't be read!"), *FString(Material->GetName().C_Str()));
+			// Parsed once per file, errors are reported by the cache
+			MaterialFile = FMaterialFileCache::Get(MaterialFilePath);
+			if (!MaterialFile.IsValid())
 				continue;
-			}
-
-			// Change to used material base
-			if (JsonObject->TryGetField("Mode") != nullptr) {
-				int32 Mode = JsonObject->GetIntegerField("Mode");
-
-				switch (Mode) {
-				case EMaterialBase_SpecGloss:
-					UsedMaterialBase = EMaterialBase_SpecGloss;
-					break;
-				case EMaterialBase_MetalRoughness_Tiling:
-					UsedMaterialBase = EMaterialBase_MetalRoughness_Tiling;
-					break;
-				case EMaterialBase_SpecGloss_Tiling:
-					UsedMaterialBase = EMaterialBase_SpecGloss_Tiling;
-					break;
-				}
-			}
 		}
-		
+
+		// Maps are relative to the diffuse texture
+		Preload.TexturePaths.Add(TexturePath);
+		MaterialFile->GetTexturePaths(Preload.TexturePaths);
+
+		// Exported duplicates like Mat.001 end up with the same key
+		FString ParameterKey = TexturePath + TEXT("|") + MaterialFile->GetParameterKey();
+
+		Preload.Requests.Add({ MaterialIndex, TexturePath, MaterialFile, ParameterKey });
+	}
+}
+
+TArray<UMaterialInstanceDynamic*> UMaterialLoader::CreateMaterials(const TArray<FMaterialReference>& MaterialReferences, const FMaterialPreload& Preload, int32 NumLoadedTextures)
+{
+	check(IsInGameThread());
+
+	Materials.Empty();
+	bSuccess = false;
+
+	if (!HasBaseMaterials())
+		return Materials;
+
+	// Setup array length
+	NumMaterials = MaterialReferences.Num();
+	Materials.SetNum(NumMaterials);
+
+	// One material instance per unique parameter key
+	SCOPE_LOAD_STAGE(LoadSummary, Materials);
+	TMap<FString, UMaterialInstanceDynamic*> UniqueMaterials;
+	for (const FMaterialRequest& Request : Preload.Requests) {
+		const FMaterialReference& Material = MaterialReferences[Request.MaterialIndex];
+
+		if (UMaterialInstanceDynamic** SharedInstance = UniqueMaterials.Find(Request.ParameterKey)) {
+			Materials[Request.MaterialIndex] = *SharedInstance;
+			continue;
+		}
+
 		// Generate Material
 		UMaterialInstanceDynamic* MaterialInstance;
-		switch (UsedMaterialBase) {
+		switch (Request.MaterialFile->MaterialBase) {
 			case EMaterialBase_SpecGloss:
-				MaterialInstance = GenerateSpecGlossMaterial(TexturePath, Material, JsonObject);
+				MaterialInstance = GenerateSpecGlossMaterial(Request.TexturePath, Material.Name, *Request.MaterialFile);
 				break;
 			case EMaterialBase_MetalRoughness_Tiling:
-				MaterialInstance = GenerateMetalRoughnessTilingMaterial(TexturePath, Material, JsonObject);
+				MaterialInstance = GenerateMetalRoughnessTilingMaterial(Request.TexturePath, Material.Name, *Request.MaterialFile);
 				break;
 			case EMaterialBase_SpecGloss_Tiling:
-				MaterialInstance = GenerateSpecGlossTilingMaterial(TexturePath, Material, JsonObject);
+				MaterialInstance = GenerateSpecGlossTilingMaterial(Request.TexturePath, Material.Name, *Request.MaterialFile);
 				break;
 			default: 
-				MaterialInstance = GenerateMetalRoughnessMaterial(TexturePath, Material, JsonObject);
+				MaterialInstance = GenerateMetalRoughnessMaterial(Request.TexturePath, Material.Name, *Request.MaterialFile);
 				break;
 		}
 	
 		// Set Material Instance
-		Materials[MaterialIndex] = MaterialInstance;
+		Materials[Request.MaterialIndex] = MaterialInstance;
+		UniqueMaterials.Add(Request.ParameterKey, MaterialInstance);
 	}
 
+	// Textures are owned by the materials now
+	FTextureCache::Get().ReleasePreloaded();
+
+	UE_LOG(LogMaterialLoader, Log, TEXT("Loaded %d materials as %d unique instances with %d texture references (%d newly loaded) in %.2f ms"),
+		Preload.Requests.Num(), UniqueMaterials.Num(), Preload.TexturePaths.Num(), NumLoadedTextures, (FPlatformTime::Seconds() - Preload.StartTime) * 1000.0);
+
 	// Loading was successful
 	bSuccess = true;
 	return Materials;
 }
 
-UMaterialInstanceDynamic* UMaterialLoader::GenerateMetalRoughnessMaterial(FString BaseColorPath, aiMaterial* Material, TSharedPtr<FJsonObject> JsonObject)
+void UMaterialLoader::SetScalarParameter(UMaterialInstanceDynamic* MaterialInstance, FName Name, const TOptional<float>& Value)
+{
+	if (Value.IsSet())
+		MaterialInstance->SetScalarParameterValue(Name, Value.GetValue());
+}
+
+void UMaterialLoader::SetTextureParameter(UMaterialInstanceDynamic* MaterialInstance, const FString& MaterialName, FName Name, const FMaterialFileMap& Map)
 {
-	// Split path to get base color file path
-	FString TextureFolder;
-	FString TextureName;
-	FString TextureExtension;
-	FPaths::Split(BaseColorPath, TextureFolder, TextureName, TextureExtension);
+	if (Map.ResolvedPath.IsEmpty())
+		return;
 
+	if (UTexture* Texture = FTextureCache::Get().Acquire(Map.ResolvedPath, MaterialInstance, MaterialName))
+		MaterialInstance->SetTextureParameterValue(Name, Texture);
+}
+
+UMaterialInstanceDynamic* UMaterialLoader::GenerateMetalRoughnessMaterial(FString BaseColorPath, const FString& MaterialName, const FMaterialFile& MaterialFile)
+{
 	UMaterialInstanceDynamic* MaterialInstance = UKismetMaterialLibrary::CreateDynamicMaterialInstance(GetWorld(), BaseMetalRoughness);
-	UDirectDrawSurfaceLoader* DirectDrawSurfaceLoader = NewObject<UDirectDrawSurfaceLoader>();
 
 	// BaseColor
-	EErrorCode Error = DirectDrawSurfaceLoader->LoadTexture(BaseColorPath);
-	if (Error == EErrorCode_OK)
-		MaterialInstance->SetTextureParameterValue("BaseColor", DirectDrawSurfaceLoader->TextureArray[0]);
+	UTexture* BaseColor = FTextureCache::Get().Acquire(BaseColorPath, MaterialInstance, MaterialName);
+	if (BaseColor != nullptr)
+		MaterialInstance->SetTextureParameterValue("BaseColor", BaseColor);
 
-	if (!JsonObject.IsValid() || JsonObject->TryGetField("Maps") == nullptr) {
-		if (Error == EErrorCode_OK) {
-			UE_LOG(LogMaterialLoader, Warning, TEXT("%s - Maps section missing in material file, therefore only adding base color!"), *FString(Material->GetName().C_Str()));
+	if (!MaterialFile.bHasMaps) {
+		if (BaseColor != nullptr) {
+			UE_LOG(LogMaterialLoader, Warning, TEXT("%s - Maps section missing in material file, therefore only adding base color!"), *MaterialName);
 			return MaterialInstance;
 		}
 		else {
-			UE_LOG(LogMaterialLoader, Error, TEXT("%s - Maps section missing in material file, but no base color was found!"), *FString(Material->GetName().C_Str()));
+			UE_LOG(LogMaterialLoader, Error, TEXT("%s - Maps section missing in material file, but no base color was found!"), *MaterialName);
 			return nullptr;
 		}
 	}
 
-	TSharedPtr<FJsonObject> MapsObject = JsonObject->GetObjectField("Maps");
-
 	// OcclusionRoughnessMetallic
-	if (MapsObject->TryGetField("OcclusionRoughnessMetallic") != nullptr) {
-		TSharedPtr<FJsonObject> OcclusionRoughnessMetallicObject = MapsObject->GetObjectField("OcclusionRoughnessMetallic");
-
-		if (OcclusionRoughnessMetallicObject->TryGetField("OcclusionStrength") != nullptr) {
-			float OcclusionStrength = (float)OcclusionRoughnessMetallicObject->GetNumberField("OcclusionStrength");
-			MaterialInstance->SetScalarParameterValue("OcclusionStrength", OcclusionStrength);
-		}
-
-		if (OcclusionRoughnessMetallicObject->TryGetField("RoughnessStrength") != nullptr) {
-			float RoughnessStrength = (float)OcclusionRoughnessMetallicObject->GetNumberField("RoughnessStrength");
-			MaterialInstance->SetScalarParameterValue("RoughnessStrength", RoughnessStrength);
-		}
-
-		if (OcclusionRoughnessMetallicObject->TryGetField("MetallicStrength") != nullptr) {
-			float MetallicStrength = (float)OcclusionRoughnessMetallicObject->GetNumberField("MetallicStrength");
-			MaterialInstance->SetScalarParameterValue("MetallicStrength", MetallicStrength);
-		}
-
-		if (OcclusionRoughnessMetallicObject->TryGetField("Path") != nullptr) {
-			FString Path = OcclusionRoughnessMetallicObject->GetStringField("Path");
-			if (!FPaths::FileExists(Path))
-				Path = FPaths::Combine(TextureFolder, Path);
-			FPaths::MakePlatformFilename(Path);
-			FPaths::CollapseRelativeDirectories(Path);
-			Error = DirectDrawSurfaceLoader->LoadTexture(Path);
-			if (Error == EErrorCode_OK)
-				MaterialInstance->SetTextureParameterValue("OcclusionRoughnessMetallic", DirectDrawSurfaceLoader->TextureArray[0]);
-		}
+	if (MaterialFile.OcclusionRoughnessMetallic.bIsSet) {
+		SetScalarParameter(MaterialInstance, "OcclusionStrength", MaterialFile.OcclusionStrength);
+		SetScalarParameter(MaterialInstance, "RoughnessStrength", MaterialFile.RoughnessStrength);
+		SetScalarParameter(MaterialInstance, "MetallicStrength", MaterialFile.MetallicStrength);
+		SetTextureParameter(MaterialInstance, MaterialName, "OcclusionRoughnessMetallic", MaterialFile.OcclusionRoughnessMetallic);
 	}
 
 	// Normal
-	if (MapsObject->TryGetField("Normal") != nullptr) {
-		TSharedPtr<FJsonObject> NormalObject = MapsObject->GetObjectField("Normal");
-
-		if (NormalObject->TryGetField("Strength") != nullptr) {
-			float Strength = (float)NormalObject->GetNumberField("Strength");
-			MaterialInstance->SetScalarParameterValue("NormalStrength", Strength);
-		}
-
-		if (NormalObject->TryGetField("Path") != nullptr) {
-			FString Path = NormalObject->GetStringField("Path");
-			if (!FPaths::FileExists(Path))
-				Path = FPaths::Combine(TextureFolder, Path);
-			FPaths::MakePlatformFilename(Path);
-			FPaths::CollapseRelativeDirectories(Path);
-			Error = DirectDrawSurfaceLoader->LoadTexture(Path);
-			if (Error == EErrorCode_OK)
-				MaterialInstance->SetTextureParameterValue("Normal", DirectDrawSurfaceLoader->TextureArray[0]);
-		}
+	if (MaterialFile.Normal.bIsSet) {
+		SetScalarParameter(MaterialInstance, "NormalStrength", MaterialFile.NormalStrength);
+		SetTextureParameter(MaterialInstance, MaterialName, "Normal", MaterialFile.Normal);
 	}
 
-	// Emissive
-	if (MapsObject->TryGetField("Emissive") != nullptr) {
-		TSharedPtr<FJsonObject> EmissiveObject = MapsObject->GetObjectField("Emissive");
-
-		if (EmissiveObject->TryGetField("Strength") != nullptr) {
-			float Strength = (float)EmissiveObject->GetNumberField("Strength");
-			MaterialInstance->SetScalarParameterValue("EmissiveStrength", Strength);
-		}
-		else {
-			MaterialInstance->SetScalarParameterValue("UseAmbientOcclusion", 1.0);
-		}
-
-		if (EmissiveObject->TryGetField("Path") != nullptr) {
-			FString Path = EmissiveObject->GetStringField("Path");
-			if (!FPaths::FileExists(Path))
-				Path = FPaths::Combine(TextureFolder, Path);
-			FPaths::MakePlatformFilename(Path);
-			FPaths::CollapseRelativeDirectories(Path);
-			Error = DirectDrawSurfaceLoader->LoadTexture(Path);
-			if (Error == EErrorCode_OK)
-				MaterialInstance->SetTextureParameterValue("Emissive", DirectDrawSurfaceLoader->TextureArray[0]);
-		} 
-		else {
-			MaterialInstance->SetScalarParameterValue("UseAmbientOcclusion", 1.0);
-		}
-	}
-	else {
+	// Emissive, ambient occlusion is used unless both strength and texture are given
+	SetScalarParameter(MaterialInstance, "EmissiveStrength", MaterialFile.EmissiveStrength);
+	SetTextureParameter(MaterialInstance, MaterialName, "Emissive", MaterialFile.Emissive);
+	if (!MaterialFile.EmissiveStrength.IsSet() || MaterialFile.Emissive.ResolvedPath.IsEmpty())
 		MaterialInstance->SetScalarParameterValue("UseAmbientOcclusion", 1.0);
-	}
 	
 	return MaterialInstance;
 }
 
-UMaterialInstanceDynamic* UMaterialLoader::GenerateSpecGlossMaterial(FString DiffusePath, aiMaterial* Material, TSharedPtr<FJsonObject> JsonObject)
+UMaterialInstanceDynamic* UMaterialLoader::GenerateSpecGlossMaterial(FString DiffusePath, const FString& MaterialName, const FMaterialFile& MaterialFile)
 {
-	// Split path to get base color file path
-	FString TextureFolder;
-	FString TextureName;
-	FString TextureExtension;
-	FPaths::Split(DiffusePath, TextureFolder, TextureName, TextureExtension);
-
 	UMaterialInstanceDynamic* MaterialInstance = UKismetMaterialLibrary::CreateDynamicMaterialInstance(GetWorld(), BaseSpecGloss);
-	UDirectDrawSurfaceLoader* DirectDrawSurfaceLoader = NewObject<UDirectDrawSurfaceLoader>();
 
 	// Diffuse
-	EErrorCode Error = DirectDrawSurfaceLoader->LoadTexture(DiffusePath);
-	if (Error == EErrorCode_OK)
-		MaterialInstance->SetTextureParameterValue("Diffuse", DirectDrawSurfaceLoader->TextureArray[0]);
+	UTexture* Diffuse = FTextureCache::Get().Acquire(DiffusePath, MaterialInstance, MaterialName);
+	if (Diffuse != nullptr)
+		MaterialInstance->SetTextureParameterValue("Diffuse", Diffuse);
 
-	if (!JsonObject.IsValid() || JsonObject->TryGetField("Maps") == nullptr) {
-		if (Error == EErrorCode_OK) {
-			UE_LOG(LogMaterialLoader, Warning, TEXT("%s - Maps section missing in material file, therefore only adding diffuse!"), *FString(Material->GetName().C_Str()));
+	if (!MaterialFile.bHasMaps) {
+		if (Diffuse != nullptr) {
+			UE_LOG(LogMaterialLoader, Warning, TEXT("%s - Maps section missing in material file, therefore only adding diffuse!"), *MaterialName);
 			return MaterialInstance;
 		}
 		else {
-			UE_LOG(LogMaterialLoader, Error, TEXT("%s - Maps section missing in material file, but no diffuse was found!"), *FString(Material->GetName().C_Str()));
+			UE_LOG(LogMaterialLoader, Error, TEXT("%s - Maps section missing in material file, but no diffuse was found!"), *MaterialName);
 			return nullptr;
 		}
 	}
 
-	TSharedPtr<FJsonObject> MapsObject = JsonObject->GetObjectField("Maps");
-
 	// SpecGloss
-	if (MapsObject->TryGetField("SpecGloss") != nullptr) {
-		TSharedPtr<FJsonObject> SpecGlossObject = MapsObject->GetObjectField("SpecGloss");
-
-		if (SpecGlossObject->TryGetField("SpecStrength") != nullptr) {
-			float SpecStrength = (float)SpecGlossObject->GetNumberField("SpecStrength");
-			MaterialInstance->SetScalarParameterValue("SpecStrength", SpecStrength);
-		}
-
-		if (SpecGlossObject->TryGetField("GlossStrength") != nullptr) {
-			float GlossStrength = (float)SpecGlossObject->GetNumberField("GlossStrength");
-			MaterialInstance->SetScalarParameterValue("GlossStrength", GlossStrength);
-		}
-
-		if (SpecGlossObject->TryGetField("Path") != nullptr) {
-			FString Path = SpecGlossObject->GetStringField("Path");
-			if (!FPaths::FileExists(Path))
-				Path = FPaths::Combine(TextureFolder, Path);
-			FPaths::MakePlatformFilename(Path);
-			FPaths::CollapseRelativeDirectories(Path);
-			Error = DirectDrawSurfaceLoader->LoadTexture(Path);
-			if (Error == EErrorCode_OK)
-				MaterialInstance->SetTextureParameterValue("SpecGloss", DirectDrawSurfaceLoader->TextureArray[0]);
-		}
+	if (MaterialFile.SpecGloss.bIsSet) {
+		SetScalarParameter(MaterialInstance, "SpecStrength", MaterialFile.SpecStrength);
+		SetScalarParameter(MaterialInstance, "GlossStrength", MaterialFile.GlossStrength);
+		SetTextureParameter(MaterialInstance, MaterialName, "SpecGloss", MaterialFile.SpecGloss);
 	}
 
 	// Normal
-	if (MapsObject->TryGetField("Normal") != nullptr) {
-		TSharedPtr<FJsonObject> NormalObject = MapsObject->GetObjectField("Normal");
-
-		if (NormalObject->TryGetField("Strength") != nullptr) {
-			float Strength = (float)NormalObject->GetNumberField("Strength");
-			MaterialInstance->SetScalarParameterValue("NormalStrength", Strength);
-		}
-
-		if (NormalObject->TryGetField("Path") != nullptr) {
-			FString Path = NormalObject->GetStringField("Path");
-			if (!FPaths::FileExists(Path))
-				Path = FPaths::Combine(TextureFolder, Path);
-			FPaths::MakePlatformFilename(Path);
-			FPaths::CollapseRelativeDirectories(Path);
-			Error = DirectDrawSurfaceLoader->LoadTexture(Path);
-			if (Error == EErrorCode_OK)
-				MaterialInstance->SetTextureParameterValue("Normal", DirectDrawSurfaceLoader->TextureArray[0]);
-		}
+	if (MaterialFile.Normal.bIsSet) {
+		SetScalarParameter(MaterialInstance, "NormalStrength", MaterialFile.NormalStrength);
+		SetTextureParameter(MaterialInstance, MaterialName, "Normal", MaterialFile.Normal);
 	}
 
 	return MaterialInstance;
 }
 
-UMaterialInstanceDynamic* UMaterialLoader::GenerateMetalRoughnessTilingMaterial(FString BaseColorPath, aiMaterial* Material, TSharedPtr<FJsonObject> JsonObject)
+UMaterialInstanceDynamic* UMaterialLoader::GenerateMetalRoughnessTilingMaterial(FString BaseColorPath, const FString& MaterialName, const FMaterialFile& MaterialFile)
 {
-	// Split path to get base color file path
-	FString TextureFolder;
-	FString TextureName;
-	FString TextureExtension;
-	FPaths::Split(BaseColorPath, TextureFolder, TextureName, TextureExtension);
-
 	UMaterialInstanceDynamic* MaterialInstance = UKismetMaterialLibrary::CreateDynamicMaterialInstance(GetWorld(), BaseMetalRoughnessTiling);
-	UDirectDrawSurfaceLoader* DirectDrawSurfaceLoader = NewObject<UDirectDrawSurfaceLoader>();
 
 	// BaseColor
-	EErrorCode Error = DirectDrawSurfaceLoader->LoadTexture(BaseColorPath);
-	if (Error == EErrorCode_OK)
-		MaterialInstance->SetTextureParameterValue("BaseColor", DirectDrawSurfaceLoader->TextureArray[0]);
+	UTexture* BaseColor = FTextureCache::Get().Acquire(BaseColorPath, MaterialInstance, MaterialName);
+	if (BaseColor != nullptr)
+		MaterialInstance->SetTextureParameterValue("BaseColor", BaseColor);
 
-	if (!JsonObject.IsValid() || JsonObject->TryGetField("Maps") == nullptr) {
-		if (Error == EErrorCode_OK) {
-			UE_LOG(LogMaterialLoader, Warning, TEXT("%s - Maps section missing in material file, therefore only adding base color!"), *FString(Material->GetName().C_Str()));
+	if (!MaterialFile.bHasMaps) {
+		if (BaseColor != nullptr) {
+			UE_LOG(LogMaterialLoader, Warning, TEXT("%s - Maps section missing in material file, therefore only adding base color!"), *MaterialName);
 			return MaterialInstance;
 		}
 		else {
-			UE_LOG(LogMaterialLoader, Error, TEXT("%s - Maps section missing in material file, but no base color was found!"), *FString(Material->GetName().C_Str()));
+			UE_LOG(LogMaterialLoader, Error, TEXT("%s - Maps section missing in material file, but no base color was found!"), *MaterialName);
 			return nullptr;
 		}
 	}
 
-	TSharedPtr<FJsonObject> MapsObject = JsonObject->GetObjectField("Maps");
-
-	// TilingScale
-	if (MapsObject->TryGetField("TilingScale") != nullptr) {
-		float TilingScale = (float)MapsObject->GetNumberField("TilingScale");
-		MaterialInstance->SetScalarParameterValue("TilingScale", TilingScale);
-	}
-
-	// TilingVariation
-	if (MapsObject->TryGetField("TilingVariation") != nullptr) {
-		float TilingVariation = (float)MapsObject->GetNumberField("TilingVariation");
-		MaterialInstance->SetScalarParameterValue("TilingVariation", TilingVariation);
-	}
+	// Tiling
+	SetScalarParameter(MaterialInstance, "TilingScale", MaterialFile.TilingScale);
+	SetScalarParameter(MaterialInstance, "TilingVariation", MaterialFile.TilingVariation);
 
 	// OcclusionRoughnessMetallic
-	if (MapsObject->TryGetField("OcclusionRoughnessMetallic") != nullptr) {
-		TSharedPtr<FJsonObject> OcclusionRoughnessMetallicObject = MapsObject->GetObjectField("OcclusionRoughnessMetallic");
-
-		if (OcclusionRoughnessMetallicObject->TryGetField("OcclusionStrength") != nullptr) {
-			float OcclusionStrength = (float)OcclusionRoughnessMetallicObject->GetNumberField("OcclusionStrength");
-			MaterialInstance->SetScalarParameterValue("OcclusionStrength", OcclusionStrength);
-		}
-
-		if (OcclusionRoughnessMetallicObject->TryGetField("RoughnessStrength") != nullptr) {
-			float RoughnessStrength = (float)OcclusionRoughnessMetallicObject->GetNumberField("RoughnessStrength");
-			MaterialInstance->SetScalarParameterValue("RoughnessStrength", RoughnessStrength);
-		}
-
-		if (OcclusionRoughnessMetallicObject->TryGetField("MetallicStrength") != nullptr) {
-			float MetallicStrength = (float)OcclusionRoughnessMetallicObject->GetNumberField("MetallicStrength");
-			MaterialInstance->SetScalarParameterValue("MetallicStrength", MetallicStrength);
-		}
-
-		if (OcclusionRoughnessMetallicObject->TryGetField("Path") != nullptr) {
-			FString Path = OcclusionRoughnessMetallicObject->GetStringField("Path");
-			if (!FPaths::FileExists(Path))
-				Path = FPaths::Combine(TextureFolder, Path);
-			FPaths::MakePlatformFilename(Path);
-			FPaths::CollapseRelativeDirectories(Path);
-			Error = DirectDrawSurfaceLoader->LoadTexture(Path);
-			if (Error == EErrorCode_OK)
-				MaterialInstance->SetTextureParameterValue("OcclusionRoughnessMetallic", DirectDrawSurfaceLoader->TextureArray[0]);
-		}
+	if (MaterialFile.OcclusionRoughnessMetallic.bIsSet) {
+		SetScalarParameter(MaterialInstance, "OcclusionStrength", MaterialFile.OcclusionStrength);
+		SetScalarParameter(MaterialInstance, "RoughnessStrength", MaterialFile.RoughnessStrength);
+		SetScalarParameter(MaterialInstance, "MetallicStrength", MaterialFile.MetallicStrength);
+		SetTextureParameter(MaterialInstance, MaterialName, "OcclusionRoughnessMetallic", MaterialFile.OcclusionRoughnessMetallic);
 	}
 
 	// Normal
-	if (MapsObject->TryGetField("Normal") != nullptr) {
-		TSharedPtr<FJsonObject> NormalObject = MapsObject->GetObjectField("Normal");
-
-		if (NormalObject->TryGetField("Strength") != nullptr) {
-			float Strength = (float)NormalObject->GetNumberField("Strength");
-			MaterialInstance->SetScalarParameterValue("NormalStrength", Strength);
-		}
-
-		if (NormalObject->TryGetField("Path") != nullptr) {
-			FString Path = NormalObject->GetStringField("Path");
-			if (!FPaths::FileExists(Path))
-				Path = FPaths::Combine(TextureFolder, Path);
-			FPaths::MakePlatformFilename(Path);
-			FPaths::CollapseRelativeDirectories(Path);
-			Error = DirectDrawSurfaceLoader->LoadTexture(Path);
-			if (Error == EErrorCode_OK)
-				MaterialInstance->SetTextureParameterValue("Normal", DirectDrawSurfaceLoader->TextureArray[0]);
-		}
+	if (MaterialFile.Normal.bIsSet) {
+		SetScalarParameter(MaterialInstance, "NormalStrength", MaterialFile.NormalStrength);
+		SetTextureParameter(MaterialInstance, MaterialName, "Normal", MaterialFile.Normal);
 	}
 
-	// Emissive
-	if (MapsObject->TryGetField("Emissive") != nullptr) {
-		TSharedPtr<FJsonObject> EmissiveObject = MapsObject->GetObjectField("Emissive");
-
-		if (EmissiveObject->TryGetField("Strength") != nullptr) {
-			float Strength = (float)EmissiveObject->GetNumberField("Strength");
-			MaterialInstance->SetScalarParameterValue("EmissiveStrength", Strength);
-		}
-		else {
-			MaterialInstance->SetScalarParameterValue("UseAmbientOcclusion", 1.0);
-		}
-
-		if (EmissiveObject->TryGetField("Path") != nullptr) {
-			FString Path = EmissiveObject->GetStringField("Path");
-			if (!FPaths::FileExists(Path))
-				Path = FPaths::Combine(TextureFolder, Path);
-			FPaths::MakePlatformFilename(Path);
-			FPaths::CollapseRelativeDirectories(Path);
-			Error = DirectDrawSurfaceLoader->LoadTexture(Path);
-			if (Error == EErrorCode_OK)
-				MaterialInstance->SetTextureParameterValue("Emissive", DirectDrawSurfaceLoader->TextureArray[0]);
-		}
-		else {
-			MaterialInstance->SetScalarParameterValue("UseAmbientOcclusion", 1.0);
-		}
-	}
-	else {
+	// Emissive, ambient occlusion is used unless both strength and texture are given
+	SetScalarParameter(MaterialInstance, "EmissiveStrength", MaterialFile.EmissiveStrength);
+	SetTextureParameter(MaterialInstance, MaterialName, "Emissive", MaterialFile.Emissive);
+	if (!MaterialFile.EmissiveStrength.IsSet() || MaterialFile.Emissive.ResolvedPath.IsEmpty())
 		MaterialInstance->SetScalarParameterValue("UseAmbientOcclusion", 1.0);
-	}
+
 	return MaterialInstance;
 }
 
-UMaterialInstanceDynamic* UMaterialLoader::GenerateSpecGlossTilingMaterial(FString DiffusePath, aiMaterial* Material, TSharedPtr<FJsonObject> JsonObject)
+UMaterialInstanceDynamic* UMaterialLoader::GenerateSpecGlossTilingMaterial(FString DiffusePath, const FString& MaterialName, const FMaterialFile& MaterialFile)
 {
-	// Split path to get base color file path
-	FString TextureFolder;
-	FString TextureName;
-	FString TextureExtension;
-	FPaths::Split(DiffusePath, TextureFolder, TextureName, TextureExtension);
-
 	UMaterialInstanceDynamic* MaterialInstance = UKismetMaterialLibrary::CreateDynamicMaterialInstance(GetWorld(), BaseSpecGlossTiling);
-	UDirectDrawSurfaceLoader* DirectDrawSurfaceLoader = NewObject<UDirectDrawSurfaceLoader>();
 
 	// Diffuse
-	EErrorCode Error = DirectDrawSurfaceLoader->LoadTexture(DiffusePath);
-	if (Error == EErrorCode_OK)
-		MaterialInstance->SetTextureParameterValue("Diffuse", DirectDrawSurfaceLoader->TextureArray[0]);
+	UTexture* Diffuse = FTextureCache::Get().Acquire(DiffusePath, MaterialInstance, MaterialName);
+	if (Diffuse != nullptr)
+		MaterialInstance->SetTextureParameterValue("Diffuse", Diffuse);
 
-	if (!JsonObject.IsValid() || JsonObject->TryGetField("Maps") == nullptr) {
-		if (Error == EErrorCode_OK) {
-			UE_LOG(LogMaterialLoader, Warning, TEXT("%s - Maps section missing in material file, therefore only adding diffuse!"), *FString(Material->GetName().C_Str()));
+	if (!MaterialFile.bHasMaps) {
+		if (Diffuse != nullptr) {
+			UE_LOG(LogMaterialLoader, Warning, TEXT("%s - Maps section missing in material file, therefore only adding diffuse!"), *MaterialName);
 			return MaterialInstance;
 		}
 		else {
-			UE_LOG(LogMaterialLoader, Error, TEXT("%s - Maps section missing in material file, but no diffuse was found!"), *FString(Material->GetName().C_Str()));
+			UE_LOG(LogMaterialLoader, Error, TEXT("%s - Maps section missing in material file, but no diffuse was found!"), *MaterialName);
 			return nullptr;
 		}
 	}
 
-	TSharedPtr<FJsonObject> MapsObject = JsonObject->GetObjectField("Maps");
-
-	// TilingScale
-	if (MapsObject->TryGetField("TilingScale") != nullptr) {
-		float TilingScale = (float)MapsObject->GetNumberField("TilingScale");
-		MaterialInstance->SetScalarParameterValue("TilingScale", TilingScale);
-	}
-
-	// TilingVariation
-	if (MapsObject->TryGetField("TilingVariation") != nullptr) {
-		float TilingVariation = (float)MapsObject->GetNumberField("TilingVariation");
-		MaterialInstance->SetScalarParameterValue("TilingVariation", TilingVariation);
-	}
+	// Tiling
+	SetScalarParameter(MaterialInstance, "TilingScale", MaterialFile.TilingScale);
+	SetScalarParameter(MaterialInstance, "TilingVariation", MaterialFile.TilingVariation);
 
 	// SpecGloss
-	if (MapsObject->TryGetField("SpecGloss") != nullptr) {
-		TSharedPtr<FJsonObject> SpecGlossObject = MapsObject->GetObjectField("SpecGloss");
-
-		if (SpecGlossObject->TryGetField("SpecStrength") != nullptr) {
-			float SpecStrength = (float)SpecGlossObject->GetNumberField("SpecStrength");
-			MaterialInstance->SetScalarParameterValue("SpecStrength", SpecStrength);
-		}
-
-		if (SpecGlossObject->TryGetField("GlossStrength") != nullptr) {
-			float GlossStrength = (float)SpecGlossObject->GetNumberField("GlossStrength");
-			MaterialInstance->SetScalarParameterValue("GlossStrength", GlossStrength);
-		}
-
-		if (SpecGlossObject->TryGetField("Path") != nullptr) {
-			FString Path = SpecGlossObject->GetStringField("Path");
-			if (!FPaths::FileExists(Path))
-				Path = FPaths::Combine(TextureFolder, Path);
-			FPaths::MakePlatformFilename(Path);
-			FPaths::CollapseRelativeDirectories(Path);
-			Error = DirectDrawSurfaceLoader->LoadTexture(Path);
-			if (Error == EErrorCode_OK)
-				MaterialInstance->SetTextureParameterValue("SpecGloss", DirectDrawSurfaceLoader->TextureArray[0]);
-		}
+	if (MaterialFile.SpecGloss.bIsSet) {
+		SetScalarParameter(MaterialInstance, "SpecStrength", MaterialFile.SpecStrength);
+		SetScalarParameter(MaterialInstance, "GlossStrength", MaterialFile.GlossStrength);
+		SetTextureParameter(MaterialInstance, MaterialName, "SpecGloss", MaterialFile.SpecGloss);
 	}
 
 	// Normal
-	if (MapsObject->TryGetField("Normal") != nullptr) {
-		TSharedPtr<FJsonObject> NormalObject = MapsObject->GetObjectField("Normal");
-
-		if (NormalObject->TryGetField("Strength") != nullptr) {
-			float Strength = (float)NormalObject->GetNumberField("Strength");
-			MaterialInstance->SetScalarParameterValue("NormalStrength", Strength);
-		}
-
-		if (NormalObject->TryGetField("Path") != nullptr) {
-			FString Path = NormalObject->GetStringField("Path");
-			if (!FPaths::FileExists(Path))
-				Path = FPaths::Combine(TextureFolder, Path);
-			FPaths::MakePlatformFilename(Path);
-			FPaths::CollapseRelativeDirectories(Path);
-			Error = DirectDrawSurfaceLoader->LoadTexture(Path);
-			if (Error == EErrorCode_OK)
-				MaterialInstance->SetTextureParameterValue("Normal", DirectDrawSurfaceLoader->TextureArray[0]);
-		}
+	if (MaterialFile.Normal.bIsSet) {
+		SetScalarParameter(MaterialInstance, "NormalStrength", MaterialFile.NormalStrength);
+		SetTextureParameter(MaterialInstance, MaterialName, "Normal", MaterialFile.Normal);
 	}
 
 	return MaterialInstance;
-}
\ No newline at end of file
+}
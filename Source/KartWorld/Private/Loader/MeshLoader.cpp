@@ -1,216 +1,335 @@
 // Copyright @ 2023 Fynn Haupt
 
 #include "Loader/MeshLoader.h"
+#include "Loader/ModelCache.h"
+#include "Loader/TextureLoader/TextureCache.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include <assimp/DefaultIOSystem.h>
 
 DEFINE_LOG_CATEGORY(LogMeshLoader);
 
-EMeshLoadingResult UMeshLoader::LoadRelative(
-	FString FilePath,
-	FModelData &ModelData)
+static TAutoConsoleVariable<int32> CVarMeshLoaderUseCache(
+	TEXT("kw.MeshLoader.UseCache"),
+	1,
+	TEXT("Whether imported models are written to and read from the .kwmesh cache next to the model file."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarMeshLoaderForceSerial(
+	TEXT("kw.MeshLoader.ForceSerial"),
+	0,
+	TEXT("Converts the meshes of an imported model one after another on the loading thread, useful for debugging."),
+	ECVF_Default);
+
+/**
+ * Forwards the assimp import progress to the load handle and aborts the import on cancellation.
+ */
+class FMeshLoadProgressHandler : public Assimp::ProgressHandler
 {
-	if (FilePath.IsEmpty())
+private:
+	FMeshLoadHandle& Handle;
+
+public:
+	FMeshLoadProgressHandler(FMeshLoadHandle& InHandle) : Handle(InHandle) {}
+
+	virtual bool Update(float Percentage = -1.0f) override
 	{
-		UE_LOG(LogMeshLoader, Error, TEXT("FilePath is empty!"));
-		return EMeshLoadingResult_NOFILE;
-	}
+		// Reading the file is the first half of the import
+		if (Percentage >= 0.0f)
+			Handle.SetProgress(FMath::Clamp(Percentage, 0.0f, 1.0f) * 0.5f);
 
-	FString FolderPath;
-	FString FileName;
-	FString FileExtension;
-	FPaths::Split(FilePath, FolderPath, FileName, FileExtension);
+		// Returning false aborts the import
+		return !Handle.IsCancelled();
+	}
+};
 
-	FString LodFileName(FileName + ".lod");
-	FString LodFilePath = FPaths::Combine(FolderPath, LodFileName);
+/**
+ * Records every file the importer opens besides the model, e.g. the material library of an OBJ, so the model cache can check them.
+ */
+class FMeshLoadIOSystem : public Assimp::DefaultIOSystem
+{
+private:
+	TArray<FString> OpenedFiles;
 
-	// Create scene
-	Scene = Importer.ReadFile(
-		TCHAR_TO_UTF8(*FilePath),
-		aiProcess_CalcTangentSpace |
-			aiProcess_Triangulate |
-			aiProcess_JoinIdenticalVertices |
-			aiProcess_SortByPType |
-			aiProcess_MakeLeftHanded);
+public:
+	virtual Assimp::IOStream* Open(const char* pFile, const char* pMode = "rb") override
+	{
+		Assimp::IOStream* Stream = Assimp::DefaultIOSystem::Open(pFile, pMode);
+		if (Stream != nullptr)
+		{
+			FString FilePath = FPaths::ConvertRelativePathToFull(UTF8_TO_TCHAR(pFile));
+			FPaths::NormalizeFilename(FilePath);
+			FPaths::CollapseRelativeDirectories(FilePath);
+			OpenedFiles.AddUnique(FilePath);
+		}
+		return Stream;
+	}
 
-	if (Scene == nullptr)
+	TArray<FString> GetDependencies(const FString& ModelPath) const
 	{
-		UE_LOG(LogMeshLoader, Error, TEXT("%s"), Importer.GetErrorString());
-		return EMeshLoadingResult_NOSCENE;
+		FString NormalizedModelPath = FPaths::ConvertRelativePathToFull(ModelPath);
+		FPaths::NormalizeFilename(NormalizedModelPath);
+		FPaths::CollapseRelativeDirectories(NormalizedModelPath);
+
+		TArray<FString> Dependencies = OpenedFiles;
+		Dependencies.RemoveAll([&](const FString& FilePath) { return FilePath.Equals(NormalizedModelPath, ESearchCase::IgnoreCase); });
+		return Dependencies;
 	}
+};
+
+FMeshLoadHandle::FMeshLoadHandle(FString InFilePath, bool bInWorldSpace) : FilePath(InFilePath), bWorldSpace(bInWorldSpace)
+{
+	Future = Promise.GetFuture();
+}
 
-	if (!Scene->HasMeshes())
+void FMeshLoadHandle::SetProgress(float NewProgress)
+{
+	Progress = NewProgress;
+
+	// Only notify in steps of one percent to not flood the game thread
+	if (!OnProgress.IsBound())
+		return;
+
+	// Meshes are converted in parallel, only one thread may report a step
+	float LastReported = ReportedProgress;
+	do
 	{
-		UE_LOG(LogMeshLoader, Warning, TEXT("File has no meshes!"));
-		return EMeshLoadingResult_NOMESHES;
+		if (NewProgress - LastReported < 0.01f)
+			return;
 	}
+	while (!ReportedProgress.compare_exchange_weak(LastReported, NewProgress));
 
-	// Fix root node rotation
-	aiMatrix4x4 FixRotateX;
-	aiMatrix4x4::RotationX(FMath::DegreesToRadians(-90.0f), FixRotateX);
-	aiMatrix4x4 FixRotateY;
-	aiMatrix4x4::RotationY(FMath::DegreesToRadians(-90.0f), FixRotateY);
-	aiMatrix4x4 FixRotateZ;
-	aiMatrix4x4::RotationZ(FMath::DegreesToRadians(180.0f), FixRotateZ);
-	Scene->mRootNode->mTransformation *= (FixRotateX * FixRotateY * FixRotateZ);
+	TWeakPtr<FMeshLoadHandle, ESPMode::ThreadSafe> WeakHandle = AsShared();
+	AsyncTask(ENamedThreads::GameThread, [WeakHandle, NewProgress]()
+	{
+		FMeshLoadHandlePtr Handle = WeakHandle.Pin();
+		if (Handle.IsValid() && !Handle->IsCancelled())
+			Handle->OnProgress.ExecuteIfBound(NewProgress);
+	});
+}
 
-	// Setup array lengths
-	ModelData.Meshes.SetNum(Scene->mNumMeshes);
+EMeshLoadingResult UMeshLoader::LoadRelative(
+	FString FilePath,
+	FModelData &ModelData)
+{
+	EMeshLoadingResult Result = ImportModel(Importer, FilePath, false, ModelData, nullptr);
+	if (Result != EMeshLoadingResult_OK)
+		return Result;
 
-	// Load Meshes
-	for (int32 MeshIndex = 0; MeshIndex < ModelData.Meshes.Num(); MeshIndex++)
+	// Load Materials
+	UMaterialLoader *MaterialLoader = NewObject<UMaterialLoader>();
+	ModelData.Materials = MaterialLoader->LoadMaterials(FPaths::GetPath(FilePath), ModelData.MaterialReferences);
+	ModelData.LoadSummary.Append(MaterialLoader->LoadSummary);
+
+	return EMeshLoadingResult_OK;
+}
+
+EMeshLoadingResult UMeshLoader::LoadWorld(
+	FString FilePath,
+	FModelData &ModelData)
+{
+	EMeshLoadingResult Result = ImportWorld(FilePath, ModelData);
+	if (Result != EMeshLoadingResult_OK)
+		return Result;
+
+	LoadMaterials(FilePath, ModelData);
+	return EMeshLoadingResult_OK;
+}
+
+EMeshLoadingResult UMeshLoader::ImportWorld(
+	FString FilePath,
+	FModelData &ModelData)
+{
+	return ImportModel(Importer, FilePath, true, ModelData, nullptr);
+}
+
+void UMeshLoader::LoadMaterials(
+	FString FilePath,
+	FModelData &ModelData)
+{
+	UMaterialLoader *MaterialLoader = NewObject<UMaterialLoader>();
+	ModelData.Materials = MaterialLoader->LoadMaterials(FPaths::GetPath(FilePath), ModelData.MaterialReferences);
+	ModelData.LoadSummary.Append(MaterialLoader->LoadSummary);
+}
+
+FMeshLoadHandleRef UMeshLoader::LoadRelativeAsync(
+	FString FilePath,
+	FOnMeshLoadCompleted OnCompleted,
+	FOnMeshLoadProgress OnProgress)
+{
+	FMeshLoadHandleRef Handle = MakeShared<FMeshLoadHandle, ESPMode::ThreadSafe>(FilePath, false);
+	Handle->OnCompleted = OnCompleted;
+	Handle->OnProgress = OnProgress;
+	return StartAsyncLoad(Handle);
+}
+
+FMeshLoadHandleRef UMeshLoader::LoadWorldAsync(
+	FString FilePath,
+	FOnMeshLoadCompleted OnCompleted,
+	FOnMeshLoadProgress OnProgress)
+{
+	FMeshLoadHandleRef Handle = MakeShared<FMeshLoadHandle, ESPMode::ThreadSafe>(FilePath, true);
+	Handle->OnCompleted = OnCompleted;
+	Handle->OnProgress = OnProgress;
+	return StartAsyncLoad(Handle);
+}
+
+FMeshLoadHandleRef UMeshLoader::StartAsyncLoad(FMeshLoadHandleRef Handle)
+{
+	check(IsInGameThread());
+
+	Async(EAsyncExecution::ThreadPool, [Handle]()
 	{
-		FMeshData &MeshData = ModelData.Meshes[MeshIndex];
-		aiMesh *Mesh = Scene->mMeshes[MeshIndex];
-		aiNode *Node = GetParentNode(Scene->mRootNode, MeshIndex);
+		// Importer takes ownership of the progress handler
+		Handle->Importer.SetProgressHandler(new FMeshLoadProgressHandler(*Handle));
 
-		// Material id
-		MeshData.MaterialId = Mesh->mMaterialIndex;
+		EMeshLoadingResult Result = ImportModel(Handle->Importer, Handle->FilePath, Handle->bWorldSpace, Handle->ModelData, &Handle.Get());
 
-		// Lod Data
-		GetLodData(LodFilePath, FString(Node->mName.C_Str()), MeshData.LodData);
+		if (Handle->IsCancelled())
+			Result = EMeshLoadingResult_CANCELLED;
 
-		// Vertices
-		for (uint32 VertexIndex = 0; VertexIndex < Mesh->mNumVertices; VertexIndex++)
+		// Material files and texture hashes are read here, so the game thread doesn't wait for any file
+		if (Result == EMeshLoadingResult_OK)
 		{
-			// Position
-			aiVector3D &aiVertex = Mesh->mVertices[VertexIndex];
-			FVector3f Position(
-				aiVertex.x,
-				aiVertex.y,
-				aiVertex.z);
-
-			// Normal
-			FVector3f Normal = FVector3f::ZeroVector;
-			if (Mesh->HasNormals())
-			{
-				aiVector3D &aiNormal = Mesh->mNormals[VertexIndex];
-				Normal = FVector3f(
-					aiNormal.x,
-					aiNormal.y,
-					aiNormal.z);
-			}
-
-			// Tangent
-			FVector3f Tangent = FVector3f::ZeroVector;
-			if (Mesh->HasTangentsAndBitangents())
-			{
-				aiVector3D &aiTangent = Mesh->mTangents[VertexIndex];
-				Tangent = FVector3f(
-					aiTangent.x,
-					aiTangent.y,
-					aiTangent.z);
-			}
-
-			// Linear Color
-			FLinearColor LinearColor = FLinearColor::White;
-			if (Mesh->HasVertexColors(0))
-			{
-				aiColor4D &aiColor = Mesh->mColors[0][VertexIndex];
-				LinearColor = FLinearColor(
-					aiColor.r,
-					aiColor.g,
-					aiColor.b,
-					aiColor.a);
-			}
-
-			// UVs
-			FVector2f UV0 = FVector2f::ZeroVector;
-			FVector2f UV1 = FVector2f::ZeroVector;
-			FVector2f UV2 = FVector2f::ZeroVector;
-			FVector2f UV3 = FVector2f::ZeroVector;
-			for (uint32 ChannelIndex = 0; ChannelIndex <= 3; ChannelIndex++)
-			{
-				if (Mesh->HasTextureCoords(ChannelIndex))
-				{
-					aiVector3D &aiCoordinate = Mesh->mTextureCoords[ChannelIndex][VertexIndex];
-					FVector2f Coordinate(aiCoordinate.x, -aiCoordinate.y);
-
-					switch (ChannelIndex)
-					{
-					case 0:
-						UV0 = Coordinate;
-						break;
-					case 1:
-						UV1 = Coordinate;
-						break;
-					case 2:
-						UV2 = Coordinate;
-						break;
-					case 3:
-						UV3 = Coordinate;
-						break;
-					}
-				}
-			}
-
-			// Create vertex
-			FVertexData Vertex;
-			Vertex.Position = Position;
-			Vertex.Normal = Normal;
-			Vertex.Tangent = Tangent;
-			Vertex.Color = LinearColor;
-			Vertex.UV0 = UV0;
-			Vertex.UV1 = UV1;
-			Vertex.UV2 = UV2;
-			Vertex.UV3 = UV3;
-
-			// Save vertex
-			MeshData.Verticies.Push(Vertex);
+			FLoadSummary& LoadSummary = Handle->ModelData.LoadSummary;
+			UMaterialLoader::PrepareMaterials(FPaths::GetPath(Handle->FilePath), Handle->ModelData.MaterialReferences, Handle->MaterialPreload, LoadSummary);
+			Handle->SetProgress(0.85f);
+
+			SCOPE_LOAD_STAGE(LoadSummary, Textures);
+			FTextureCache::Get().HashFiles(Handle->MaterialPreload.TexturePaths, Handle->MaterialPreload.Textures);
+			Handle->SetProgress(0.9f);
 		}
 
-		// Triangles
-		for (uint32 FaceIndex = 0; FaceIndex < Mesh->mNumFaces; FaceIndex++)
+		// UObjects can only be created on the game thread
+		AsyncTask(ENamedThreads::GameThread, [Handle, Result]()
+		{
+			ParseTexturesAsync(Handle, Result);
+		});
+	});
+
+	return Handle;
+}
+
+void UMeshLoader::ParseTexturesAsync(FMeshLoadHandleRef Handle, EMeshLoadingResult Result)
+{
+	check(IsInGameThread());
+
+	if (Result != EMeshLoadingResult_OK || Handle->IsCancelled())
+	{
+		FinishAsyncLoad(Handle, Result);
+		return;
+	}
+
+	// Loaders of the missing textures have to be created on the game thread
+	FTextureCache::Get().BeginParse(Handle->MaterialPreload.Textures);
+
+	Async(EAsyncExecution::ThreadPool, [Handle]()
+	{
+		{
+			SCOPE_LOAD_STAGE(Handle->ModelData.LoadSummary, Textures);
+			FTextureCache::ParseFiles(Handle->MaterialPreload.Textures);
+		}
+		Handle->SetProgress(0.95f);
+
+		AsyncTask(ENamedThreads::GameThread, [Handle]()
 		{
-			aiFace &Face = Mesh->mFaces[FaceIndex];
-			if (Face.mNumIndices < 3)
-				continue;
-
-			// Create triangle
-			FTriangleData Triangle;
-			// FTriangleData Triangle2;
-
-			Triangle.UV0 = Face.mIndices[0];
-			// Triangle2.UV0 = Face.mIndices[2];
-			Triangle.UV1 = Face.mIndices[1];
-			// Triangle2.UV1 = Face.mIndices[1];
-			Triangle.UV2 = Face.mIndices[2];
-			// Triangle2.UV2 = Face.mIndices[0];
-
-			// Save triangle
-			MeshData.Triangles.Push(Triangle);
-			// MeshData.Triangles.Push(Triangle2);
+			FinishAsyncLoad(Handle, EMeshLoadingResult_OK);
+		});
+	});
+}
+
+void UMeshLoader::FinishAsyncLoad(FMeshLoadHandleRef Handle, EMeshLoadingResult Result)
+{
+	check(IsInGameThread());
+
+	// Cancellation could have happened while waiting for the game thread
+	if (Handle->IsCancelled())
+		Result = EMeshLoadingResult_CANCELLED;
+
+	FTextureCache& TextureCache = FTextureCache::Get();
+	if (Result == EMeshLoadingResult_OK)
+	{
+		// Only the textures and material instances are created here
+		FLoadSummary& LoadSummary = Handle->ModelData.LoadSummary;
+		int32 NumLoadedTextures;
+		{
+			SCOPE_LOAD_STAGE(LoadSummary, Textures);
+			int64 ResidentBytes = TextureCache.GetStats().ResidentBytes;
+			NumLoadedTextures = TextureCache.FinishPreload(Handle->MaterialPreload.Textures);
+			LoadSummary.AddBytes(TEXT("Textures"), FMath::Max<int64>(0, TextureCache.GetStats().ResidentBytes - ResidentBytes));
 		}
+
+		UMaterialLoader *MaterialLoader = NewObject<UMaterialLoader>();
+		Handle->ModelData.Materials = MaterialLoader->CreateMaterials(Handle->ModelData.MaterialReferences, Handle->MaterialPreload, NumLoadedTextures);
+		LoadSummary.Append(MaterialLoader->LoadSummary);
+		Handle->Progress = 1.0f;
+		Handle->OnProgress.ExecuteIfBound(1.0f);
+	}
+	else if (Result == EMeshLoadingResult_CANCELLED)
+	{
+		UE_LOG(LogMeshLoader, Log, TEXT("%s - Loading was cancelled!"), *Handle->FilePath);
 	}
 
-	// Load Materials
-	UMaterialLoader *MaterialLoader = NewObject<UMaterialLoader>();
-	ModelData.Materials = MaterialLoader->LoadMaterials(FolderPath, Scene);
+	// Parsed but never created textures, loaders have to be released on the game thread
+	Handle->MaterialPreload.Textures.Loaders.Empty();
 
-	// Node Hierarchy
-	ModelData.NodeHierarchy = GetNodeHierarchy(Scene->mRootNode);
+	Handle->OnCompleted.ExecuteIfBound(Result, Handle->ModelData);
+	Handle->Promise.SetValue(Result);
+}
 
-	return EMeshLoadingResult_OK;
+EMeshLoadingResult UMeshLoader::ImportModel(Assimp::Importer& InImporter, const FString& FilePath, bool bWorldSpace, FModelData& ModelData, FMeshLoadHandle* Handle)
+{
+	// Pre-baked model skips assimp completely
+	bool bUseCache = CVarMeshLoaderUseCache.GetValueOnAnyThread() != 0;
+	if (bUseCache)
+	{
+		SCOPE_LOAD_STAGE(ModelData.LoadSummary, ModelCache);
+		if (FModelCache::Load(FilePath, bWorldSpace, ModelData))
+		{
+			ModelData.LoadSummary.AddBytes(TEXT("ModelCache"), IFileManager::Get().FileSize(*FModelCache::GetCachePath(FilePath)));
+			return EMeshLoadingResult_OK;
+		}
+	}
+
+	// Importer takes ownership of the io system
+	FMeshLoadIOSystem* IOSystem = new FMeshLoadIOSystem();
+	InImporter.SetIOHandler(IOSystem);
+
+	const aiScene* InScene = nullptr;
+	EMeshLoadingResult Result;
+	{
+		SCOPE_LOAD_STAGE(ModelData.LoadSummary, Assimp);
+		Result = ReadScene(InImporter, FilePath, InScene);
+		ModelData.LoadSummary.AddBytes(TEXT("Assimp"), FMath::Max<int64>(0, IFileManager::Get().FileSize(*FilePath)));
+	}
+
+	if (Result == EMeshLoadingResult_OK)
+		Result = ConvertScene(InScene, FilePath, bWorldSpace, ModelData, Handle);
+
+	// Scene isn't needed anymore
+	InImporter.FreeScene();
+
+	if (Result == EMeshLoadingResult_OK && bUseCache)
+	{
+		SCOPE_LOAD_STAGE(ModelData.LoadSummary, ModelCache);
+		FModelCache::Save(FilePath, bWorldSpace, ModelData, IOSystem->GetDependencies(FilePath));
+	}
+
+	return Result;
 }
 
-EMeshLoadingResult UMeshLoader::LoadWorld(
-	FString FilePath,
-	FModelData &ModelData)
+EMeshLoadingResult UMeshLoader::ReadScene(Assimp::Importer& InImporter, const FString& FilePath, const aiScene*& OutScene)
 {
+	OutScene = nullptr;
+
 	if (FilePath.IsEmpty())
 	{
 		UE_LOG(LogMeshLoader, Error, TEXT("FilePath is empty!"));
 		return EMeshLoadingResult_NOFILE;
 	}
 
-	FString FolderPath;
-	FString FileName;
-	FString FileExtension;
-	FPaths::Split(FilePath, FolderPath, FileName, FileExtension);
-
-	FString LodFileName(FileName + ".lod");
-	FString LodFilePath = FPaths::Combine(FolderPath, LodFileName);
-
 	// Create scene
-	Scene = Importer.ReadFile(
+	const aiScene* NewScene = InImporter.ReadFile(
 		TCHAR_TO_UTF8(*FilePath),
 		aiProcess_CalcTangentSpace |
 			aiProcess_Triangulate |
@@ -218,13 +337,13 @@ EMeshLoadingResult UMeshLoader::LoadWorld(
 			aiProcess_SortByPType |
 			aiProcess_MakeLeftHanded);
 
-	if (Scene == nullptr)
+	if (NewScene == nullptr)
 	{
-		UE_LOG(LogMeshLoader, Error, TEXT("%s"), Importer.GetErrorString());
+		UE_LOG(LogMeshLoader, Error, TEXT("%s"), UTF8_TO_TCHAR(InImporter.GetErrorString()));
 		return EMeshLoadingResult_NOSCENE;
 	}
 
-	if (!Scene->HasMeshes())
+	if (!NewScene->HasMeshes())
 	{
 		UE_LOG(LogMeshLoader, Warning, TEXT("File has no meshes!"));
 		return EMeshLoadingResult_NOMESHES;
@@ -237,219 +356,256 @@ EMeshLoadingResult UMeshLoader::LoadWorld(
 	aiMatrix4x4::RotationY(FMath::DegreesToRadians(-90.0f), FixRotateY);
 	aiMatrix4x4 FixRotateZ;
 	aiMatrix4x4::RotationZ(FMath::DegreesToRadians(180.0f), FixRotateZ);
-	Scene->mRootNode->mTransformation *= (FixRotateX * FixRotateY * FixRotateZ);
+	NewScene->mRootNode->mTransformation *= (FixRotateX * FixRotateY * FixRotateZ);
+
+	OutScene = NewScene;
+	return EMeshLoadingResult_OK;
+}
+
+EMeshLoadingResult UMeshLoader::ConvertScene(const aiScene* InScene, const FString& FilePath, bool bWorldSpace, FModelData& ModelData, FMeshLoadHandle* Handle)
+{
+	FString FolderPath;
+	FString FileName;
+	FString FileExtension;
+	FPaths::Split(FilePath, FolderPath, FileName, FileExtension);
+
+	FString LodFileName(FileName + ".lod");
+	FString LodFilePath = FPaths::Combine(FolderPath, LodFileName);
+
+	// Lod file is read once and shared by all meshes
+	FLodTable LodTable;
+	bool bHasLodTable;
+	{
+		SCOPE_LOAD_STAGE(ModelData.LoadSummary, Lod);
+		bHasLodTable = LodTable.Load(LodFilePath);
+	}
+
+	SCOPE_LOAD_STAGE(ModelData.LoadSummary, Convert);
+
+	// Resolve mesh owners and node transforms once for the whole scene
+	const FSceneIndex SceneIndex(InScene);
 
 	// Setup array lengths
-	ModelData.Meshes.SetNum(Scene->mNumMeshes);
+	ModelData.Meshes.SetNum(InScene->mNumMeshes);
+
+	// Every mesh only writes into its own slot, so they can be converted in parallel
+	const int32 NumMeshes = ModelData.Meshes.Num();
+	std::atomic<int32> NumConverted { 0 };
+	const EParallelForFlags Flags = CVarMeshLoaderForceSerial.GetValueOnAnyThread() != 0 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::Unbalanced;
 
 	// Load Meshes
-	for (int32 MeshIndex = 0; MeshIndex < ModelData.Meshes.Num(); MeshIndex++)
+	ParallelFor(NumMeshes, [&](int32 MeshIndex)
 	{
+		if (Handle != nullptr && Handle->IsCancelled())
+			return;
+
 		FMeshData &MeshData = ModelData.Meshes[MeshIndex];
-		aiMesh *Mesh = Scene->mMeshes[MeshIndex];
-		aiNode *Node = GetParentNode(Scene->mRootNode, MeshIndex);
+		aiMesh *Mesh = InScene->mMeshes[MeshIndex];
+		const aiNode *Node = SceneIndex.GetMeshNode(MeshIndex);
+
+		// Mesh isn't referenced by any node
+		if (Node == nullptr)
+			Node = InScene->mRootNode;
 
-		// Get world transform
-		FTransform Transform = GetWorldTransformOfNode(Node);
+		// World matrices are cached by the scene index
+		const FMatrix* WorldMatrix = bWorldSpace ? &SceneIndex.GetWorldMatrix(Node) : nullptr;
 
 		// Material id
 		MeshData.MaterialId = Mesh->mMaterialIndex;
 
 		// Lod Data
-		GetLodData(LodFilePath, FString(Mesh->mName.C_Str()), MeshData.LodData);
+		LodTable.Find(FString(bWorldSpace ? Mesh->mName.C_Str() : Node->mName.C_Str()), MeshData.LodData);
 
 		// Vertices
-		for (uint32 VertexIndex = 0; VertexIndex < Mesh->mNumVertices; VertexIndex++)
-		{
-			// Position
-			aiVector3D &aiVertex = Mesh->mVertices[VertexIndex];
-			FVector PositionVertex = Transform.TransformFVector4(FVector(
-				aiVertex.x,
-				aiVertex.y,
-				aiVertex.z));
-
-			FVector3f Position(
-				PositionVertex.X,
-				PositionVertex.Y,
-				PositionVertex.Z);
-
-			// Normal
-			FVector3f Normal = FVector3f::ZeroVector;
-			if (Mesh->HasNormals())
-			{
-				aiVector3D &aiNormal = Mesh->mNormals[VertexIndex];
-				FVector NormalVector = Transform.GetRotation().RotateVector(FVector(
-					aiNormal.x,
-					aiNormal.y,
-					aiNormal.z
-				));
-
-				Normal = FVector3f(
-					NormalVector.X,
-					NormalVector.Y,
-					NormalVector.Z);
-			}
-
-			// Tangent
-			FVector3f Tangent = FVector3f::ZeroVector;
-			if (Mesh->HasTangentsAndBitangents())
-			{
-				aiVector3D &aiTangent = Mesh->mTangents[VertexIndex];
-				FVector TangentVector = Transform.GetRotation().RotateVector(FVector(
-					aiTangent.x,
-					aiTangent.y,
-					aiTangent.z
-				));
-
-				Tangent = FVector3f(
-					TangentVector.X,
-					TangentVector.Y,
-					TangentVector.Z);
-			}
-
-			// Linear Color
-			FLinearColor LinearColor = FLinearColor::White;
-			if (Mesh->HasVertexColors(0))
-			{
-				aiColor4D &aiColor = Mesh->mColors[0][VertexIndex];
-				LinearColor = FLinearColor(
-					aiColor.r,
-					aiColor.g,
-					aiColor.b,
-					aiColor.a);
-			}
-
-			// UVs
-			FVector2f UV0 = FVector2f::ZeroVector;
-			FVector2f UV1 = FVector2f::ZeroVector;
-			FVector2f UV2 = FVector2f::ZeroVector;
-			FVector2f UV3 = FVector2f::ZeroVector;
-			for (uint32 ChannelIndex = 0; ChannelIndex <= 3; ChannelIndex++)
-			{
-				if (Mesh->HasTextureCoords(ChannelIndex))
-				{
-					aiVector3D &aiCoordinate = Mesh->mTextureCoords[ChannelIndex][VertexIndex];
-					FVector2f Coordinate(aiCoordinate.x, -aiCoordinate.y);
-
-					switch (ChannelIndex)
-					{
-					case 0:
-						UV0 = Coordinate;
-						break;
-					case 1:
-						UV1 = Coordinate;
-						break;
-					case 2:
-						UV2 = Coordinate;
-						break;
-					case 3:
-						UV3 = Coordinate;
-						break;
-					}
-				}
-			}
-
-			// Create vertex
-			FVertexData Vertex;
-			Vertex.Position = Position;
-			Vertex.Normal = Normal;
-			Vertex.Tangent = Tangent;
-			Vertex.Color = LinearColor;
-			Vertex.UV0 = UV0;
-			Vertex.UV1 = UV1;
-			Vertex.UV2 = UV2;
-			Vertex.UV3 = UV3;
-
-			// Save vertex
-			MeshData.Verticies.Push(Vertex);
-		}
+		ConvertVertices(Mesh, WorldMatrix, MeshData);
 
 		// Triangles
-		for (uint32 FaceIndex = 0; FaceIndex < Mesh->mNumFaces; FaceIndex++)
-		{
-			aiFace &Face = Mesh->mFaces[FaceIndex];
-			if (Face.mNumIndices < 3)
-				continue;
+		ConvertIndices(Mesh, MeshData);
 
-			// Create triangle
-			FTriangleData Triangle;
+		// Converting the meshes is the second part of the import
+		const int32 Converted = ++NumConverted;
+		if (Handle != nullptr)
+			Handle->SetProgress(0.5f + 0.3f * (float)Converted / (float)NumMeshes);
+	}, Flags);
 
-			Triangle.UV0 = Face.mIndices[0];
-			Triangle.UV1 = Face.mIndices[1];
-			Triangle.UV2 = Face.mIndices[2];
+	if (Handle != nullptr && Handle->IsCancelled())
+		return EMeshLoadingResult_CANCELLED;
 
-			// Save triangle
-			MeshData.Triangles.Push(Triangle);
-		}
-	}
+	if (bHasLodTable)
+		UE_LOG(LogMeshLoader, Log, TEXT("%s - %d lod entries, %d of %d lookups hit"), *LodFilePath, LodTable.Num(), LodTable.GetNumHits(), LodTable.GetNumLookups());
 
-	// Load Materials
-	UMaterialLoader *MaterialLoader = NewObject<UMaterialLoader>();
-	ModelData.Materials = MaterialLoader->LoadMaterials(FolderPath, Scene);
+	// Materials are created later on the game thread
+	ModelData.MaterialReferences = UMaterialLoader::GetMaterialReferences(InScene);
+
+	// Node Hierarchy
+	if (!bWorldSpace)
+		ModelData.NodeHierarchy = GetNodeHierarchy(SceneIndex, InScene->mRootNode);
 
 	return EMeshLoadingResult_OK;
 }
 
-FTransform UMeshLoader::GetTransformOfNode(aiNode *Node)
+/**
+ * Vectorized kernels to bake vertex streams into world space.
+ * Matrices use the row vector convention of FMatrix, so a point is x * Row0 + y * Row1 + z * Row2 + Row3.
+ */
+static void TransformPositions(const FMatrix44f& Matrix, const aiVector3D* Source, FVector3f* Target, int32 Num)
 {
-	// Convert Assimp Matrix to FMatrix
-	aiMatrix4x4 aiTransform = Node->mTransformation;
+	const VectorRegister4Float Row0 = VectorLoadAligned(Matrix.M[0]);
+	const VectorRegister4Float Row1 = VectorLoadAligned(Matrix.M[1]);
+	const VectorRegister4Float Row2 = VectorLoadAligned(Matrix.M[2]);
+	const VectorRegister4Float Row3 = VectorLoadAligned(Matrix.M[3]);
 
-	FMatrix Matrix;
-	Matrix.M[0][0] = aiTransform.a1;
-	Matrix.M[0][1] = aiTransform.b1;
-	Matrix.M[0][2] = aiTransform.c1;
-	Matrix.M[0][3] = aiTransform.d1;
-	Matrix.M[1][0] = aiTransform.a2;
-	Matrix.M[1][1] = aiTransform.b2;
-	Matrix.M[1][2] = aiTransform.c2;
-	Matrix.M[1][3] = aiTransform.d2;
-	Matrix.M[2][0] = aiTransform.a3;
-	Matrix.M[2][1] = aiTransform.b3;
-	Matrix.M[2][2] = aiTransform.c3;
-	Matrix.M[2][3] = aiTransform.d3;
-	Matrix.M[3][0] = aiTransform.a4;
-	Matrix.M[3][1] = aiTransform.b4;
-	Matrix.M[3][2] = aiTransform.c4;
-	Matrix.M[3][3] = aiTransform.d4;
+	for (int32 Index = 0; Index < Num; Index++)
+	{
+		const aiVector3D& Vector = Source[Index];
+		VectorRegister4Float Result = VectorMultiplyAdd(VectorSetFloat1(Vector.x), Row0, Row3);
+		Result = VectorMultiplyAdd(VectorSetFloat1(Vector.y), Row1, Result);
+		Result = VectorMultiplyAdd(VectorSetFloat1(Vector.z), Row2, Result);
+		VectorStoreFloat3(Result, &Target[Index].X);
+	}
+}
 
-	return FTransform(Matrix);
+// Directions ignore the translation and are normalized again, scaling would shorten or stretch them
+static void TransformDirections(const FMatrix44f& Matrix, const aiVector3D* Source, FVector3f* Target, int32 Num)
+{
+	const VectorRegister4Float Row0 = VectorLoadAligned(Matrix.M[0]);
+	const VectorRegister4Float Row1 = VectorLoadAligned(Matrix.M[1]);
+	const VectorRegister4Float Row2 = VectorLoadAligned(Matrix.M[2]);
+
+	for (int32 Index = 0; Index < Num; Index++)
+	{
+		const aiVector3D& Vector = Source[Index];
+		VectorRegister4Float Result = VectorMultiply(VectorSetFloat1(Vector.x), Row0);
+		Result = VectorMultiplyAdd(VectorSetFloat1(Vector.y), Row1, Result);
+		Result = VectorMultiplyAdd(VectorSetFloat1(Vector.z), Row2, Result);
+		Result = VectorNormalizeSafe(VectorSet_W0(Result), GlobalVectorConstants::Float0001);
+		VectorStoreFloat3(Result, &Target[Index].X);
+	}
 }
 
-FTransform UMeshLoader::GetWorldTransformOfNode(aiNode *Node)
+void UMeshLoader::ConvertVertices(const aiMesh* Mesh, const FMatrix* WorldMatrix, FMeshData& MeshData)
 {
-	// Convert Assimp Matrix to FMatrix
-	aiMatrix4x4 aiTransform = Node->mTransformation;
+	const int32 NumVertices = Mesh->mNumVertices;
 
-	FMatrix Matrix;
-	Matrix.M[0][0] = aiTransform.a1;
-	Matrix.M[0][1] = aiTransform.b1;
-	Matrix.M[0][2] = aiTransform.c1;
-	Matrix.M[0][3] = aiTransform.d1;
-	Matrix.M[1][0] = aiTransform.a2;
-	Matrix.M[1][1] = aiTransform.b2;
-	Matrix.M[1][2] = aiTransform.c2;
-	Matrix.M[1][3] = aiTransform.d2;
-	Matrix.M[2][0] = aiTransform.a3;
-	Matrix.M[2][1] = aiTransform.b3;
-	Matrix.M[2][2] = aiTransform.c3;
-	Matrix.M[2][3] = aiTransform.d3;
-	Matrix.M[3][0] = aiTransform.a4;
-	Matrix.M[3][1] = aiTransform.b4;
-	Matrix.M[3][2] = aiTransform.c4;
-	Matrix.M[3][3] = aiTransform.d4;
+	// Relative meshes are copied as they are
+	const bool bCopy = (WorldMatrix == nullptr || WorldMatrix->Equals(FMatrix::Identity, 0.0)) && sizeof(aiVector3D) == sizeof(FVector3f);
+
+	FMatrix44f PositionMatrix;
+	FMatrix44f NormalMatrix;
+	FMatrix44f TangentMatrix;
+	if (!bCopy)
+	{
+		FMatrix Matrix = WorldMatrix != nullptr ? *WorldMatrix : FMatrix::Identity;
+		PositionMatrix = FMatrix44f(Matrix);
+		TangentMatrix = FMatrix44f(Matrix.RemoveTranslation());
+
+		// Normals need the inverse transpose to stay perpendicular under non uniform scale, the adjoint only differs by the determinant
+		FMatrix Adjoint = Matrix.RemoveTranslation().TransposeAdjoint();
+		NormalMatrix = FMatrix44f(Matrix.Determinant() < 0.0 ? Adjoint * -1.0 : Adjoint);
+	}
+
+	// Position
+	MeshData.Positions.SetNumUninitialized(NumVertices);
+	if (bCopy)
+		FMemory::Memcpy(MeshData.Positions.GetData(), Mesh->mVertices, NumVertices * sizeof(FVector3f));
+	else
+		TransformPositions(PositionMatrix, Mesh->mVertices, MeshData.Positions.GetData(), NumVertices);
+
+	// Normal
+	if (Mesh->HasNormals())
+	{
+		MeshData.Normals.SetNumUninitialized(NumVertices);
+		if (bCopy)
+			FMemory::Memcpy(MeshData.Normals.GetData(), Mesh->mNormals, NumVertices * sizeof(FVector3f));
+		else
+			TransformDirections(NormalMatrix, Mesh->mNormals, MeshData.Normals.GetData(), NumVertices);
+	}
+
+	// Tangent
+	if (Mesh->HasTangentsAndBitangents())
+	{
+		MeshData.Tangents.SetNumUninitialized(NumVertices);
+		if (bCopy)
+			FMemory::Memcpy(MeshData.Tangents.GetData(), Mesh->mTangents, NumVertices * sizeof(FVector3f));
+		else
+			TransformDirections(TangentMatrix, Mesh->mTangents, MeshData.Tangents.GetData(), NumVertices);
+	}
+
+	// Color
+	if (Mesh->HasVertexColors(0))
+	{
+		MeshData.Colors.SetNumUninitialized(NumVertices);
+		FColor* Colors = MeshData.Colors.GetData();
+		for (int32 VertexIndex = 0; VertexIndex < NumVertices; VertexIndex++)
+		{
+			const aiColor4D& aiColor = Mesh->mColors[0][VertexIndex];
+			Colors[VertexIndex] = FLinearColor(aiColor.r, aiColor.g, aiColor.b, aiColor.a).ToFColor(true);
+		}
+	}
+
+	// UVs
+	TArray<FVector2f>* Channels[] = { &MeshData.UV0, &MeshData.UV1, &MeshData.UV2, &MeshData.UV3 };
+	for (uint32 ChannelIndex = 0; ChannelIndex < UE_ARRAY_COUNT(Channels); ChannelIndex++)
+	{
+		if (!Mesh->HasTextureCoords(ChannelIndex))
+			continue;
+
+		Channels[ChannelIndex]->SetNumUninitialized(NumVertices);
+		FVector2f* Coordinates = Channels[ChannelIndex]->GetData();
+		const aiVector3D* aiCoordinates = Mesh->mTextureCoords[ChannelIndex];
+		for (int32 VertexIndex = 0; VertexIndex < NumVertices; VertexIndex++)
+			Coordinates[VertexIndex] = FVector2f(aiCoordinates[VertexIndex].x, -aiCoordinates[VertexIndex].y);
+	}
+}
+
+void UMeshLoader::ConvertIndices(const aiMesh* Mesh, FMeshData& MeshData)
+{
+	// Meshes are triangulated, only points and lines have less indices
+	MeshData.Indices.SetNumUninitialized(Mesh->mNumFaces * 3);
+	int32* Indices = MeshData.Indices.GetData();
 
-	if (Node->mParent == nullptr)
-		return FTransform(Matrix);
+	int32 NumIndices = 0;
+	for (uint32 FaceIndex = 0; FaceIndex < Mesh->mNumFaces; FaceIndex++)
+	{
+		const aiFace& Face = Mesh->mFaces[FaceIndex];
+		if (Face.mNumIndices < 3)
+			continue;
+
+		Indices[NumIndices++] = Face.mIndices[0];
+		Indices[NumIndices++] = Face.mIndices[1];
+		Indices[NumIndices++] = Face.mIndices[2];
+	}
 
-	Matrix = GetWorldTransformOfNode(Node->mParent, Matrix);
-	return FTransform(Matrix);
+	MeshData.Indices.SetNum(NumIndices);
 }
 
-FMatrix UMeshLoader::GetWorldTransformOfNode(aiNode *Node, FMatrix WorldMatrix)
+FSceneIndex::FSceneIndex(const aiScene* InScene)
 {
-	aiMatrix4x4 aiTransform = Node->mTransformation;
+	MeshNodes.Init(nullptr, InScene->mNumMeshes);
+	AddNode(InScene->mRootNode, FMatrix::Identity);
+}
+
+void FSceneIndex::AddNode(const aiNode* Node, const FMatrix& ParentWorldMatrix)
+{
+	FMatrix LocalMatrix = ConvertMatrix(Node->mTransformation);
+	FMatrix WorldMatrix = LocalMatrix * ParentWorldMatrix;
+	NodeMatrices.Add(Node, { LocalMatrix, WorldMatrix });
+
+	// First node in depth first order owns the mesh
+	for (uint32 MeshIndex = 0; MeshIndex < Node->mNumMeshes; MeshIndex++)
+	{
+		uint32 NodeMeshIndex = Node->mMeshes[MeshIndex];
+		if (MeshNodes.IsValidIndex(NodeMeshIndex) && MeshNodes[NodeMeshIndex] == nullptr)
+			MeshNodes[NodeMeshIndex] = Node;
+	}
 
+	for (uint32 ChildIndex = 0; ChildIndex < Node->mNumChildren; ChildIndex++)
+		AddNode(Node->mChildren[ChildIndex], WorldMatrix);
+}
+
+FMatrix FSceneIndex::ConvertMatrix(const aiMatrix4x4& aiTransform)
+{
+	// Assimp matrices are column major
 	FMatrix Matrix;
 	Matrix.M[0][0] = aiTransform.a1;
 	Matrix.M[0][1] = aiTransform.b1;
@@ -467,53 +623,41 @@ FMatrix UMeshLoader::GetWorldTransformOfNode(aiNode *Node, FMatrix WorldMatrix)
 	Matrix.M[3][1] = aiTransform.b4;
 	Matrix.M[3][2] = aiTransform.c4;
 	Matrix.M[3][3] = aiTransform.d4;
-
-	if (Node->mParent == nullptr)
-		return WorldMatrix * Matrix;
-
-	Matrix = GetWorldTransformOfNode(Node->mParent, WorldMatrix * Matrix);
 	return Matrix;
 }
 
-FNodeData UMeshLoader::GetNodeHierarchy(aiNode *Node)
+FTransform UMeshLoader::GetTransformOfNode(const FSceneIndex& SceneIndex, const aiNode *Node)
+{
+	return FTransform(SceneIndex.GetLocalMatrix(Node));
+}
+
+FNodeData UMeshLoader::GetNodeHierarchy(const FSceneIndex& SceneIndex, const aiNode *Node)
 {
 	FNodeData NodeData;
 	NodeData.Name = FString(Node->mName.C_Str());
 
 	// Get transform of node
-	NodeData.Transform = GetTransformOfNode(Node);
+	NodeData.Transform = GetTransformOfNode(SceneIndex, Node);
 
 	// Save each mesh index
+	NodeData.Meshes.Reserve(Node->mNumMeshes);
 	for (uint32 MeshIndex = 0; MeshIndex < Node->mNumMeshes; MeshIndex++)
 		NodeData.Meshes.Push(Node->mMeshes[MeshIndex]);
 
 	// Save each children
+	NodeData.Nodes.Reserve(Node->mNumChildren);
 	for (uint32 ChildIndex = 0; ChildIndex < Node->mNumChildren; ChildIndex++)
-		NodeData.Nodes.Push(GetNodeHierarchy(Node->mChildren[ChildIndex]));
+		NodeData.Nodes.Push(GetNodeHierarchy(SceneIndex, Node->mChildren[ChildIndex]));
 
 	return NodeData;
 }
 
-aiNode *UMeshLoader::GetParentNode(aiNode *Node, int32 SearchMeshIndex)
+bool FLodTable::Load(const FString& FilePath)
 {
-	for (uint32 MeshIndex = 0; MeshIndex < Node->mNumMeshes; MeshIndex++)
-		if (Node->mMeshes[MeshIndex] == SearchMeshIndex)
-			return Node;
+	Entries.Reset();
 
-	for (uint32 ChildIndex = 0; ChildIndex < Node->mNumChildren; ChildIndex++)
-	{
-		aiNode *FoundNode = GetParentNode(Node->mChildren[ChildIndex], SearchMeshIndex);
-		if (FoundNode != nullptr)
-			return FoundNode;
-	}
-
-	return nullptr;
-}
-
-bool UMeshLoader::GetLodData(FString FilePath, FString SearchMeshName, FLodData &LodData)
-{
 	// When Lod file doesn't exist then return
-	if (!FileManager.FileExists(*FilePath))
+	if (!FPaths::FileExists(FilePath))
 	{
 		// Is no issue so dont say anything
 		// UE_LOG(LogMeshLoader, Warning, TEXT("%s - Lod file not found!"), *FilePath);
@@ -541,6 +685,7 @@ bool UMeshLoader::GetLodData(FString FilePath, FString SearchMeshName, FLodData
 		return false;
 	}
 
+	Entries.Reserve(Meshes->Num());
 	for (int32 MeshIndex = 0; MeshIndex < Meshes->Num(); MeshIndex++)
 	{
 		TSharedPtr<FJsonObject> *Mesh;
@@ -550,38 +695,44 @@ bool UMeshLoader::GetLodData(FString FilePath, FString SearchMeshName, FLodData
 			return false;
 		}
 
-		if (Mesh->Get()->TryGetField("MeshName"))
-		{
-			FString MeshName = Mesh->Get()->GetStringField("MeshName");
-			if (SearchMeshName.Compare(MeshName) != 0)
-				continue;
-		}
-		else
+		FString MeshName;
+		if (!Mesh->Get()->TryGetStringField("MeshName", MeshName))
 		{
 			UE_LOG(LogMeshLoader, Error, TEXT("%s - MeshName missing!"), *FilePath);
 			return false;
 		}
 
-		if (Mesh->Get()->TryGetField("Lod"))
-		{
-			LodData.Lod = Mesh->Get()->GetIntegerField("Lod");
-		}
-		else
+		FLodData LodData;
+		if (!Mesh->Get()->TryGetNumberField("Lod", LodData.Lod))
 		{
 			UE_LOG(LogMeshLoader, Error, TEXT("%s - Lod missing!"), *FilePath);
 			return false;
 		}
 
-		if (Mesh->Get()->TryGetField("ScreenSize"))
-		{
-			LodData.ScreenSize = Mesh->Get()->GetNumberField("ScreenSize");
-		}
-		else
+		double ScreenSize;
+		if (!Mesh->Get()->TryGetNumberField("ScreenSize", ScreenSize))
 		{
 			UE_LOG(LogMeshLoader, Error, TEXT("%s - ScreenSize missing!"), *FilePath);
 			return false;
 		}
+		LodData.ScreenSize = ScreenSize;
+
+		// Later entries win like before
+		Entries.Add(MeshName, LodData);
 	}
 
 	return true;
-}
\ No newline at end of file
+}
+
+bool FLodTable::Find(const FString& MeshName, FLodData& LodData) const
+{
+	NumLookups++;
+
+	const FLodData* Found = Entries.Find(MeshName);
+	if (Found == nullptr)
+		return false;
+
+	NumHits++;
+	LodData = *Found;
+	return true;
+}
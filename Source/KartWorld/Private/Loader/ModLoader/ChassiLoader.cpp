@@ -1,6 +1,7 @@
 // Copyright @ 2023 Fynn Haupt
 
 #include "Loader/ModLoader/ChassiLoader.h"
+#include "Loader/ModLoader/ModCatalog.h"
 
 DEFINE_LOG_CATEGORY(LogChassiLoader);
 
@@ -274,6 +275,8 @@ void UChassiLoader::Initialize(FString GameUserDir)
 FChassiModel UChassiLoader::Load(FString ChassiName)
 {
     UE_LOG(LogChassiLoader, Log, TEXT("Loading Chassi %s - Please wait!"), *ChassiName);
+    double StartTime = FPlatformTime::Seconds();
+    FLoadSummary LoadSummary;
 
     if (ChassiName.IsEmpty())
     {
@@ -283,26 +286,37 @@ FChassiModel UChassiLoader::Load(FString ChassiName)
 
     FString ChassiDir = FPaths::Combine(ModsDir, *ChassiName);
 
-    // When directory doesn't exist then return failure!
-    if (!FileManager.DirectoryExists(*ChassiDir))
+    // Load configuration, the catalog already parsed it when the mod is known
+    FChassiConfiguration ChassiConfiguration;
+    bool bSuccess;
     {
-        UE_LOG(LogChassiLoader, Error, TEXT("Track %s directory not found!"), *ChassiName);
-        return FChassiModel();
-    }
-
-    FString IniFileName = FString(ChassiName + ".ini");
-    FString IniFilePath = FPaths::Combine(ChassiDir, IniFileName);
+        SCOPE_LOAD_STAGE(LoadSummary, Ini);
+        // When directory doesn't exist then return failure!
+        if (!FileManager.DirectoryExists(*ChassiDir))
+        {
+            UE_LOG(LogChassiLoader, Error, TEXT("Track %s directory not found!"), *ChassiName);
+            return FChassiModel();
+        }
 
-    // Load configuration
-    FChassiConfiguration ChassiConfiguration;
-    bool bSuccess = GetConfiguration(IniFilePath, ChassiConfiguration);
+        // Catalog already parsed the configuration, but the mod might have been removed since the last scan
+        bSuccess = Catalog != nullptr && Catalog->FindChassi(ChassiName, ChassiConfiguration);
+        if (!bSuccess)
+        {
+            FString IniFileName = FString(ChassiName + ".ini");
+            FString IniFilePath = FPaths::Combine(ChassiDir, IniFileName);
+            bSuccess = GetConfiguration(IniFilePath, ChassiConfiguration);
+        }
+    }
     if (!bSuccess)
         return FChassiModel();
 
     // Load linking
     FString LinkingPath = FPaths::Combine(ChassiDir, ChassiConfiguration.Linking);
     FChassiLinking ChassiLinking;
-    bSuccess = GetLinking(LinkingPath, ChassiLinking);
+    {
+        SCOPE_LOAD_STAGE(LoadSummary, Link);
+        bSuccess = GetLinking(LinkingPath, ChassiLinking);
+    }
     if (!bSuccess)
         return FChassiModel();
 
@@ -312,8 +326,14 @@ FChassiModel UChassiLoader::Load(FString ChassiName)
     UMeshLoader *MeshLoader = NewObject<UMeshLoader>();
     MeshLoader->LoadRelative(ModelPath, ModelData);
 
+    FChassiModel ChassiModel(ChassiConfiguration, ChassiLinking, ModelData);
+    ChassiModel.LoadSummary = LoadSummary;
+    ChassiModel.LoadSummary.Append(ModelData.LoadSummary);
+    ChassiModel.LoadSummary.TotalMilliseconds = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+    ChassiModel.LoadSummary.Log(ChassiName);
+
     UE_LOG(LogChassiLoader, Log, TEXT("Chassi %s was successful loaded!"), *ChassiName);
-    return FChassiModel(ChassiConfiguration, ChassiLinking, ModelData);
+    return ChassiModel;
 }
 
 FChassiModel::FChassiModel()
@@ -0,0 +1,192 @@
+// Copyright @ 2023 Fynn Haupt
+
+#include "Loader/ModLoader/ModCatalog.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+
+DEFINE_LOG_CATEGORY(LogModCatalog);
+
+static TAutoConsoleVariable<float> CVarModCatalogPollInterval(
+	TEXT("kw.ModCatalog.PollInterval"),
+	2.0f,
+	TEXT("Seconds between checks of the mods directories for added, removed or changed mods, 0 disables the check."),
+	ECVF_Default);
+
+void UModCatalog::Initialize(UTrackLoader* InTrackLoader, UChassiLoader* InChassiLoader, UTireLoader* InTireLoader)
+{
+	TrackLoader = InTrackLoader;
+	ChassiLoader = InChassiLoader;
+	TireLoader = InTireLoader;
+
+	StartScan(false);
+
+	float PollInterval = CVarModCatalogPollInterval.GetValueOnGameThread();
+	if (PollInterval > 0.0f)
+		TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UModCatalog::Poll), PollInterval);
+}
+
+void UModCatalog::Refresh()
+{
+	StartScan(false);
+}
+
+bool UModCatalog::Poll(float DeltaTime)
+{
+	StartScan(true);
+	return true;
+}
+
+uint32 UModCatalog::GetFingerprint(const FString& ModsDir, uint32 Fingerprint)
+{
+	IFileManager::Get().IterateDirectoryStat(*ModsDir, [&](const TCHAR* Path, const FFileStatData& StatData)
+	{
+		if (!StatData.bIsDirectory)
+			return true;
+
+		// Ini file is named after the mod folder
+		FString ModName = FPaths::GetCleanFilename(Path);
+		FFileStatData IniStatData = IFileManager::Get().GetStatData(*FPaths::Combine(Path, ModName + TEXT(".ini")));
+		Fingerprint = HashCombine(Fingerprint, GetTypeHash(ModName));
+		if (IniStatData.bIsValid)
+			Fingerprint = HashCombine(Fingerprint, HashCombine(GetTypeHash(IniStatData.FileSize), GetTypeHash(IniStatData.ModificationTime)));
+		return true;
+	});
+
+	return Fingerprint;
+}
+
+void UModCatalog::Scan(UTrackLoader* InTrackLoader, UChassiLoader* InChassiLoader, UTireLoader* InTireLoader, FScanResult& Result)
+{
+	// Every mod is a folder with an ini file named after it
+	auto ScanMods = [](const FString& ModsDir, auto& Configurations, auto GetConfiguration)
+	{
+		TArray<FString> ModNames;
+		IFileManager::Get().FindFiles(ModNames, *FPaths::Combine(ModsDir, TEXT("*")), false, true);
+
+		using FConfiguration = typename TDecay<decltype(Configurations)>::Type::ValueType;
+		TArray<FConfiguration> Parsed;
+		TArray<bool> Valid;
+		Parsed.SetNum(ModNames.Num());
+		Valid.SetNumZeroed(ModNames.Num());
+
+		ParallelFor(ModNames.Num(), [&](int32 ModIndex)
+		{
+			const FString& ModName = ModNames[ModIndex];
+			Valid[ModIndex] = GetConfiguration(FPaths::Combine(ModsDir, ModName, ModName + TEXT(".ini")), Parsed[ModIndex]);
+		});
+
+		for (int32 ModIndex = 0; ModIndex < ModNames.Num(); ModIndex++)
+			if (Valid[ModIndex])
+				Configurations.Add(ModNames[ModIndex], MoveTemp(Parsed[ModIndex]));
+	};
+
+	ScanMods(InTrackLoader->ModsDir, Result.Tracks, [InTrackLoader](const FString& FilePath, FTrackConfiguration& Configuration) { return InTrackLoader->GetConfiguration(FilePath, Configuration); });
+	ScanMods(InChassiLoader->ModsDir, Result.Chassis, [InChassiLoader](const FString& FilePath, FChassiConfiguration& Configuration) { return InChassiLoader->GetConfiguration(FilePath, Configuration); });
+	ScanMods(InTireLoader->ModsDir, Result.Tires, [InTireLoader](const FString& FilePath, FTireConfiguration& Configuration) { return InTireLoader->GetConfiguration(FilePath, Configuration); });
+}
+
+void UModCatalog::StartScan(bool bOnlyWhenChanged)
+{
+	check(IsInGameThread());
+
+	if (bIsScanning || TrackLoader == nullptr || ChassiLoader == nullptr || TireLoader == nullptr)
+		return;
+	bIsScanning = true;
+
+	TWeakObjectPtr<UModCatalog> WeakCatalog(this);
+	UTrackLoader* InTrackLoader = TrackLoader;
+	UChassiLoader* InChassiLoader = ChassiLoader;
+	UTireLoader* InTireLoader = TireLoader;
+	uint32 KnownFingerprint = bOnlyWhenChanged ? Fingerprint : 0;
+
+	// Loaders are kept alive by the catalog, which waits for the scan in BeginDestroy
+	ScanFuture = Async(EAsyncExecution::ThreadPool, [WeakCatalog, InTrackLoader, InChassiLoader, InTireLoader, KnownFingerprint]()
+	{
+		FScanResult Result;
+		Result.Fingerprint = GetFingerprint(InTrackLoader->ModsDir, 0);
+		Result.Fingerprint = GetFingerprint(InChassiLoader->ModsDir, Result.Fingerprint);
+		Result.Fingerprint = GetFingerprint(InTireLoader->ModsDir, Result.Fingerprint);
+
+		bool bChanged = KnownFingerprint == 0 || Result.Fingerprint != KnownFingerprint;
+		if (bChanged)
+			Scan(InTrackLoader, InChassiLoader, InTireLoader, Result);
+
+		AsyncTask(ENamedThreads::GameThread, [WeakCatalog, bChanged, Result = MoveTemp(Result)]() mutable
+		{
+			UModCatalog* Catalog = WeakCatalog.Get();
+			if (Catalog == nullptr)
+				return;
+
+			Catalog->bIsScanning = false;
+			if (bChanged)
+				Catalog->FinishScan(MoveTemp(Result));
+		});
+	});
+}
+
+void UModCatalog::FinishScan(FScanResult&& Result)
+{
+	Tracks = MoveTemp(Result.Tracks);
+	Chassis = MoveTemp(Result.Chassis);
+	Tires = MoveTemp(Result.Tires);
+	Fingerprint = Result.Fingerprint;
+	bIsReady = true;
+
+	UE_LOG(LogModCatalog, Log, TEXT("%d tracks, %d chassis and %d tires found!"), Tracks.Num(), Chassis.Num(), Tires.Num());
+	OnChanged.Broadcast();
+}
+
+TArray<FString> UModCatalog::GetTrackNames() const
+{
+	TArray<FString> Names;
+	Tracks.GetKeys(Names);
+	return Names;
+}
+
+TArray<FString> UModCatalog::GetChassiNames() const
+{
+	TArray<FString> Names;
+	Chassis.GetKeys(Names);
+	return Names;
+}
+
+TArray<FString> UModCatalog::GetTireNames() const
+{
+	TArray<FString> Names;
+	Tires.GetKeys(Names);
+	return Names;
+}
+
+bool UModCatalog::FindTrack(const FString& Name, FTrackConfiguration& OutConfiguration) const
+{
+	const FTrackConfiguration* Configuration = Tracks.Find(Name);
+	if (Configuration != nullptr)
+		OutConfiguration = *Configuration;
+	return Configuration != nullptr;
+}
+
+bool UModCatalog::FindChassi(const FString& Name, FChassiConfiguration& OutConfiguration) const
+{
+	const FChassiConfiguration* Configuration = Chassis.Find(Name);
+	if (Configuration != nullptr)
+		OutConfiguration = *Configuration;
+	return Configuration != nullptr;
+}
+
+bool UModCatalog::FindTire(const FString& Name, FTireConfiguration& OutConfiguration) const
+{
+	const FTireConfiguration* Configuration = Tires.Find(Name);
+	if (Configuration != nullptr)
+		OutConfiguration = *Configuration;
+	return Configuration != nullptr;
+}
+
+void UModCatalog::BeginDestroy()
+{
+	FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+
+	// Scan reads from the loaders
+	if (ScanFuture.IsValid())
+		ScanFuture.Wait();
+	Super::BeginDestroy();
+}
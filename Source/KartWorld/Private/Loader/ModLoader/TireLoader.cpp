@@ -2,6 +2,7 @@
 
 
 #include "Loader/ModLoader/TireLoader.h"
+#include "Loader/ModLoader/ModCatalog.h"
 
 DEFINE_LOG_CATEGORY(LogTireLoader);
 
@@ -95,6 +96,72 @@ bool UTireLoader::GetConfiguration(FString FilePath, FTireConfiguration &TireCon
     return true;
 }
 
+bool UTireLoader::FindMirror(const FModelData& Model, const FModelData& Other, FVector& Mirror)
+{
+	if (Model.Meshes.Num() == 0 || Model.Meshes.Num() != Other.Meshes.Num())
+		return false;
+
+	// Materials have to match as well, otherwise decals of one side would show up on the other
+	if (Model.MaterialReferences.Num() != Other.MaterialReferences.Num())
+		return false;
+	for (int32 MaterialIndex = 0; MaterialIndex < Model.MaterialReferences.Num(); MaterialIndex++)
+	{
+		if (Model.MaterialReferences[MaterialIndex].Name != Other.MaterialReferences[MaterialIndex].Name ||
+			Model.MaterialReferences[MaterialIndex].DiffusePath != Other.MaterialReferences[MaterialIndex].DiffusePath)
+			return false;
+	}
+
+	// Try identical copies first and then every axis, vertices have to be in the same order
+	for (int32 Axis = INDEX_NONE; Axis < 3; Axis++)
+	{
+		FVector3f Scale = FVector3f::OneVector;
+		if (Axis != INDEX_NONE)
+			Scale[Axis] = -1.0f;
+
+		bool bIsMirror = true;
+		for (int32 MeshIndex = 0; MeshIndex < Model.Meshes.Num() && bIsMirror; MeshIndex++)
+		{
+			const FMeshData& MeshData = Model.Meshes[MeshIndex];
+			const FMeshData& OtherMeshData = Other.Meshes[MeshIndex];
+			bIsMirror = MeshData.MaterialId == OtherMeshData.MaterialId &&
+				MeshData.LodData.Lod == OtherMeshData.LodData.Lod &&
+				MeshData.Positions.Num() == OtherMeshData.Positions.Num() &&
+				MeshData.Normals.Num() == OtherMeshData.Normals.Num() &&
+				MeshData.UV0.Num() == OtherMeshData.UV0.Num() &&
+				MeshData.Indices.Num() == OtherMeshData.Indices.Num();
+
+			for (int32 VertexIndex = 0; VertexIndex < MeshData.Positions.Num() && bIsMirror; VertexIndex++)
+				bIsMirror = (MeshData.Positions[VertexIndex] * Scale).Equals(OtherMeshData.Positions[VertexIndex], 0.01f);
+
+			for (int32 VertexIndex = 0; VertexIndex < MeshData.Normals.Num() && bIsMirror; VertexIndex++)
+				bIsMirror = (MeshData.Normals[VertexIndex] * Scale).Equals(OtherMeshData.Normals[VertexIndex], 0.01f);
+
+			// Texture coordinates don't change with the mirror
+			for (int32 VertexIndex = 0; VertexIndex < MeshData.UV0.Num() && bIsMirror; VertexIndex++)
+				bIsMirror = MeshData.UV0[VertexIndex].Equals(OtherMeshData.UV0[VertexIndex], 0.0001f);
+
+			// Copies have the same triangles, a correct mirror image has the winding of every triangle reversed
+			for (int32 Index = 0; Index + 2 < MeshData.Indices.Num() && bIsMirror; Index += 3)
+			{
+				const int32 A = MeshData.Indices[Index], B = MeshData.Indices[Index + 1], C = MeshData.Indices[Index + 2];
+				const int32 OtherA = OtherMeshData.Indices[Index], OtherB = OtherMeshData.Indices[Index + 1], OtherC = OtherMeshData.Indices[Index + 2];
+				if (Axis == INDEX_NONE)
+					bIsMirror = A == OtherA && B == OtherB && C == OtherC;
+				else
+					bIsMirror = (A == OtherA && C == OtherB && B == OtherC) || (C == OtherA && B == OtherB && A == OtherC) || (B == OtherA && A == OtherB && C == OtherC);
+			}
+		}
+
+		if (bIsMirror)
+		{
+			Mirror = FVector(Scale);
+			return true;
+		}
+	}
+
+	return false;
+}
+
 UTireLoader::UTireLoader()
 {
 }
@@ -112,6 +179,8 @@ void UTireLoader::Initialize(FString GameUserDir)
 FTireModel UTireLoader::Load(FString TireName)
 {
 	UE_LOG(LogTireLoader, Log, TEXT("Loading Tire %s - Please wait!"), *TireName);
+	double StartTime = FPlatformTime::Seconds();
+	FLoadSummary LoadSummary;
 
     if(TireName.IsEmpty()) {
         UE_LOG(LogTireLoader, Error, TEXT("Tire name is missing!"));
@@ -120,57 +189,88 @@ FTireModel UTireLoader::Load(FString TireName)
 
 	FString TireDir = FPaths::Combine(ModsDir, *TireName);
 
-	// When directory doesn't exist then return failure!
-	if (!FileManager.DirectoryExists(*TireDir))
+	// Load configuration, the catalog already parsed it when the mod is known
+	FTireConfiguration TireConfiguration;
+	bool bSuccess;
 	{
-		UE_LOG(LogTireLoader, Error, TEXT("Tire %s directory not found!"), *TireName);
-		return FTireModel();
-	}
-
-	FString IniFileName = FString(TireName + ".ini");
-	FString IniFilePath = FPaths::Combine(TireDir, IniFileName);
+		SCOPE_LOAD_STAGE(LoadSummary, Ini);
+		// When directory doesn't exist then return failure!
+		if (!FileManager.DirectoryExists(*TireDir))
+		{
+			UE_LOG(LogTireLoader, Error, TEXT("Tire %s directory not found!"), *TireName);
+			return FTireModel();
+		}
 
-	// Load configuration
-	FTireConfiguration TireConfiguration;
-	bool bSuccess = GetConfiguration(IniFilePath, TireConfiguration);
+		// Catalog already parsed the configuration, but the mod might have been removed since the last scan
+		bSuccess = Catalog != nullptr && Catalog->FindTire(TireName, TireConfiguration);
+		if (!bSuccess)
+		{
+			FString IniFileName = FString(TireName + ".ini");
+			FString IniFilePath = FPaths::Combine(TireDir, IniFileName);
+			bSuccess = GetConfiguration(IniFilePath, TireConfiguration);
+		}
+	}
 	if (!bSuccess)
 		return FTireModel();
 
-	// Load meshes
-	FString ModelPathFl = FPaths::Combine(TireDir, TireConfiguration.ModelFl);
-	FString ModelPathFr = FPaths::Combine(TireDir, TireConfiguration.ModelFr);
-	FString ModelPathRl = FPaths::Combine(TireDir, TireConfiguration.ModelRl);
-	FString ModelPathRr = FPaths::Combine(TireDir, TireConfiguration.ModelRr);
-	
-    FModelData ModelDataFl;
-    FModelData ModelDataFr;
-    FModelData ModelDataRl;
-    FModelData ModelDataRr;
+	// Load meshes, every model path only once
+	FTireModel TireModel(TireConfiguration);
+	TireModel.LoadSummary = LoadSummary;
+	TMap<FString, FTireCorner> LoadedCorners;
+	int32 NumShared = 0;
 	UMeshLoader *MeshLoader = NewObject<UMeshLoader>();
-	MeshLoader->LoadWorld(ModelPathFl, ModelDataFl);
-	MeshLoader->LoadWorld(ModelPathFr, ModelDataFr);
-	MeshLoader->LoadWorld(ModelPathRl, ModelDataRl);
-	MeshLoader->LoadWorld(ModelPathRr, ModelDataRr);
+
+	auto LoadCorner = [&](const FString& Model, FTireCorner& Corner)
+	{
+		FString ModelPath = FPaths::ConvertRelativePathToFull(FPaths::Combine(TireDir, Model));
+		if (const FTireCorner* LoadedCorner = LoadedCorners.Find(ModelPath))
+		{
+			Corner = *LoadedCorner;
+			return;
+		}
+
+		// Materials are only created for models which are kept
+		FModelData ModelData;
+		if (MeshLoader->ImportWorld(ModelPath, ModelData) == EMeshLoadingResult_OK)
+		{
+			// Left and right are usually the same model mirrored or copied, keep only one of them
+			for (int32 ModelIndex = 0; ModelIndex < TireModel.Models.Num() && Corner.ModelIndex == INDEX_NONE; ModelIndex++)
+			{
+				if (FindMirror(TireModel.Models[ModelIndex], ModelData, Corner.Mirror))
+				{
+					Corner.ModelIndex = ModelIndex;
+					NumShared++;
+				}
+			}
+
+			if (Corner.ModelIndex == INDEX_NONE)
+				MeshLoader->LoadMaterials(ModelPath, ModelData);
+		}
+		TireModel.LoadSummary.Append(ModelData.LoadSummary);
+
+		if (Corner.ModelIndex == INDEX_NONE)
+			Corner.ModelIndex = TireModel.Models.Add(MoveTemp(ModelData));
+		LoadedCorners.Add(ModelPath, Corner);
+	};
+
+	LoadCorner(TireConfiguration.ModelFl, TireModel.Fl);
+	LoadCorner(TireConfiguration.ModelFr, TireModel.Fr);
+	LoadCorner(TireConfiguration.ModelRl, TireModel.Rl);
+	LoadCorner(TireConfiguration.ModelRr, TireModel.Rr);
+
+	UE_LOG(LogTireLoader, Log, TEXT("Tire %s - %d unique models for 4 corners, %d shared by geometry!"), *TireName, TireModel.Models.Num(), NumShared);
+
+	TireModel.LoadSummary.TotalMilliseconds = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	TireModel.LoadSummary.Log(TireName);
 
 	UE_LOG(LogTireLoader, Log, TEXT("Tire %s was successful loaded!"), *TireName);
-	return FTireModel(TireConfiguration, ModelDataFl, ModelDataFr, ModelDataRl, ModelDataRr);
+	return TireModel;
 }
 
 FTireModel::FTireModel()
 {
 }
 
-FTireModel::FTireModel(
-    FTireConfiguration Configuration,
-		FModelData ModelFl,
-		FModelData ModelFr,
-		FModelData ModelRl,
-		FModelData ModelRr) : 
-        bSuccess(true), 
-        Configuration(Configuration), 
-        ModelFl(ModelFl), 
-        ModelFr(ModelFr), 
-        ModelRl(ModelRl), 
-        ModelRr(ModelRr)
+FTireModel::FTireModel(FTireConfiguration Configuration) : bSuccess(true), Configuration(Configuration)
 {
-}
\ No newline at end of file
+}
@@ -1,6 +1,7 @@
 // Copyright @ 2023 Fynn Haupt
 
 #include "Loader/ModLoader/TrackLoader.h"
+#include "Loader/ModLoader/ModCatalog.h"
 
 DEFINE_LOG_CATEGORY(LogTrackLoader);
 
@@ -135,13 +136,11 @@ void UTrackLoader::Initialize(FString GameUserDir)
 		FileManager.CreateDirectory(*ModsDir);
 }
 
-FTrackModel UTrackLoader::Load(FString TrackName)
+bool UTrackLoader::GetModelPath(FString TrackName, FTrackConfiguration& TrackConfiguration, FString& ModelPath)
 {
-	UE_LOG(LogTrackLoader, Log, TEXT("Loading Track %s - Please wait!"), *TrackName);
-
 	if(TrackName.IsEmpty()) {
         UE_LOG(LogTrackLoader, Error, TEXT("Track name is missing!"));
-		return FTrackModel();
+		return false;
     }
 
 	FString TrackDir = FPaths::Combine(ModsDir, *TrackName);
@@ -150,26 +149,100 @@ FTrackModel UTrackLoader::Load(FString TrackName)
 	if (!FileManager.DirectoryExists(*TrackDir))
 	{
 		UE_LOG(LogTrackLoader, Error, TEXT("Track %s directory not found!"), *TrackName);
-		return FTrackModel();
+		return false;
+	}
+
+	// Catalog already parsed the configuration, but the mod might have been removed since the last scan
+	if (Catalog != nullptr && Catalog->FindTrack(TrackName, TrackConfiguration))
+	{
+		ModelPath = FPaths::Combine(TrackDir, TrackConfiguration.Model);
+		return true;
 	}
 
 	FString IniFileName = FString(TrackName + ".ini");
 	FString IniFilePath = FPaths::Combine(TrackDir, IniFileName);
 
 	// Load configuration
+	if (!GetConfiguration(IniFilePath, TrackConfiguration))
+		return false;
+
+	ModelPath = FPaths::Combine(TrackDir, TrackConfiguration.Model);
+	return true;
+}
+
+FTrackModel UTrackLoader::Load(FString TrackName)
+{
+	UE_LOG(LogTrackLoader, Log, TEXT("Loading Track %s - Please wait!"), *TrackName);
+	double StartTime = FPlatformTime::Seconds();
+	FLoadSummary LoadSummary;
+
 	FTrackConfiguration TrackConfiguration;
-	bool bSuccess = GetConfiguration(IniFilePath, TrackConfiguration);
-	if (!bSuccess)
-		return FTrackModel();
+	FString ModelPath;
+	{
+		SCOPE_LOAD_STAGE(LoadSummary, Ini);
+		if (!GetModelPath(TrackName, TrackConfiguration, ModelPath))
+			return FTrackModel();
+	}
 
 	// Load mesh
-	FString ModelPath = FPaths::Combine(TrackDir, TrackConfiguration.Model);
 	FModelData ModelData;
 	UMeshLoader *MeshLoader = NewObject<UMeshLoader>();
 	MeshLoader->LoadWorld(ModelPath, ModelData);
 
+	FTrackModel TrackModel(TrackConfiguration, ModelData);
+	TrackModel.LoadSummary = LoadSummary;
+	TrackModel.LoadSummary.Append(ModelData.LoadSummary);
+	TrackModel.LoadSummary.TotalMilliseconds = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	TrackModel.LoadSummary.Log(TrackName);
+
 	UE_LOG(LogTrackLoader, Log, TEXT("Track %s was successful loaded!"), *TrackName);
-	return FTrackModel(TrackConfiguration, ModelData);
+	return TrackModel;
+}
+
+FMeshLoadHandlePtr UTrackLoader::LoadAsync(FString TrackName, FOnTrackLoaded OnLoaded, FOnMeshLoadProgress OnProgress)
+{
+	UE_LOG(LogTrackLoader, Log, TEXT("Loading Track %s in background!"), *TrackName);
+	double StartTime = FPlatformTime::Seconds();
+	FLoadSummary LoadSummary;
+
+	FTrackConfiguration TrackConfiguration;
+	FString ModelPath;
+	{
+		SCOPE_LOAD_STAGE(LoadSummary, Ini);
+		if (!GetModelPath(TrackName, TrackConfiguration, ModelPath))
+		{
+			FTrackModel FailedModel;
+			OnLoaded.ExecuteIfBound(EMeshLoadingResult_FAILED, FailedModel);
+			return nullptr;
+		}
+	}
+
+	// Load mesh
+	UMeshLoader *MeshLoader = NewObject<UMeshLoader>();
+	return MeshLoader->LoadWorldAsync(
+		ModelPath,
+		FOnMeshLoadCompleted::CreateLambda([TrackName, TrackConfiguration, OnLoaded, StartTime, LoadSummary](EMeshLoadingResult Result, FModelData& ModelData)
+		{
+			// Failed or cancelled import, the model is empty
+			if (Result != EMeshLoadingResult_OK)
+			{
+				if (Result != EMeshLoadingResult_CANCELLED)
+					UE_LOG(LogTrackLoader, Error, TEXT("Track %s can't be loaded!"), *TrackName);
+
+				FTrackModel FailedModel;
+				OnLoaded.ExecuteIfBound(Result, FailedModel);
+				return;
+			}
+
+			FTrackModel TrackModel(TrackConfiguration, MoveTemp(ModelData));
+			TrackModel.LoadSummary = LoadSummary;
+			TrackModel.LoadSummary.Append(TrackModel.Model.LoadSummary);
+			TrackModel.LoadSummary.TotalMilliseconds = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+			TrackModel.LoadSummary.Log(TrackName);
+			UE_LOG(LogTrackLoader, Log, TEXT("Track %s was successful loaded!"), *TrackName);
+			OnLoaded.ExecuteIfBound(Result, TrackModel);
+		}),
+		OnProgress);
 }
 
 FTrackModel::FTrackModel()
@@ -0,0 +1,238 @@
+// Copyright @ 2023 Fynn Haupt
+
+#include "Loader/ModelCache.h"
+#include "Async/MappedFileHandle.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/SecureHash.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+DEFINE_LOG_CATEGORY(LogModelCache);
+
+FString FModelCache::GetCachePath(const FString& SourcePath)
+{
+	return FPaths::ChangeExtension(SourcePath, TEXT("kwmesh"));
+}
+
+bool FModelCache::GetSourceStamp(const FString& SourcePath, FSourceStamp& OutStamp)
+{
+	FFileStatData StatData = IFileManager::Get().GetStatData(*SourcePath);
+	if (!StatData.bIsValid)
+		return false;
+
+	OutStamp.Size = StatData.FileSize;
+	OutStamp.Timestamp = StatData.ModificationTime;
+
+	// Lod data is baked into the cache as well
+	OutStamp.LodTimestamp = IFileManager::Get().GetTimeStamp(*FPaths::ChangeExtension(SourcePath, TEXT("lod")));
+	return true;
+}
+
+bool FModelCache::Load(const FString& SourcePath, bool bWorldSpace, FModelData& ModelData)
+{
+	FString CachePath = GetCachePath(SourcePath);
+	if (!FPaths::FileExists(CachePath))
+		return false;
+
+	FSourceStamp SourceStamp;
+	if (!GetSourceStamp(SourcePath, SourceStamp))
+		return false;
+
+	// Map the cache file, so the data is only copied once into the model
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	TUniquePtr<IMappedFileHandle> MappedHandle(PlatformFile.OpenMapped(*CachePath));
+	TUniquePtr<IMappedFileRegion> MappedRegion(MappedHandle.IsValid() ? MappedHandle->MapRegion() : nullptr);
+
+	// Not every platform supports mapping files
+	TArray64<uint8> FileArray;
+	TArrayView64<const uint8> CacheView;
+	if (MappedRegion.IsValid())
+	{
+		CacheView = TArrayView64<const uint8>(MappedRegion->GetMappedPtr(), MappedRegion->GetMappedSize());
+	}
+	else
+	{
+		if (!FFileHelper::LoadFileToArray(FileArray, *CachePath))
+			return false;
+		CacheView = FileArray;
+	}
+
+	FMemoryReaderView Reader(CacheView);
+
+	uint32 CacheMagic = 0;
+	uint32 CacheVersion = 0;
+	bool bCacheWorldSpace = false;
+	FSourceStamp CacheStamp;
+	Reader << CacheMagic;
+	Reader << CacheVersion;
+	Reader << bCacheWorldSpace;
+	Reader << CacheStamp.Size;
+	Reader << CacheStamp.Timestamp;
+	Reader << CacheStamp.LodTimestamp;
+	Reader << CacheStamp.Hash;
+	SerializeArray(Reader, CacheStamp.Dependencies);
+
+	if (Reader.IsError() || CacheMagic != Magic || CacheVersion != Version || bCacheWorldSpace != bWorldSpace)
+	{
+		UE_LOG(LogModelCache, Log, TEXT("%s - Cache is outdated!"), *CachePath);
+		return false;
+	}
+
+	if (CacheStamp.Size != SourceStamp.Size || CacheStamp.LodTimestamp != SourceStamp.LodTimestamp)
+	{
+		UE_LOG(LogModelCache, Log, TEXT("%s - Cache is outdated!"), *CachePath);
+		return false;
+	}
+
+	// Modification time can change without the content changing (eg. copied mods), so compare the hash in that case
+	bool bRefreshStamp = CacheStamp.Timestamp != SourceStamp.Timestamp;
+	if (bRefreshStamp && CacheStamp.Hash != FMD5Hash::HashFile(*SourcePath))
+	{
+		UE_LOG(LogModelCache, Log, TEXT("%s - Cache is outdated!"), *CachePath);
+		return false;
+	}
+
+	if (!AreDependenciesUpToDate(SourcePath, CacheStamp.Dependencies, bRefreshStamp))
+	{
+		UE_LOG(LogModelCache, Log, TEXT("%s - Cache is outdated!"), *CachePath);
+		return false;
+	}
+
+	Reader << ModelData;
+
+	if (Reader.IsError() || !IsValid(ModelData))
+	{
+		UE_LOG(LogModelCache, Warning, TEXT("%s - Cache is corrupt!"), *CachePath);
+		ModelData = FModelData();
+		return false;
+	}
+
+	UE_LOG(LogModelCache, Log, TEXT("%s - Loaded from cache!"), *CachePath);
+
+	// Store the new modification time, so the next load doesn't hash the source again
+	if (bRefreshStamp)
+	{
+		MappedRegion.Reset();
+		MappedHandle.Reset();
+		FileArray.Empty();
+		SourceStamp.Hash = CacheStamp.Hash;
+		SourceStamp.Dependencies = MoveTemp(CacheStamp.Dependencies);
+		Write(SourcePath, bWorldSpace, ModelData, SourceStamp);
+	}
+
+	return true;
+}
+
+bool FModelCache::AreDependenciesUpToDate(const FString& SourcePath, TArray<FDependencyStamp>& Dependencies, bool& bOutRefreshStamp)
+{
+	for (FDependencyStamp& Dependency : Dependencies)
+	{
+		FString DependencyPath = FPaths::IsRelative(Dependency.Path) ? FPaths::Combine(FPaths::GetPath(SourcePath), Dependency.Path) : Dependency.Path;
+		FFileStatData StatData = IFileManager::Get().GetStatData(*DependencyPath);
+		if (!StatData.bIsValid || StatData.FileSize != Dependency.Size)
+			return false;
+
+		if (StatData.ModificationTime == Dependency.Timestamp)
+			continue;
+
+		if (Dependency.Hash != FMD5Hash::HashFile(*DependencyPath))
+			return false;
+
+		Dependency.Timestamp = StatData.ModificationTime;
+		bOutRefreshStamp = true;
+	}
+
+	return true;
+}
+
+bool FModelCache::IsValid(const FModelData& ModelData)
+{
+	for (const FMeshData& MeshData : ModelData.Meshes)
+	{
+		if (!ModelData.MaterialReferences.IsValidIndex(MeshData.MaterialId) || MeshData.Indices.Num() % 3 != 0)
+			return false;
+
+		// Every stream has one element per vertex or is empty
+		const int32 NumVertices = MeshData.NumVertices();
+		for (int32 Num : { MeshData.Normals.Num(), MeshData.Tangents.Num(), MeshData.Colors.Num(), MeshData.UV0.Num(), MeshData.UV1.Num(), MeshData.UV2.Num(), MeshData.UV3.Num() })
+			if (Num != 0 && Num != NumVertices)
+				return false;
+
+		// Indices outside of the vertices would read past the streams later on
+		for (int32 Index : MeshData.Indices)
+			if (Index < 0 || Index >= NumVertices)
+				return false;
+	}
+
+	return IsValid(ModelData.NodeHierarchy, ModelData.Meshes.Num());
+}
+
+bool FModelCache::IsValid(const FNodeData& NodeData, int32 NumMeshes)
+{
+	for (int32 MeshIndex : NodeData.Meshes)
+		if (MeshIndex < 0 || MeshIndex >= NumMeshes)
+			return false;
+
+	for (const FNodeData& ChildData : NodeData.Nodes)
+		if (!IsValid(ChildData, NumMeshes))
+			return false;
+
+	return true;
+}
+
+bool FModelCache::Save(const FString& SourcePath, bool bWorldSpace, FModelData& ModelData, const TArray<FString>& Dependencies)
+{
+	FSourceStamp SourceStamp;
+	if (!GetSourceStamp(SourcePath, SourceStamp))
+		return false;
+	SourceStamp.Hash = FMD5Hash::HashFile(*SourcePath);
+
+	for (const FString& DependencyPath : Dependencies)
+	{
+		FFileStatData StatData = IFileManager::Get().GetStatData(*DependencyPath);
+		if (!StatData.bIsValid)
+			continue;
+
+		FDependencyStamp& Dependency = SourceStamp.Dependencies.AddDefaulted_GetRef();
+		Dependency.Path = DependencyPath;
+		FPaths::MakePathRelativeTo(Dependency.Path, *(FPaths::GetPath(SourcePath) / TEXT("")));
+		Dependency.Size = StatData.FileSize;
+		Dependency.Timestamp = StatData.ModificationTime;
+		Dependency.Hash = FMD5Hash::HashFile(*DependencyPath);
+	}
+
+	return Write(SourcePath, bWorldSpace, ModelData, SourceStamp);
+}
+
+bool FModelCache::Write(const FString& SourcePath, bool bWorldSpace, FModelData& ModelData, FSourceStamp& SourceStamp)
+{
+	FString CachePath = GetCachePath(SourcePath);
+
+	TArray<uint8> CacheArray;
+	FMemoryWriter Writer(CacheArray);
+
+	uint32 CacheMagic = Magic;
+	uint32 CacheVersion = Version;
+	Writer << CacheMagic;
+	Writer << CacheVersion;
+	Writer << bWorldSpace;
+	Writer << SourceStamp.Size;
+	Writer << SourceStamp.Timestamp;
+	Writer << SourceStamp.LodTimestamp;
+	Writer << SourceStamp.Hash;
+	SerializeArray(Writer, SourceStamp.Dependencies);
+	Writer << ModelData;
+
+	// Write to a temporary file first, so a concurrent load never sees a half written cache
+	// Name is unique, so other processes writing the same cache don't write into the same file
+	FString TempPath = FPaths::CreateTempFilename(*FPaths::GetPath(CachePath), *FPaths::GetCleanFilename(CachePath), TEXT(".tmp"));
+	if (!FFileHelper::SaveArrayToFile(CacheArray, *TempPath) || !IFileManager::Get().Move(*CachePath, *TempPath))
+	{
+		UE_LOG(LogModelCache, Warning, TEXT("%s - Cache can't be written!"), *CachePath);
+		IFileManager::Get().Delete(*TempPath);
+		return false;
+	}
+
+	UE_LOG(LogModelCache, Log, TEXT("%s - Cache was written!"), *CachePath);
+	return true;
+}
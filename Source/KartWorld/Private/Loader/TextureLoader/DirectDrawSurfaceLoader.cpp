@@ -2,9 +2,22 @@
 
 
 #include "Loader/TextureLoader/DirectDrawSurfaceLoader.h"
+#include "Loader/TextureLoader/PixelConverter.h"
+#include "Loader/TextureLoader/TexturePack.h"
+#include "HAL/PlatformFileManager.h"
+#include "Engine/TextureCube.h"
+#include "Engine/Texture2DArray.h"
+#include "Async/MappedFileHandle.h"
+#include "RenderingThread.h"
 
 DEFINE_LOG_CATEGORY(LogDirectDrawLoader);
 
+static TAutoConsoleVariable<int32> CVarTexturesMaxSize(
+	TEXT("kw.Textures.MaxSize"),
+	8192,
+	TEXT("Largest mip that gets loaded from DDS files, larger mips are skipped. Lower it on machines with little video memory."),
+	ECVF_Default);
+
 uint32 UDirectDrawSurfaceLoader::BitsPerPixel(DXGI_FORMAT Format)
 {
 	switch (Format)
@@ -419,8 +432,29 @@ DXGI_FORMAT UDirectDrawSurfaceLoader::GetDxgiFormat(const DDS_PIXELFORMAT& ddpf)
 
 EPixelFormat UDirectDrawSurfaceLoader::GetPixelFormat(DXGI_FORMAT Format)
 {
-	// TODO: Add other formats
 	switch (Format) {
+	case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+		return PF_R8G8B8A8;
+	case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+		return PF_B8G8R8A8;
+	case DXGI_FORMAT_R8_UNORM:
+		return PF_G8;
+	case DXGI_FORMAT_A8_UNORM:
+		return PF_A8;
+	case DXGI_FORMAT_R8G8_UNORM:
+		return PF_R8G8;
+	case DXGI_FORMAT_R16_UNORM:
+		return PF_G16;
+	case DXGI_FORMAT_R16G16_UNORM:
+		return PF_G16R16;
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+		return PF_FloatRGBA;
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		return PF_A32B32G32R32F;
 	case DXGI_FORMAT_BC1_TYPELESS:
 	case DXGI_FORMAT_BC1_UNORM:
 	case  DXGI_FORMAT_BC1_UNORM_SRGB:
@@ -742,7 +776,10 @@ EErrorCode UDirectDrawSurfaceLoader::GetResourceDimension(
 
 	Format = GetDxgiFormat(Header.ddspf);
 
-	if (Format == DXGI_FORMAT_UNKNOWN) {
+	// Legacy formats without DXGI equivalent get converted on the CPU
+	bool bLegacyConversion = FPixelConverter::GetLegacyConversion(Header.ddspf) != EPixelConversion_NONE;
+
+	if (Format == DXGI_FORMAT_UNKNOWN && !bLegacyConversion) {
 		UE_LOG(LogDirectDrawLoader, Error, TEXT("%s.%s - File format not supported!"), *TextureName, *TextureExtension);
 		return EErrorCode_NOTSUPPORTED;
 	}
@@ -768,7 +805,7 @@ EErrorCode UDirectDrawSurfaceLoader::GetResourceDimension(
 		// Note there's no way for a legacy Direct3D 9 DDS to express a '1D' texture
 	}
 
-	if (BitsPerPixel(Format) == 0) {
+	if (BitsPerPixel(Format) == 0 && !bLegacyConversion) {
 		UE_LOG(LogDirectDrawLoader, Error, TEXT("%s.%s - File format not supported!"), *TextureName, *TextureExtension);
 		return EErrorCode_NOTSUPPORTED;
 	}
@@ -832,7 +869,73 @@ EErrorCode UDirectDrawSurfaceLoader::IsResourceDimensionSupported(
 	return EErrorCode_OK;
 }
 
+void UDirectDrawSurfaceLoader::ReleasePlatformData()
+{
+	delete PlatformData;
+	PlatformData = nullptr;
+	delete ParsedMip;
+	ParsedMip = nullptr;
+}
+
+void UDirectDrawSurfaceLoader::BeginDestroy()
+{
+	ReleasePlatformData();
+	Super::BeginDestroy();
+}
+
 EErrorCode UDirectDrawSurfaceLoader::LoadTexture(FString FilePath)
+{
+	EErrorCode ErrorCode = ParseTexture(FilePath, 0);
+	if (ErrorCode != EErrorCode_OK)
+		return ErrorCode;
+	return CreateTextures();
+}
+
+uint32 UDirectDrawSurfaceLoader::GetMaxMipSize(uint32 MaxResolution, bool bIsStreamable) const
+{
+	uint32 MaxMipSize = FMath::Min((uint32)MaxSize, (uint32)FMath::Max(1, CVarTexturesMaxSize.GetValueOnAnyThread()));
+	if (MaxResolution > 0 && bIsStreamable)
+		MaxMipSize = FMath::Min(MaxMipSize, MaxResolution);
+	return MaxMipSize;
+}
+
+EErrorCode UDirectDrawSurfaceLoader::ParsePackedTexture(const FTexturePack& Pack, const FTexturePackEntry& Entry, uint32 MaxResolution)
+{
+	FPaths::Split(Entry.Path, TextureFolder, TextureName, TextureExtension);
+
+	// Reset everything
+	ReleasePlatformData();
+	Layout = FTextureFileLayout();
+	NumFileMips = Entry.NumFileMips;
+	NumSkippedMips = 0;
+
+	if (Entry.Mips.Num() == 0 || (uint32)Entry.Mips.Num() > NumFileMips)
+		return EErrorCode_CORRUPT;
+
+	// Skip mips above the size limit, the smallest mip is always kept
+	uint32 MaxMipSize = GetMaxMipSize(MaxResolution, Entry.NumSlices == 1 && !Entry.bIsCubeMap);
+	int32 FirstMip = 0;
+	while (FirstMip + 1 < Entry.Mips.Num() && (uint32)FMath::Max(Entry.Mips[FirstMip].SizeX, Entry.Mips[FirstMip].SizeY) > MaxMipSize)
+		FirstMip++;
+
+	PlatformData = Pack.ReadPlatformData(Entry, FirstMip);
+	if (PlatformData == nullptr)
+		return EErrorCode_FAILED;
+
+	// Pack might already hold less mips than the file
+	NumSkippedMips = (NumFileMips - (uint32)Entry.Mips.Num()) + (uint32)FirstMip;
+
+	if (Entry.NumSlices == 1 && !Entry.bIsCubeMap) {
+		Layout.FilePath = Pack.GetPackPath();
+		Layout.FileSize = Pack.GetPackSize();
+		Layout.PixelFormat = (EPixelFormat)Entry.PixelFormat;
+		Layout.Mips.SetNum((int32)(NumFileMips - (uint32)Entry.Mips.Num()));
+		Layout.Mips.Append(Entry.Mips);
+	}
+	return EErrorCode_OK;
+}
+
+EErrorCode UDirectDrawSurfaceLoader::ParseTexture(FString FilePath, uint32 MaxResolution)
 {
 	// Split file path into components
 	FPaths::Split(FilePath, TextureFolder, TextureName, TextureExtension);
@@ -841,8 +944,11 @@ EErrorCode UDirectDrawSurfaceLoader::LoadTexture(FString FilePath)
 
 	// Reset everything
 	ReadOffset = 0;
-	TextureArray.Empty();
 	FileArray.Empty();
+	ReleasePlatformData();
+	Layout = FTextureFileLayout();
+	NumFileMips = 0;
+	NumSkippedMips = 0;
 
 	// Check weather file exists.
 	if (!FPaths::FileExists(FilePath)) {
@@ -850,15 +956,25 @@ EErrorCode UDirectDrawSurfaceLoader::LoadTexture(FString FilePath)
 		return EErrorCode_NOFILE;
 	}
 
-	// Load file
-	if (!FFileHelper::LoadFileToArray(FileArray, *FilePath))
-	{
-		UE_LOG(LogDirectDrawLoader, Error, TEXT("%s.%s - Failed to load file!"), *TextureName, *TextureExtension);
-		return EErrorCode_FAILED;
+	// Map file, so the mips can be copied straight from the page cache
+	TUniquePtr<IMappedFileHandle> MappedFile(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*FilePath));
+	TUniquePtr<IMappedFileRegion> MappedRegion(MappedFile.IsValid() ? MappedFile->MapRegion() : nullptr);
+
+	if (MappedRegion.IsValid()) {
+		FileSize = MappedRegion->GetMappedSize();
+		FileBuffer = (uint8*)MappedRegion->GetMappedPtr();
 	}
+	else {
+		// Platform can't map files, fall back to reading it
+		if (!FFileHelper::LoadFileToArray(FileArray, *FilePath))
+		{
+			UE_LOG(LogDirectDrawLoader, Error, TEXT("%s.%s - Failed to load file!"), *TextureName, *TextureExtension);
+			return EErrorCode_FAILED;
+		}
 
-	FileSize = FileArray.Num();
-	FileBuffer = FileArray.GetData();
+		FileSize = FileArray.Num();
+		FileBuffer = FileArray.GetData();
+	}
 
 	// Check weather size is correct
 	if ((FileSize > UINT32_MAX) || (FileSize < (sizeof(uint32) + sizeof(DDS_HEADER))))
@@ -877,8 +993,8 @@ EErrorCode UDirectDrawSurfaceLoader::LoadTexture(FString FilePath)
 		return EErrorCode_CORRUPT;
 
 	// Image data
-	uint32 BitSize = FileSize - ReadOffset;
-	uint8* BitData = FileBuffer + ReadOffset;
+	uint32 BitSize = (uint32)(FileSize - ReadOffset);
+	const uint8* BitData = FileBuffer + ReadOffset;
 
 	// Texture Data
 	uint16 BaseWidth = Header.width;
@@ -904,8 +1020,8 @@ EErrorCode UDirectDrawSurfaceLoader::LoadTexture(FString FilePath)
 		return EErrorCode_NOTSUPPORTED;
 	}
 
-	// TODO: Cube Support
-	if (bIsCubeMap) {
+	// Cube map arrays are not supported
+	if (bIsCubeMap && ArraySize != 6) {
 		UE_LOG(LogDirectDrawLoader, Error, TEXT("%s.%s - File format not supported!"), *TextureName, *TextureExtension);
 		return EErrorCode_NOTSUPPORTED;
 	}
@@ -920,7 +1036,14 @@ EErrorCode UDirectDrawSurfaceLoader::LoadTexture(FString FilePath)
 
 	EPixelFormat PixelFormat = GetPixelFormat(Format);
 
-	// TODO: Add support for more formats
+	// Formats the RHI can't sample get converted to B8G8R8A8
+	EPixelConversion Conversion = EPixelConversion_NONE;
+	if (PixelFormat == PF_Unknown) {
+		Conversion = Format == DXGI_FORMAT_UNKNOWN ? FPixelConverter::GetLegacyConversion(Header.ddspf) : FPixelConverter::GetConversion(Format);
+		if (Conversion != EPixelConversion_NONE)
+			PixelFormat = PF_B8G8R8A8;
+	}
+
 	if (PixelFormat == PF_Unknown) {
 		UE_LOG(LogDirectDrawLoader, Error, TEXT("%s.%s - File format not supported!"), *TextureName, *TextureExtension);
 		return EErrorCode_NOTSUPPORTED;
@@ -930,67 +1053,289 @@ EErrorCode UDirectDrawSurfaceLoader::LoadTexture(FString FilePath)
 	uint32 RowBytes = 0;
 	uint32 NumRows = 0;
 
-	TextureArray.SetNum(ArraySize);
-	uint8* SrcBits = BitData;
-	uint32 SrcSize = BitSize;
-	for (uint32 ArrayIndex = 0; ArrayIndex < ArraySize; ArrayIndex++)
+	// Palette follows the header
+	uint32 Palette[256];
+	if (Conversion == EPixelConversion_PAL8) {
+		if (BitSize < sizeof(Palette)) {
+			UE_LOG(LogDirectDrawLoader, Error, TEXT("%s.%s - File is corrupt!"), *TextureName, *TextureExtension);
+			return EErrorCode_CORRUPT;
+		}
+
+		FPixelConverter::ConvertPalette(BitData, Palette);
+		BitData += sizeof(Palette);
+		BitSize -= sizeof(Palette);
+	}
+
+	// DDS stores all mips of a slice after each other, slices follow each other
+	TArray<uint64> MipOffsets;
+	TArray<uint64> MipSizes;
+	TArray<FIntVector> MipDimensions;
+	uint64 SliceSize = 0;
+
+	uint16 TextureWidth = BaseWidth;
+	uint16 TextureHeight = BaseHeight;
+	uint16 TextureDepth = BaseDepth;
+	for (uint32 MipLevel = 0; MipLevel < MipCount; MipLevel++)
 	{
-		uint16 TextureWidth = BaseWidth;
-		uint16 TextureHeight = BaseHeight;
-		uint16 TextureDepth = BaseDepth;
-		UTexture2D* Texture = UTexture2D::CreateTransient(TextureWidth, TextureHeight, PixelFormat, FName(TextureName));
-		Texture->CompressionNone = true;
-		Texture->UpdateResource();
-
-		for (uint32 MipLevel = 0; MipLevel < MipCount; MipLevel++)
-		{
+		if (Conversion != EPixelConversion_NONE)
+			NumBytes = FPixelConverter::GetSourceRowBytes(Conversion, TextureWidth) * TextureHeight;
+		else
 			GetSurfaceData(TextureWidth, TextureHeight, Format, NumBytes, RowBytes, NumRows);
-			//UE_LOG(LogDirectDrawLoader, Log, TEXT("%d, %d, %d"), MipLevel, TextureWidth, TextureHeight);
 
-			if (MipLevel == 0) {
-				FTexture2DMipMap& Mip = Texture->GetPlatformData()->Mips[0];
+		MipOffsets.Add(SliceSize);
+		MipSizes.Add((uint64)NumBytes);
+		MipDimensions.Add(FIntVector(TextureWidth, TextureHeight, TextureDepth));
+		SliceSize += (uint64)NumBytes * TextureDepth;
 
-				Mip.BulkData.Lock(LOCK_READ_WRITE);
-				Mip.BulkData.Realloc((int64)NumBytes);
-				Mip.BulkData.Unlock();
+		// Each mip map size gets smaller by multiplier 0.5
+		TextureWidth = TextureWidth >> 1;
+		TextureHeight = TextureHeight >> 1;
+		TextureDepth = TextureDepth >> 1;
 
-				void* Data = Mip.BulkData.Lock(LOCK_READ_WRITE);
-				FMemory::Memcpy(Data, SrcBits, (int64)NumBytes);
-				Mip.BulkData.Unlock();
-			}
-			else {
-				FTexture2DMipMap* Mip = new FTexture2DMipMap(TextureWidth, TextureHeight, TextureDepth);
-				Texture->GetPlatformData()->Mips.Add(Mip);
+		// Parameters can't be 0!
+		if (TextureWidth == 0) TextureWidth = 1;
+		if (TextureHeight == 0) TextureHeight = 1;
+		if (TextureDepth == 0) TextureDepth = 1;
+	}
 
-				Mip->BulkData.Lock(LOCK_READ_WRITE);
-				Mip->BulkData.Realloc((int64)NumBytes);
-				Mip->BulkData.Unlock();
+	if (SliceSize * ArraySize > BitSize) {
+		UE_LOG(LogDirectDrawLoader, Error, TEXT("%s.%s - File is corrupt!"), *TextureName, *TextureExtension);
+		return EErrorCode_CORRUPT;
+	}
 
-				void* Data = Mip->BulkData.Lock(LOCK_READ_WRITE);
-				FMemory::Memcpy(Data, SrcBits, (int64)NumBytes);
-				Mip->BulkData.Unlock();
-			}
+	// Skip mips above the size limit, the smallest mip is always kept
+	uint32 MaxMipSize = GetMaxMipSize(MaxResolution, ArraySize == 1 && !bIsCubeMap);
 
-			// Add offset for next map
-			SrcBits += NumBytes * TextureDepth;
-			SrcSize -= NumBytes * TextureDepth;
+	uint32 FirstMip = 0;
+	while (FirstMip + 1 < MipCount && (uint32)FMath::Max(MipDimensions[FirstMip].X, MipDimensions[FirstMip].Y) > MaxMipSize)
+		FirstMip++;
 
-			// Each mip map size gets smaller by multiplier 0.5
-			TextureWidth = TextureWidth >> 1;
-			TextureHeight = TextureHeight >> 1;
-			TextureDepth = TextureDepth >> 1;
+	NumFileMips = MipCount;
+	NumSkippedMips = FirstMip;
 
-			// Parameters can't be 0!
-			if (TextureWidth == 0) TextureWidth = 1;
-			if (TextureHeight == 0) TextureHeight = 1;
-			if (TextureDepth == 0) TextureDepth = 1;
+	// Fill the platform data before the resource exists, so it only gets created once
+	PlatformData = new FTexturePlatformData();
+	PlatformData->SizeX = MipDimensions[FirstMip].X;
+	PlatformData->SizeY = MipDimensions[FirstMip].Y;
+	PlatformData->SetNumSlices((int32)ArraySize);
+	PlatformData->SetIsCubemap(bIsCubeMap);
+	PlatformData->PixelFormat = PixelFormat;
+
+	for (uint32 MipLevel = FirstMip; MipLevel < MipCount; MipLevel++)
+	{
+		// Cube faces are addressed by the resource, array slices are the depth of the mip
+		int32 MipDepth = ArraySize > 1 && !bIsCubeMap ? (int32)ArraySize : 1;
+		FTexture2DMipMap* Mip = new FTexture2DMipMap(MipDimensions[MipLevel].X, MipDimensions[MipLevel].Y, MipDepth);
+		PlatformData->Mips.Add(Mip);
+
+		// One allocation per mip and one copy or conversion per slice
+		uint64 MipSize = MipSizes[MipLevel];
+		uint64 DstMipSize = Conversion != EPixelConversion_NONE ? (uint64)MipDimensions[MipLevel].X * MipDimensions[MipLevel].Y * 4 : MipSize;
+		Mip->BulkData.Lock(LOCK_READ_WRITE);
+		uint8* Data = (uint8*)Mip->BulkData.Realloc((int64)(DstMipSize * ArraySize));
+		for (uint32 ArrayIndex = 0; ArrayIndex < ArraySize; ArrayIndex++) {
+			const uint8* SrcMip = BitData + SliceSize * ArrayIndex + MipOffsets[MipLevel];
+			if (Conversion != EPixelConversion_NONE)
+				FPixelConverter::Convert(Conversion, SrcMip, Data + DstMipSize * ArrayIndex, MipDimensions[MipLevel].X, MipDimensions[MipLevel].Y, Palette);
+			else
+				FMemory::Memcpy(Data + DstMipSize * ArrayIndex, SrcMip, (int64)MipSize);
 		}
+		Mip->BulkData.Unlock();
+	}
 
-		Texture->UpdateResource();
-		TextureArray[ArrayIndex] = Texture;
+	// Streaming reads single mips later on
+	if (ArraySize == 1 && !bIsCubeMap) {
+		Layout.FilePath = FilePath;
+		Layout.FileSize = FileSize;
+		Layout.PixelFormat = PixelFormat;
+		Layout.Conversion = Conversion;
+		if (Conversion == EPixelConversion_PAL8)
+			Layout.Palette = TArray<uint32>(Palette, UE_ARRAY_COUNT(Palette));
+
+		for (uint32 MipLevel = 0; MipLevel < MipCount; MipLevel++) {
+			FTexturePackMip& LayoutMip = Layout.Mips.AddDefaulted_GetRef();
+			LayoutMip.SizeX = MipDimensions[MipLevel].X;
+			LayoutMip.SizeY = MipDimensions[MipLevel].Y;
+			LayoutMip.SizeZ = 1;
+			LayoutMip.Offset = (int64)(BitData - FileBuffer) + (int64)MipOffsets[MipLevel];
+			LayoutMip.Size = (int64)MipSizes[MipLevel];
+		}
 	}
 
-	if (TextureArray.Num() == 0)
+	// Release the file
+	FileBuffer = nullptr;
+	FileArray.Empty();
+
+	return EErrorCode_OK;
+}
+
+EErrorCode UDirectDrawSurfaceLoader::CreateTextures()
+{
+	check(IsInGameThread());
+
+	TextureArray.Empty();
+	if (PlatformData == nullptr)
 		return EErrorCode_FAILED;
+
+	// Pick texture type by the layout of the file
+	UTexture* Texture;
+	if (PlatformData->IsCubemap()) {
+		FName TextureObjectName = MakeUniqueObjectName(GetTransientPackage(), UTextureCube::StaticClass(), FName(TextureName));
+		UTextureCube* TextureCube = NewObject<UTextureCube>(GetTransientPackage(), TextureObjectName, RF_Transient);
+		TextureCube->SetPlatformData(PlatformData);
+		Texture = TextureCube;
+	}
+	else if (PlatformData->GetNumSlices() > 1) {
+		FName TextureObjectName = MakeUniqueObjectName(GetTransientPackage(), UTexture2DArray::StaticClass(), FName(TextureName));
+		UTexture2DArray* TextureArray2D = NewObject<UTexture2DArray>(GetTransientPackage(), TextureObjectName, RF_Transient);
+		TextureArray2D->SetPlatformData(PlatformData);
+		Texture = TextureArray2D;
+	}
+	else {
+		FName TextureObjectName = MakeUniqueObjectName(GetTransientPackage(), UTexture2D::StaticClass(), FName(TextureName));
+		UTexture2D* Texture2D = NewObject<UTexture2D>(GetTransientPackage(), TextureObjectName, RF_Transient);
+		Texture2D->SetPlatformData(PlatformData);
+		Texture = Texture2D;
+	}
+
+	// Texture owns the platform data now
+	PlatformData = nullptr;
+
+	// Same as UTexture2D::CreateTransient, there is no bulk data on disk the streamer could load mips from
+	Texture->NeverStream = true;
+	Texture->CompressionNone = true;
+	Texture->UpdateResource();
+	TextureArray.Add(Texture);
+	return EErrorCode_OK;
+}
+
+EErrorCode UDirectDrawSurfaceLoader::ParseMip(const FTextureFileLayout& FileLayout, uint32 MipLevel)
+{
+	ReleasePlatformData();
+
+	if (!FileLayout.Mips.IsValidIndex((int32)MipLevel) || FileLayout.Mips[MipLevel].Size == 0)
+		return EErrorCode_OVERFLOW;
+
+	const FTexturePackMip& SourceMip = FileLayout.Mips[MipLevel];
+	if ((uint32)FMath::Max(SourceMip.SizeX, SourceMip.SizeY) > GetMaxMipSize(0, true))
+		return EErrorCode_OVERFLOW;
+
+	// Only the mip is read, the header was interpreted by the first parse
+	TUniquePtr<IFileHandle> FileHandle(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*FileLayout.FilePath));
+	if (!FileHandle.IsValid()) {
+		UE_LOG(LogDirectDrawLoader, Error, TEXT("%s - Doesn't exist!"), *FileLayout.FilePath);
+		return EErrorCode_NOFILE;
+	}
+
+	// File was replaced since it was parsed
+	if (FileHandle->Size() != FileLayout.FileSize || SourceMip.Offset + SourceMip.Size > FileLayout.FileSize) {
+		UE_LOG(LogDirectDrawLoader, Warning, TEXT("%s - File changed since it was loaded!"), *FileLayout.FilePath);
+		return EErrorCode_CORRUPT;
+	}
+
+	ParsedMip = new FTexture2DMipMap(SourceMip.SizeX, SourceMip.SizeY, 1);
+
+	bool bRead = FileHandle->Seek(SourceMip.Offset);
+	ParsedMip->BulkData.Lock(LOCK_READ_WRITE);
+	if (FileLayout.Conversion != EPixelConversion_NONE) {
+		TArray64<uint8> Source;
+		Source.SetNumUninitialized(SourceMip.Size);
+		bRead = bRead && FileHandle->Read(Source.GetData(), SourceMip.Size);
+		uint8* Data = (uint8*)ParsedMip->BulkData.Realloc((int64)SourceMip.SizeX * SourceMip.SizeY * 4);
+		if (bRead)
+			FPixelConverter::Convert(FileLayout.Conversion, Source.GetData(), Data, SourceMip.SizeX, SourceMip.SizeY, FileLayout.Palette.GetData());
+	}
+	else {
+		bRead = bRead && FileHandle->Read((uint8*)ParsedMip->BulkData.Realloc(SourceMip.Size), SourceMip.Size);
+	}
+	ParsedMip->BulkData.Unlock();
+
+	if (!bRead) {
+		UE_LOG(LogDirectDrawLoader, Error, TEXT("%s - Failed to load file!"), *FileLayout.FilePath);
+		ReleasePlatformData();
+		return EErrorCode_FAILED;
+	}
+
+	NumFileMips = (uint32)FileLayout.Mips.Num();
+	NumSkippedMips = MipLevel;
+	return EErrorCode_OK;
+}
+
+// Swaps the RHI texture of the resource for one with the mips of the platform data.
+// Mips both textures have are copied on the GPU, only a new top mip is uploaded. Nothing waits for the render thread.
+static void ResizeTextureResource(UTexture2D* Texture, TArray64<uint8>&& TopMipData)
+{
+	FTextureResource* Resource = Texture->GetResource();
+	const FTexturePlatformData* PlatformData = Texture->GetPlatformData();
+	if (Resource == nullptr)
+		return;
+
+	ENQUEUE_RENDER_COMMAND(ResizeKartWorldTexture)(
+		[Resource, SizeX = (uint32)PlatformData->SizeX, SizeY = (uint32)PlatformData->SizeY, NumMips = (uint8)PlatformData->Mips.Num(), PixelFormat = PlatformData->PixelFormat, TopMipData = MoveTemp(TopMipData)](FRHICommandListImmediate& RHICmdList)
+	{
+		FRHITexture* OldTexture = Resource->GetTextureRHI();
+		if (OldTexture == nullptr)
+			return;
+
+		const FRHITextureCreateDesc Desc = FRHITextureCreateDesc::Create2D(TEXT("KartWorldStreamedTexture"), SizeX, SizeY, PixelFormat)
+			.SetNumMips(NumMips)
+			.SetFlags(OldTexture->GetFlags())
+			.SetInitialState(ERHIAccess::SRVMask);
+		FTextureRHIRef NewTexture = RHICreateTexture(Desc);
+
+		RHICmdList.CopySharedMips(NewTexture, OldTexture);
+
+		if (TopMipData.Num() > 0) {
+			const FPixelFormatInfo& FormatInfo = GPixelFormats[PixelFormat];
+			const uint32 Pitch = FMath::DivideAndRoundUp(SizeX, (uint32)FormatInfo.BlockSizeX) * FormatInfo.BlockBytes;
+			RHIUpdateTexture2D(NewTexture, 0, FUpdateTextureRegion2D(0, 0, 0, 0, SizeX, SizeY), Pitch, TopMipData.GetData());
+		}
+
+		Resource->TextureRHI = NewTexture;
+		RHICmdList.UpdateTextureReference(Resource->TextureReferenceRHI, NewTexture);
+	});
+}
+
+EErrorCode UDirectDrawSurfaceLoader::UpdateTexture(UTexture2D* Texture)
+{
+	check(IsInGameThread());
+
+	FTexturePlatformData* TexturePlatformData = Texture != nullptr ? Texture->GetPlatformData() : nullptr;
+	if (ParsedMip == nullptr || TexturePlatformData == nullptr || TexturePlatformData->Mips.Num() == 0)
+		return EErrorCode_FAILED;
+
+	// Has to be the mip right above the current top mip
+	const FTexture2DMipMap& TopMip = TexturePlatformData->Mips[0];
+	if (FMath::Max(1, ParsedMip->SizeX >> 1) != TopMip.SizeX || FMath::Max(1, ParsedMip->SizeY >> 1) != TopMip.SizeY)
+		return EErrorCode_FAILED;
+
+	// Render thread gets its own copy, the platform data keeps the mip for recreating the resource
+	TArray64<uint8> TopMipData;
+	TopMipData.Append((const uint8*)ParsedMip->BulkData.LockReadOnly(), ParsedMip->BulkData.GetBulkDataSize());
+	ParsedMip->BulkData.Unlock();
+
+	TexturePlatformData->Mips.Insert(ParsedMip, 0);
+	TexturePlatformData->SizeX = ParsedMip->SizeX;
+	TexturePlatformData->SizeY = ParsedMip->SizeY;
+	ParsedMip = nullptr;
+
+	ResizeTextureResource(Texture, MoveTemp(TopMipData));
+	return EErrorCode_OK;
+}
+
+EErrorCode UDirectDrawSurfaceLoader::DropMips(UTexture2D* Texture, uint32 NumMips)
+{
+	check(IsInGameThread());
+
+	FTexturePlatformData* TexturePlatformData = Texture != nullptr ? Texture->GetPlatformData() : nullptr;
+	if (TexturePlatformData == nullptr || NumMips == 0 || (int32)NumMips >= TexturePlatformData->Mips.Num())
+		return EErrorCode_FAILED;
+
+	// Render thread only reads the mips when the resource is created
+	TexturePlatformData->Mips.RemoveAt(0, (int32)NumMips);
+	TexturePlatformData->SizeX = TexturePlatformData->Mips[0].SizeX;
+	TexturePlatformData->SizeY = TexturePlatformData->Mips[0].SizeY;
+
+	ResizeTextureResource(Texture, TArray64<uint8>());
 	return EErrorCode_OK;
 }
@@ -0,0 +1,392 @@
+// Copyright @ 2023 Fynn Haupt
+
+
+#include "Loader/TextureLoader/PixelConverter.h"
+#include "Loader/TextureLoader/DirectDrawSurfaceLoader.h"
+
+#if PLATFORM_ENABLE_VECTORINTRINSICS && PLATFORM_CPU_X86_FAMILY
+#define PIXELCONVERTER_SSE 1
+#include <emmintrin.h>
+#if PLATFORM_ALWAYS_HAS_SSE4_1
+#define PIXELCONVERTER_SSSE3 1
+#include <tmmintrin.h>
+#endif
+#elif PLATFORM_ENABLE_VECTORINTRINSICS_NEON
+#define PIXELCONVERTER_NEON 1
+#endif
+
+#ifndef PIXELCONVERTER_SSE
+#define PIXELCONVERTER_SSE 0
+#endif
+#ifndef PIXELCONVERTER_SSSE3
+#define PIXELCONVERTER_SSSE3 0
+#endif
+#ifndef PIXELCONVERTER_NEON
+#define PIXELCONVERTER_NEON 0
+#endif
+
+// Legacy flag of palettized files, not part of DDS.h
+#define DDS_PALETTEINDEXED8 0x00000020
+
+EPixelConversion FPixelConverter::GetLegacyConversion(const DDS_PIXELFORMAT& PixelFormat)
+{
+	if ((PixelFormat.flags & DDS_RGB) && PixelFormat.RGBBitCount == 24
+		&& PixelFormat.RBitMask == 0x00ff0000 && PixelFormat.GBitMask == 0x0000ff00 && PixelFormat.BBitMask == 0x000000ff)
+		return EPixelConversion_RGB24;
+
+	if ((PixelFormat.flags & DDS_PALETTEINDEXED8) && PixelFormat.RGBBitCount == 8)
+		return EPixelConversion_PAL8;
+
+	return EPixelConversion_NONE;
+}
+
+EPixelConversion FPixelConverter::GetConversion(DXGI_FORMAT Format)
+{
+	switch (Format) {
+	case DXGI_FORMAT_B5G6R5_UNORM:
+		return EPixelConversion_B5G6R5;
+	case DXGI_FORMAT_B5G5R5A1_UNORM:
+		return EPixelConversion_B5G5R5A1;
+	case DXGI_FORMAT_B4G4R4A4_UNORM:
+		return EPixelConversion_B4G4R4A4;
+	case DXGI_FORMAT_B8G8R8X8_UNORM:
+	case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8X8_TYPELESS:
+		return EPixelConversion_B8G8R8X8;
+	case DXGI_FORMAT_YUY2:
+		return EPixelConversion_YUY2;
+	default:
+		return EPixelConversion_NONE;
+	}
+}
+
+const TCHAR* FPixelConverter::GetName(EPixelConversion Conversion)
+{
+	switch (Conversion) {
+	case EPixelConversion_RGB24:
+		return TEXT("RGB24");
+	case EPixelConversion_PAL8:
+		return TEXT("PAL8");
+	case EPixelConversion_B5G6R5:
+		return TEXT("B5G6R5");
+	case EPixelConversion_B5G5R5A1:
+		return TEXT("B5G5R5A1");
+	case EPixelConversion_B4G4R4A4:
+		return TEXT("B4G4R4A4");
+	case EPixelConversion_B8G8R8X8:
+		return TEXT("B8G8R8X8");
+	case EPixelConversion_YUY2:
+		return TEXT("YUY2");
+	default:
+		return TEXT("None");
+	}
+}
+
+uint32 FPixelConverter::GetSourceRowBytes(EPixelConversion Conversion, uint32 Width)
+{
+	switch (Conversion) {
+	case EPixelConversion_RGB24:
+		return Width * 3;
+	case EPixelConversion_PAL8:
+		return Width;
+	case EPixelConversion_B5G6R5:
+	case EPixelConversion_B5G5R5A1:
+	case EPixelConversion_B4G4R4A4:
+		return Width * 2;
+	case EPixelConversion_B8G8R8X8:
+		return Width * 4;
+	case EPixelConversion_YUY2:
+		// Two pixels share four bytes
+		return ((Width + 1) >> 1) * 4;
+	default:
+		return 0;
+	}
+}
+
+void FPixelConverter::ConvertPalette(const uint8* Src, uint32* Dst)
+{
+	for (int32 Index = 0; Index < 256; Index++, Src += 4)
+		Dst[Index] = (uint32)Src[2] | ((uint32)Src[1] << 8) | ((uint32)Src[0] << 16) | ((uint32)Src[3] << 24);
+}
+
+void FPixelConverter::Convert(EPixelConversion Conversion, const uint8* Src, uint8* Dst, uint32 Width, uint32 Height, const uint32* Palette, bool bForceScalar)
+{
+	const uint32 SrcRowBytes = GetSourceRowBytes(Conversion, Width);
+	for (uint32 Row = 0; Row < Height; Row++)
+	{
+		const uint8* SrcRow = Src + (uint64)SrcRowBytes * Row;
+		uint32* DstRow = (uint32*)(Dst + (uint64)Width * 4 * Row);
+
+		uint32 NumConverted = bForceScalar ? 0 : ConvertRowVector(Conversion, SrcRow, DstRow, Width);
+		if (NumConverted < Width)
+			ConvertRowScalar(Conversion, SrcRow + GetSourceRowBytes(Conversion, NumConverted), DstRow + NumConverted, Width - NumConverted, Palette);
+	}
+}
+
+static FORCEINLINE uint32 Expand5(uint32 Value) { return (Value << 3) | (Value >> 2); }
+static FORCEINLINE uint32 Expand6(uint32 Value) { return (Value << 2) | (Value >> 4); }
+static FORCEINLINE uint32 Expand4(uint32 Value) { return (Value << 4) | Value; }
+static FORCEINLINE uint32 PackBGRA(uint32 B, uint32 G, uint32 R, uint32 A) { return B | (G << 8) | (R << 16) | (A << 24); }
+
+static FORCEINLINE uint32 YuvToBGRA(int32 Y, int32 U, int32 V)
+{
+	// BT.601 limited range
+	int32 C = 298 * (Y - 16) + 128;
+	int32 D = U - 128;
+	int32 E = V - 128;
+	uint32 R = (uint32)FMath::Clamp((C + 409 * E) >> 8, 0, 255);
+	uint32 G = (uint32)FMath::Clamp((C - 100 * D - 208 * E) >> 8, 0, 255);
+	uint32 B = (uint32)FMath::Clamp((C + 516 * D) >> 8, 0, 255);
+	return PackBGRA(B, G, R, 255);
+}
+
+void FPixelConverter::ConvertRowScalar(EPixelConversion Conversion, const uint8* Src, uint32* Dst, uint32 Width, const uint32* Palette)
+{
+	switch (Conversion) {
+	case EPixelConversion_RGB24:
+		for (uint32 X = 0; X < Width; X++, Src += 3)
+			Dst[X] = PackBGRA(Src[0], Src[1], Src[2], 255);
+		break;
+
+	case EPixelConversion_PAL8:
+		for (uint32 X = 0; X < Width; X++)
+			Dst[X] = Palette[Src[X]];
+		break;
+
+	case EPixelConversion_B5G6R5:
+		for (uint32 X = 0; X < Width; X++) {
+			uint32 Value = FPlatformMemory::ReadUnaligned<uint16>(Src + X * 2);
+			Dst[X] = PackBGRA(Expand5(Value & 31), Expand6((Value >> 5) & 63), Expand5((Value >> 11) & 31), 255);
+		}
+		break;
+
+	case EPixelConversion_B5G5R5A1:
+		for (uint32 X = 0; X < Width; X++) {
+			uint32 Value = FPlatformMemory::ReadUnaligned<uint16>(Src + X * 2);
+			Dst[X] = PackBGRA(Expand5(Value & 31), Expand5((Value >> 5) & 31), Expand5((Value >> 10) & 31), (Value & 0x8000) ? 255 : 0);
+		}
+		break;
+
+	case EPixelConversion_B4G4R4A4:
+		for (uint32 X = 0; X < Width; X++) {
+			uint32 Value = FPlatformMemory::ReadUnaligned<uint16>(Src + X * 2);
+			Dst[X] = PackBGRA(Expand4(Value & 15), Expand4((Value >> 4) & 15), Expand4((Value >> 8) & 15), Expand4((Value >> 12) & 15));
+		}
+		break;
+
+	case EPixelConversion_B8G8R8X8:
+		for (uint32 X = 0; X < Width; X++)
+			Dst[X] = FPlatformMemory::ReadUnaligned<uint32>(Src + X * 4) | 0xff000000;
+		break;
+
+	case EPixelConversion_YUY2:
+		// Y0 U Y1 V
+		for (uint32 X = 0; X < Width; X += 2, Src += 4) {
+			Dst[X] = YuvToBGRA(Src[0], Src[1], Src[3]);
+			if (X + 1 < Width)
+				Dst[X + 1] = YuvToBGRA(Src[2], Src[1], Src[3]);
+		}
+		break;
+
+	default:
+		FMemory::Memzero(Dst, (SIZE_T)Width * 4);
+		break;
+	}
+}
+
+uint32 FPixelConverter::ConvertRowVector(EPixelConversion Conversion, const uint8* Src, uint32* Dst, uint32 Width)
+{
+	uint32 X = 0;
+
+#if PIXELCONVERTER_SSE
+	// Writes 8 pixels from 16 bit lanes holding blue and green in BG, red and alpha in RA
+	auto StoreBGRA = [](__m128i BG, __m128i RA, uint32* Out)
+	{
+		_mm_storeu_si128((__m128i*)Out, _mm_unpacklo_epi16(BG, RA));
+		_mm_storeu_si128((__m128i*)(Out + 4), _mm_unpackhi_epi16(BG, RA));
+	};
+
+	const __m128i Mask4 = _mm_set1_epi16(0x0f);
+	const __m128i Mask5 = _mm_set1_epi16(0x1f);
+	const __m128i Mask6 = _mm_set1_epi16(0x3f);
+	const __m128i AlphaHigh = _mm_set1_epi16((int16)0xff00);
+
+	switch (Conversion) {
+	case EPixelConversion_B5G6R5:
+		for (; X + 8 <= Width; X += 8) {
+			__m128i Value = _mm_loadu_si128((const __m128i*)(Src + X * 2));
+			__m128i B = _mm_and_si128(Value, Mask5);
+			__m128i G = _mm_and_si128(_mm_srli_epi16(Value, 5), Mask6);
+			__m128i R = _mm_srli_epi16(Value, 11);
+			B = _mm_or_si128(_mm_slli_epi16(B, 3), _mm_srli_epi16(B, 2));
+			G = _mm_or_si128(_mm_slli_epi16(G, 2), _mm_srli_epi16(G, 4));
+			R = _mm_or_si128(_mm_slli_epi16(R, 3), _mm_srli_epi16(R, 2));
+			StoreBGRA(_mm_or_si128(B, _mm_slli_epi16(G, 8)), _mm_or_si128(R, AlphaHigh), Dst + X);
+		}
+		break;
+
+	case EPixelConversion_B5G5R5A1:
+		for (; X + 8 <= Width; X += 8) {
+			__m128i Value = _mm_loadu_si128((const __m128i*)(Src + X * 2));
+			__m128i B = _mm_and_si128(Value, Mask5);
+			__m128i G = _mm_and_si128(_mm_srli_epi16(Value, 5), Mask5);
+			__m128i R = _mm_and_si128(_mm_srli_epi16(Value, 10), Mask5);
+			__m128i A = _mm_and_si128(_mm_srai_epi16(Value, 15), AlphaHigh);
+			B = _mm_or_si128(_mm_slli_epi16(B, 3), _mm_srli_epi16(B, 2));
+			G = _mm_or_si128(_mm_slli_epi16(G, 3), _mm_srli_epi16(G, 2));
+			R = _mm_or_si128(_mm_slli_epi16(R, 3), _mm_srli_epi16(R, 2));
+			StoreBGRA(_mm_or_si128(B, _mm_slli_epi16(G, 8)), _mm_or_si128(R, A), Dst + X);
+		}
+		break;
+
+	case EPixelConversion_B4G4R4A4:
+		for (; X + 8 <= Width; X += 8) {
+			__m128i Value = _mm_loadu_si128((const __m128i*)(Src + X * 2));
+			__m128i B = _mm_and_si128(Value, Mask4);
+			__m128i G = _mm_and_si128(_mm_srli_epi16(Value, 4), Mask4);
+			__m128i R = _mm_and_si128(_mm_srli_epi16(Value, 8), Mask4);
+			__m128i A = _mm_srli_epi16(Value, 12);
+			B = _mm_or_si128(_mm_slli_epi16(B, 4), B);
+			G = _mm_or_si128(_mm_slli_epi16(G, 4), G);
+			R = _mm_or_si128(_mm_slli_epi16(R, 4), R);
+			A = _mm_or_si128(_mm_slli_epi16(A, 4), A);
+			StoreBGRA(_mm_or_si128(B, _mm_slli_epi16(G, 8)), _mm_or_si128(R, _mm_slli_epi16(A, 8)), Dst + X);
+		}
+		break;
+
+	case EPixelConversion_B8G8R8X8:
+	{
+		const __m128i Alpha = _mm_set1_epi32((int32)0xff000000);
+		for (; X + 4 <= Width; X += 4)
+			_mm_storeu_si128((__m128i*)(Dst + X), _mm_or_si128(_mm_loadu_si128((const __m128i*)(Src + X * 4)), Alpha));
+		break;
+	}
+
+#if PIXELCONVERTER_SSSE3
+	case EPixelConversion_RGB24:
+	{
+		// 16 byte loads read two pixels ahead, so the last pixels are left to the scalar code
+		const __m128i Shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+		const __m128i Alpha = _mm_set1_epi32((int32)0xff000000);
+		for (; X + 6 <= Width; X += 4)
+			_mm_storeu_si128((__m128i*)(Dst + X), _mm_or_si128(_mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(Src + X * 3)), Shuffle), Alpha));
+		break;
+	}
+#endif
+
+	default:
+		break;
+	}
+#elif PIXELCONVERTER_NEON
+	const uint8x8_t Alpha = vdup_n_u8(255);
+
+	switch (Conversion) {
+	case EPixelConversion_RGB24:
+		for (; X + 16 <= Width; X += 16) {
+			uint8x16x3_t BGR = vld3q_u8(Src + X * 3);
+			uint8x16x4_t BGRA = { BGR.val[0], BGR.val[1], BGR.val[2], vdupq_n_u8(255) };
+			vst4q_u8((uint8*)(Dst + X), BGRA);
+		}
+		break;
+
+	case EPixelConversion_B5G6R5:
+		for (; X + 8 <= Width; X += 8) {
+			uint16x8_t Value = vld1q_u16((const uint16*)(Src + X * 2));
+			uint16x8_t B = vandq_u16(Value, vdupq_n_u16(0x1f));
+			uint16x8_t G = vandq_u16(vshrq_n_u16(Value, 5), vdupq_n_u16(0x3f));
+			uint16x8_t R = vshrq_n_u16(Value, 11);
+			uint8x8x4_t BGRA;
+			BGRA.val[0] = vmovn_u16(vorrq_u16(vshlq_n_u16(B, 3), vshrq_n_u16(B, 2)));
+			BGRA.val[1] = vmovn_u16(vorrq_u16(vshlq_n_u16(G, 2), vshrq_n_u16(G, 4)));
+			BGRA.val[2] = vmovn_u16(vorrq_u16(vshlq_n_u16(R, 3), vshrq_n_u16(R, 2)));
+			BGRA.val[3] = Alpha;
+			vst4_u8((uint8*)(Dst + X), BGRA);
+		}
+		break;
+
+	case EPixelConversion_B5G5R5A1:
+		for (; X + 8 <= Width; X += 8) {
+			uint16x8_t Value = vld1q_u16((const uint16*)(Src + X * 2));
+			uint16x8_t B = vandq_u16(Value, vdupq_n_u16(0x1f));
+			uint16x8_t G = vandq_u16(vshrq_n_u16(Value, 5), vdupq_n_u16(0x1f));
+			uint16x8_t R = vandq_u16(vshrq_n_u16(Value, 10), vdupq_n_u16(0x1f));
+			uint8x8x4_t BGRA;
+			BGRA.val[0] = vmovn_u16(vorrq_u16(vshlq_n_u16(B, 3), vshrq_n_u16(B, 2)));
+			BGRA.val[1] = vmovn_u16(vorrq_u16(vshlq_n_u16(G, 3), vshrq_n_u16(G, 2)));
+			BGRA.val[2] = vmovn_u16(vorrq_u16(vshlq_n_u16(R, 3), vshrq_n_u16(R, 2)));
+			BGRA.val[3] = vmovn_u16(vreinterpretq_u16_s16(vshrq_n_s16(vreinterpretq_s16_u16(Value), 15)));
+			vst4_u8((uint8*)(Dst + X), BGRA);
+		}
+		break;
+
+	case EPixelConversion_B4G4R4A4:
+		for (; X + 8 <= Width; X += 8) {
+			uint16x8_t Value = vld1q_u16((const uint16*)(Src + X * 2));
+			uint16x8_t Mask = vdupq_n_u16(0x0f);
+			uint16x8_t B = vandq_u16(Value, Mask);
+			uint16x8_t G = vandq_u16(vshrq_n_u16(Value, 4), Mask);
+			uint16x8_t R = vandq_u16(vshrq_n_u16(Value, 8), Mask);
+			uint16x8_t A = vshrq_n_u16(Value, 12);
+			uint8x8x4_t BGRA;
+			BGRA.val[0] = vmovn_u16(vorrq_u16(vshlq_n_u16(B, 4), B));
+			BGRA.val[1] = vmovn_u16(vorrq_u16(vshlq_n_u16(G, 4), G));
+			BGRA.val[2] = vmovn_u16(vorrq_u16(vshlq_n_u16(R, 4), R));
+			BGRA.val[3] = vmovn_u16(vorrq_u16(vshlq_n_u16(A, 4), A));
+			vst4_u8((uint8*)(Dst + X), BGRA);
+		}
+		break;
+
+	case EPixelConversion_B8G8R8X8:
+		for (; X + 4 <= Width; X += 4)
+			vst1q_u32(Dst + X, vorrq_u32(vld1q_u32((const uint32*)(Src + X * 4)), vdupq_n_u32(0xff000000)));
+		break;
+
+	default:
+		break;
+	}
+#endif
+
+	// Palette lookups and YUV pairs stay scalar
+	return X;
+}
+
+static FAutoConsoleCommand CmdPixelConverterBenchmark(
+	TEXT("kw.DDS.BenchmarkConversions"),
+	TEXT("Measures the throughput of every CPU pixel conversion with vector and scalar code. Optional argument is the number of megapixels, 16 by default."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const uint32 Width = 4096;
+		const uint32 Height = FMath::Max(1, (Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 16) * 1024 * 1024 / (int32)Width);
+
+		TArray<uint8> Src;
+		Src.SetNumUninitialized(Width * Height * 4);
+		FRandomStream Random(42);
+		for (uint8& Byte : Src)
+			Byte = (uint8)Random.RandHelper(256);
+
+		uint32 Palette[256];
+		FPixelConverter::ConvertPalette(Src.GetData(), Palette);
+
+		TArray<uint8> Dst;
+		TArray<uint8> DstScalar;
+		Dst.SetNumUninitialized(Width * Height * 4);
+		DstScalar.SetNumUninitialized(Width * Height * 4);
+
+		for (int32 Conversion = EPixelConversion_NONE + 1; Conversion < EPixelConversion_MAX; Conversion++)
+		{
+			EPixelConversion PixelConversion = (EPixelConversion)Conversion;
+
+			double StartTime = FPlatformTime::Seconds();
+			FPixelConverter::Convert(PixelConversion, Src.GetData(), Dst.GetData(), Width, Height, Palette, false);
+			double VectorTime = FPlatformTime::Seconds() - StartTime;
+
+			StartTime = FPlatformTime::Seconds();
+			FPixelConverter::Convert(PixelConversion, Src.GetData(), DstScalar.GetData(), Width, Height, Palette, true);
+			double ScalarTime = FPlatformTime::Seconds() - StartTime;
+
+			double MegaPixels = (double)Width * Height / (1024.0 * 1024.0);
+			bool bMatches = FMemory::Memcmp(Dst.GetData(), DstScalar.GetData(), Dst.Num()) == 0;
+			UE_LOG(LogDirectDrawLoader, Log, TEXT("%s - %.0f MPix/s vector, %.0f MPix/s scalar, results %s"),
+				FPixelConverter::GetName(PixelConversion), MegaPixels / FMath::Max(VectorTime, 1e-9), MegaPixels / FMath::Max(ScalarTime, 1e-9), bMatches ? TEXT("match") : TEXT("differ"));
+		}
+	}));
@@ -0,0 +1,683 @@
+// Copyright @ 2023 Fynn Haupt
+
+
+#include "Loader/TextureLoader/TextureCache.h"
+#include "Loader/TextureLoader/DirectDrawSurfaceLoader.h"
+#include "Loader/TextureLoader/TexturePack.h"
+#include "Misc/SecureHash.h"
+#include "Async/ParallelFor.h"
+#include "UObject/StrongObjectPtr.h"
+#include "Async/Async.h"
+#include "Containers/Ticker.h"
+#include "Misc/App.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonSerializer.h"
+
+DEFINE_LOG_CATEGORY(LogTextureCache);
+
+static TAutoConsoleVariable<int32> CVarTextureCacheBudget(
+	TEXT("kw.TextureCache.BudgetMB"),
+	2048,
+	TEXT("Size of all cached textures in MB before unreferenced textures get evicted."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarTextureCacheForceSerial(
+	TEXT("kw.TextureCache.ForceSerial"),
+	0,
+	TEXT("Hashes and parses preloaded textures one after another on the game thread, useful for debugging and comparing load times."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarTextureStreamingEnable(
+	TEXT("kw.TextureStreaming.Enable"),
+	0,
+	TEXT("Loads 2D textures only up to kw.TextureStreaming.StartSize and streams in the higher mips of rendered textures while the cache budget allows it."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarTextureStreamingStartSize(
+	TEXT("kw.TextureStreaming.StartSize"),
+	512,
+	TEXT("Largest mip of 2D textures that gets loaded up front when texture streaming is enabled."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarTextureStreamingDropDelay(
+	TEXT("kw.TextureStreaming.DropDelay"),
+	10.0f,
+	TEXT("Seconds a texture has to be not rendered before its streamed mips can be dropped to make room for others."),
+	ECVF_Default);
+
+static FAutoConsoleCommand CmdTextureCacheStats(
+	TEXT("kw.TextureCache.Stats"),
+	TEXT("Logs hits, misses and resident bytes of the texture cache."),
+	FConsoleCommandDelegate::CreateLambda([]() { FTextureCache::Get().LogStats(); }));
+
+static FAutoConsoleCommand CmdTextureCacheTrim(
+	TEXT("kw.TextureCache.Trim"),
+	TEXT("Evicts all unreferenced textures from the texture cache."),
+	FConsoleCommandDelegate::CreateLambda([]() { FTextureCache::Get().Trim(0); }));
+
+static TAutoConsoleVariable<int32> CVarTextureCacheModBudget(
+	TEXT("kw.TextureCache.ModBudgetMB"),
+	0,
+	TEXT("Texture memory in MB a single mod may use before the memory report flags it, 0 disables the check."),
+	ECVF_Default);
+
+static FAutoConsoleCommand CmdTextureCacheReport(
+	TEXT("kw.TextureCache.Report"),
+	TEXT("Logs CPU and GPU texture memory per mod and material."),
+	FConsoleCommandDelegate::CreateLambda([]() { FTextureCache::Get().LogMemoryReport(); }));
+
+static FAutoConsoleCommand CmdTextureCacheDumpReport(
+	TEXT("kw.TextureCache.DumpReport"),
+	TEXT("Writes the texture memory report per texture, material and mod as json. Optional argument: file path, defaults to Saved/Profiling/TextureMemory.json."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		FString FilePath = Args.Num() > 0 ? Args[0] : FPaths::Combine(FPaths::ProfilingDir(), TEXT("TextureMemory.json"));
+		FTextureCache::Get().DumpMemoryReport(FilePath);
+	}));
+
+static FAutoConsoleCommand CmdTextureCacheList(
+	TEXT("kw.TextureCache.List"),
+	TEXT("Logs every cached texture with its size, resident mips and owners."),
+	FConsoleCommandDelegate::CreateLambda([]() { FTextureCache::Get().LogTextures(); }));
+
+TUniquePtr<FTextureCache> FTextureCache::Instance;
+
+FTextureCache::FTextureCache()
+{
+	TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FTextureCache::TickStreaming), 0.25f);
+}
+
+FTextureCache::~FTextureCache()
+{
+	FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+}
+
+void FTextureCache::Startup()
+{
+	check(IsInGameThread());
+	Instance.Reset(new FTextureCache());
+}
+
+void FTextureCache::Shutdown()
+{
+	check(IsInGameThread());
+	Instance.Reset();
+}
+
+FTextureCache& FTextureCache::Get()
+{
+	check(Instance.IsValid());
+	return *Instance;
+}
+
+uint32 FTextureCache::GetStartResolution()
+{
+	return CVarTextureStreamingEnable.GetValueOnGameThread() != 0 ? (uint32)FMath::Max(1, CVarTextureStreamingStartSize.GetValueOnGameThread()) : 0;
+}
+
+FString FTextureCache::NormalizePath(const FString& FilePath)
+{
+	FString NormalizedPath = FPaths::ConvertRelativePathToFull(FilePath);
+	FPaths::NormalizeFilename(NormalizedPath);
+	FPaths::CollapseRelativeDirectories(NormalizedPath);
+	return NormalizedPath;
+}
+
+FString FTextureCache::GetModName(const FString& FilePath)
+{
+	// Mods live in <GameUserDir>/mods/<Category>/<Mod>/
+	TArray<FString> Parts;
+	FilePath.ParseIntoArray(Parts, TEXT("/"));
+	for (int32 PartIndex = Parts.Num() - 4; PartIndex >= 0; PartIndex--)
+		if (Parts[PartIndex].Equals(TEXT("mods"), ESearchCase::IgnoreCase))
+			return Parts[PartIndex + 1] + TEXT("/") + Parts[PartIndex + 2];
+
+	return FPaths::GetPath(FilePath);
+}
+
+bool FTextureCache::GetHash(const FString& FilePath, FString& OutHash)
+{
+	FFileStatData StatData = IFileManager::Get().GetStatData(*FilePath);
+	if (!StatData.bIsValid)
+		return false;
+
+	// Only hash the file again when it was changed
+	if (!IsPathUpToDate(FilePath, StatData, OutHash))
+	{
+		OutHash = HashFile(FilePath, StatData);
+
+		FScopeLock Lock(&PathsLock);
+		if (OutHash.IsEmpty())
+		{
+			Paths.Remove(FilePath);
+			return false;
+		}
+
+		FPathEntry& PathEntry = Paths.FindOrAdd(FilePath);
+		PathEntry.Size = StatData.FileSize;
+		PathEntry.Timestamp = StatData.ModificationTime;
+		PathEntry.Hash = OutHash;
+	}
+
+	return true;
+}
+
+bool FTextureCache::IsPathUpToDate(const FString& FilePath, const FFileStatData& StatData, FString& OutHash) const
+{
+	FScopeLock Lock(&PathsLock);
+	const FPathEntry* PathEntry = Paths.Find(FilePath);
+	if (PathEntry == nullptr || PathEntry->Hash.IsEmpty() || PathEntry->Size != StatData.FileSize || PathEntry->Timestamp != StatData.ModificationTime)
+		return false;
+
+	OutHash = PathEntry->Hash;
+	return true;
+}
+
+FString FTextureCache::HashFile(const FString& FilePath, const FFileStatData& StatData)
+{
+	// Baked packs already know the hash of unchanged files
+	if (TSharedPtr<FTexturePack, ESPMode::ThreadSafe> Pack = FTexturePack::FindPack(FilePath))
+	{
+		const FTexturePackEntry* Entry = Pack->FindByPath(FilePath);
+		if (Entry != nullptr && Entry->SourceSize == StatData.FileSize && Entry->SourceTimestamp == StatData.ModificationTime)
+			return Entry->Hash;
+	}
+
+	FMD5Hash Hash = FMD5Hash::HashFile(*FilePath);
+	return Hash.IsValid() ? LexToString(Hash) : FString();
+}
+
+EErrorCode FTextureCache::ParseTexture(UDirectDrawSurfaceLoader* Loader, const FString& FilePath, const FString& Hash, uint32 MaxResolution)
+{
+	// Prefer the baked pack, the DDS file is the fallback
+	if (TSharedPtr<FTexturePack, ESPMode::ThreadSafe> Pack = FTexturePack::FindPack(FilePath))
+		if (const FTexturePackEntry* Entry = Pack->FindByHash(Hash))
+			if (Loader->ParsePackedTexture(*Pack, *Entry, MaxResolution) == EErrorCode_OK)
+				return EErrorCode_OK;
+
+	return Loader->ParseTexture(FilePath, MaxResolution);
+}
+
+bool FTextureCache::IsReferenced(const FTextureEntry& Entry)
+{
+	if (Entry.bPreloaded)
+		return true;
+	for (const FTextureOwner& Owner : Entry.Owners)
+		if (Owner.Object.IsValid())
+			return true;
+	return false;
+}
+
+void FTextureCache::AddOwner(FTextureEntry& Entry, UObject* Owner, const FString& OwnerName)
+{
+	for (const FTextureOwner& ExistingOwner : Entry.Owners)
+		if (ExistingOwner.Object == Owner)
+			return;
+
+	Entry.Owners.Add({ Owner, OwnerName.IsEmpty() ? Owner->GetName() : OwnerName });
+}
+
+UTexture* FTextureCache::Acquire(const FString& FilePath, UObject* Owner, const FString& OwnerName)
+{
+	check(IsInGameThread());
+
+	FString NormalizedPath = NormalizePath(FilePath);
+
+	FString Hash;
+	if (!GetHash(NormalizedPath, Hash))
+	{
+		UE_LOG(LogTextureCache, Error, TEXT("%s - Doesn't exist!"), *NormalizedPath);
+		return nullptr;
+	}
+
+	// Hit
+	if (FTextureEntry* Entry = Textures.Find(Hash))
+	{
+		// Preload counted the miss already
+		if (!Entry->bPreloaded)
+			Stats.Hits++;
+		Entry->bPreloaded = false;
+		AddOwner(*Entry, Owner, OwnerName);
+		Entry->LastUsed = FPlatformTime::Seconds();
+		return Entry->Texture;
+	}
+
+	// Miss
+	Stats.Misses++;
+	UDirectDrawSurfaceLoader* DirectDrawSurfaceLoader = NewObject<UDirectDrawSurfaceLoader>();
+	if (ParseTexture(DirectDrawSurfaceLoader, NormalizedPath, Hash, GetStartResolution()) != EErrorCode_OK || DirectDrawSurfaceLoader->CreateTextures() != EErrorCode_OK)
+		return nullptr;
+
+	FTextureEntry& Entry = AddEntry(Hash, NormalizedPath, DirectDrawSurfaceLoader);
+	AddOwner(Entry, Owner, OwnerName);
+
+	UTexture* Texture = Entry.Texture;
+
+	// Make room for the new texture
+	Trim();
+	return Texture;
+}
+
+FTextureCache::FTextureEntry& FTextureCache::AddEntry(const FString& Hash, const FString& FilePath, const UDirectDrawSurfaceLoader* Loader)
+{
+	FTextureEntry& Entry = Textures.Add(Hash);
+	Entry.Texture = Loader->TextureArray[0];
+	Entry.FilePath = FilePath;
+	Entry.Layout = Loader->GetLayout();
+	Entry.Bytes = Entry.Texture->CalcTextureMemorySizeEnum(TMC_AllMips);
+	Entry.NumFileMips = Loader->GetNumFileMips();
+	Entry.NumSkippedMips = Loader->GetNumSkippedMips();
+	Entry.NumStartSkippedMips = Entry.NumSkippedMips;
+	Entry.LastUsed = FPlatformTime::Seconds();
+
+	Stats.NumTextures = Textures.Num();
+	Stats.ResidentBytes += Entry.Bytes;
+	return Entry;
+}
+
+int32 FTextureCache::Preload(const TArray<FString>& FilePaths)
+{
+	check(IsInGameThread());
+
+	FTexturePreload TexturePreload;
+	HashFiles(FilePaths, TexturePreload);
+	BeginParse(TexturePreload);
+	ParseFiles(TexturePreload);
+	return FinishPreload(TexturePreload);
+}
+
+static EParallelForFlags GetPreloadFlags()
+{
+	return CVarTextureCacheForceSerial.GetValueOnAnyThread() != 0 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::Unbalanced;
+}
+
+void FTextureCache::HashFiles(const TArray<FString>& FilePaths, FTexturePreload& Preload) const
+{
+	// Find files which weren't hashed yet or changed since
+	TArray<int32> StaleIndices;
+	for (const FString& FilePath : FilePaths)
+	{
+		FString NormalizedPath = NormalizePath(FilePath);
+		if (Preload.Paths.Contains(NormalizedPath))
+			continue;
+
+		FFileStatData StatData = IFileManager::Get().GetStatData(*NormalizedPath);
+		if (!StatData.bIsValid)
+			continue;
+
+		FString Hash;
+		if (!IsPathUpToDate(NormalizedPath, StatData, Hash))
+			StaleIndices.Add(Preload.Paths.Num());
+
+		Preload.Paths.Add(NormalizedPath);
+		Preload.StatData.Add(StatData);
+		Preload.Hashes.Add(Hash);
+	}
+
+	// Hash files, the ones which can't be read keep an empty hash
+	ParallelFor(StaleIndices.Num(), [&](int32 StaleIndex)
+	{
+		const int32 PathIndex = StaleIndices[StaleIndex];
+		Preload.Hashes[PathIndex] = HashFile(Preload.Paths[PathIndex], Preload.StatData[PathIndex]);
+	}, GetPreloadFlags());
+}
+
+void FTextureCache::BeginParse(FTexturePreload& Preload)
+{
+	check(IsInGameThread());
+
+	{
+		FScopeLock Lock(&PathsLock);
+		for (int32 PathIndex = 0; PathIndex < Preload.Paths.Num(); PathIndex++)
+		{
+			if (Preload.Hashes[PathIndex].IsEmpty())
+				continue;
+
+			FPathEntry& PathEntry = Paths.FindOrAdd(Preload.Paths[PathIndex]);
+			PathEntry.Size = Preload.StatData[PathIndex].FileSize;
+			PathEntry.Timestamp = Preload.StatData[PathIndex].ModificationTime;
+			PathEntry.Hash = Preload.Hashes[PathIndex];
+		}
+	}
+
+	// Collect textures which aren't cached yet, loaders have to be created on the game thread
+	for (int32 PathIndex = 0; PathIndex < Preload.Paths.Num(); PathIndex++)
+	{
+		const FString& Hash = Preload.Hashes[PathIndex];
+		if (Hash.IsEmpty() || Textures.Contains(Hash) || Preload.MissingHashes.Contains(Hash))
+			continue;
+
+		Preload.MissingHashes.Add(Hash);
+		Preload.MissingPaths.Add(Preload.Paths[PathIndex]);
+		Preload.Loaders.Emplace(NewObject<UDirectDrawSurfaceLoader>());
+	}
+
+	Preload.StartResolution = GetStartResolution();
+}
+
+void FTextureCache::ParseFiles(FTexturePreload& Preload)
+{
+	// Read and parse files
+	Preload.Errors.SetNum(Preload.Loaders.Num());
+	ParallelFor(Preload.Loaders.Num(), [&](int32 LoaderIndex)
+	{
+		Preload.Errors[LoaderIndex] = ParseTexture(Preload.Loaders[LoaderIndex].Get(), Preload.MissingPaths[LoaderIndex], Preload.MissingHashes[LoaderIndex], Preload.StartResolution);
+	}, GetPreloadFlags());
+}
+
+int32 FTextureCache::FinishPreload(FTexturePreload& Preload)
+{
+	check(IsInGameThread());
+
+	// Create textures
+	int32 NumLoaded = 0;
+	for (int32 LoaderIndex = 0; LoaderIndex < Preload.Loaders.Num(); LoaderIndex++)
+	{
+		// Same texture could have been acquired while the files were parsed on a worker
+		if (Textures.Contains(Preload.MissingHashes[LoaderIndex]))
+			continue;
+
+		if (!Preload.Errors.IsValidIndex(LoaderIndex) || Preload.Errors[LoaderIndex] != EErrorCode_OK || Preload.Loaders[LoaderIndex]->CreateTextures() != EErrorCode_OK)
+			continue;
+
+		// Trimming has to wait until the owners are bound, otherwise the new textures are the first ones to go
+		AddEntry(Preload.MissingHashes[LoaderIndex], Preload.MissingPaths[LoaderIndex], Preload.Loaders[LoaderIndex].Get()).bPreloaded = true;
+		NumLoaded++;
+	}
+
+	// Loaders have to be released on the game thread
+	Preload.Loaders.Empty();
+
+	// Textures which failed here are counted by Acquire
+	Stats.Misses += NumLoaded;
+	return NumLoaded;
+}
+
+void FTextureCache::ReleasePreloaded()
+{
+	check(IsInGameThread());
+
+	for (TPair<FString, FTextureEntry>& Pair : Textures)
+		Pair.Value.bPreloaded = false;
+
+	Trim();
+}
+
+void FTextureCache::Trim()
+{
+	Trim((int64)CVarTextureCacheBudget.GetValueOnGameThread() * 1024 * 1024);
+}
+
+void FTextureCache::Trim(int64 BudgetBytes)
+{
+	if (Stats.ResidentBytes <= BudgetBytes)
+		return;
+
+	// Unreferenced textures, least recently used first
+	TArray<TPair<double, FString>> Candidates;
+	for (const TPair<FString, FTextureEntry>& Pair : Textures)
+		if (!IsReferenced(Pair.Value))
+			Candidates.Emplace(Pair.Value.LastUsed, Pair.Key);
+	Candidates.Sort([](const TPair<double, FString>& A, const TPair<double, FString>& B) { return A.Key < B.Key; });
+
+	for (const TPair<double, FString>& Candidate : Candidates)
+	{
+		if (Stats.ResidentBytes <= BudgetBytes)
+			break;
+
+		// Textures are released by the garbage collection once nothing else uses them
+		FTextureEntry Entry;
+		Textures.RemoveAndCopyValue(Candidate.Value, Entry);
+		Stats.ResidentBytes -= Entry.Bytes;
+		Stats.Evictions++;
+	}
+
+	Stats.NumTextures = Textures.Num();
+
+	if (Stats.ResidentBytes > BudgetBytes)
+		UE_LOG(LogTextureCache, Warning, TEXT("%.1f MB of referenced textures exceed the budget of %.1f MB!"), Stats.ResidentBytes / (1024.0 * 1024.0), BudgetBytes / (1024.0 * 1024.0));
+}
+
+void FTextureCache::LogStats() const
+{
+	UE_LOG(LogTextureCache, Log, TEXT("%d textures with %.1f MB resident, %d hits, %d misses, %d evictions"),
+		Stats.NumTextures, Stats.ResidentBytes / (1024.0 * 1024.0), Stats.Hits, Stats.Misses, Stats.Evictions);
+}
+
+void FTextureCache::LogTextures() const
+{
+	for (const TPair<FString, FTextureEntry>& Pair : Textures)
+	{
+		const FTextureEntry& Entry = Pair.Value;
+		int32 NumOwners = 0;
+		for (const FTextureOwner& Owner : Entry.Owners)
+			NumOwners += Owner.Object.IsValid() ? 1 : 0;
+
+		UE_LOG(LogTextureCache, Log, TEXT("%s - %dx%d, %d/%d mips resident, %.1f KB, %d owners"),
+			*FPaths::GetCleanFilename(Entry.FilePath), (int32)Entry.Texture->GetSurfaceWidth(), (int32)Entry.Texture->GetSurfaceHeight(),
+			Entry.NumFileMips - Entry.NumSkippedMips, Entry.NumFileMips, Entry.Bytes / 1024.0, NumOwners);
+	}
+}
+
+FTextureMemoryReport FTextureCache::GetMemoryReport() const
+{
+	FTextureMemoryReport Report;
+	for (const TPair<FString, FTextureEntry>& Pair : Textures)
+	{
+		const FTextureEntry& Entry = Pair.Value;
+		FTextureMemoryReport::FTexture& Texture = Report.Textures.AddDefaulted_GetRef();
+		Texture.FilePath = Entry.FilePath;
+		Texture.Mod = GetModName(Entry.FilePath);
+		Texture.Usage.NumTextures = 1;
+
+		// Bulk data stays loaded when the resource keeps a copy of the mips, eg. for streaming or recreating it
+		FTexturePlatformData** PlatformData = Entry.Texture->GetRunningPlatformData();
+		if (PlatformData != nullptr && *PlatformData != nullptr)
+			for (const FTexture2DMipMap& Mip : (*PlatformData)->Mips)
+				if (Mip.BulkData.IsBulkDataLoaded())
+					Texture.Usage.CpuBytes += Mip.BulkData.GetBulkDataSize();
+
+		if (Entry.Texture->GetResource() != nullptr)
+			Texture.Usage.GpuBytes = Entry.Texture->CalcTextureMemorySizeEnum(TMC_ResidentMips);
+
+		for (const FTextureOwner& Owner : Entry.Owners)
+		{
+			if (!Owner.Object.IsValid())
+				continue;
+			Texture.Materials.Add(Owner.Name);
+			Report.Materials.FindOrAdd(Owner.Name).Add(Texture.Usage);
+		}
+
+		Report.Mods.FindOrAdd(Texture.Mod).Add(Texture.Usage);
+		Report.Total.Add(Texture.Usage);
+	}
+
+	Report.Textures.Sort([](const FTextureMemoryReport::FTexture& A, const FTextureMemoryReport::FTexture& B) {
+		return A.Usage.CpuBytes + A.Usage.GpuBytes > B.Usage.CpuBytes + B.Usage.GpuBytes;
+	});
+	return Report;
+}
+
+void FTextureCache::LogMemoryReport() const
+{
+	FTextureMemoryReport Report = GetMemoryReport();
+	const int64 ModBudgetBytes = (int64)CVarTextureCacheModBudget.GetValueOnGameThread() * 1024 * 1024;
+
+	for (const TPair<FString, FTextureMemoryUsage>& Mod : Report.Mods)
+	{
+		bool bOverBudget = ModBudgetBytes > 0 && Mod.Value.CpuBytes + Mod.Value.GpuBytes > ModBudgetBytes;
+		UE_LOG(LogTextureCache, Log, TEXT("Mod %s - %d textures, %.1f MB CPU, %.1f MB GPU%s"),
+			*Mod.Key, Mod.Value.NumTextures, Mod.Value.CpuBytes / (1024.0 * 1024.0), Mod.Value.GpuBytes / (1024.0 * 1024.0), bOverBudget ? TEXT(", over budget!") : TEXT(""));
+	}
+
+	for (const TPair<FString, FTextureMemoryUsage>& Material : Report.Materials)
+		UE_LOG(LogTextureCache, Log, TEXT("Material %s - %d textures, %.1f MB CPU, %.1f MB GPU"),
+			*Material.Key, Material.Value.NumTextures, Material.Value.CpuBytes / (1024.0 * 1024.0), Material.Value.GpuBytes / (1024.0 * 1024.0));
+
+	UE_LOG(LogTextureCache, Log, TEXT("Total - %d textures, %.1f MB CPU, %.1f MB GPU"),
+		Report.Total.NumTextures, Report.Total.CpuBytes / (1024.0 * 1024.0), Report.Total.GpuBytes / (1024.0 * 1024.0));
+}
+
+static TSharedRef<FJsonObject> MemoryUsageToJson(const FTextureMemoryUsage& Usage)
+{
+	TSharedRef<FJsonObject> JsonObject = MakeShared<FJsonObject>();
+	JsonObject->SetNumberField(TEXT("NumTextures"), Usage.NumTextures);
+	JsonObject->SetNumberField(TEXT("CpuBytes"), (double)Usage.CpuBytes);
+	JsonObject->SetNumberField(TEXT("GpuBytes"), (double)Usage.GpuBytes);
+	return JsonObject;
+}
+
+bool FTextureCache::DumpMemoryReport(const FString& FilePath) const
+{
+	FTextureMemoryReport Report = GetMemoryReport();
+	TSharedRef<FJsonObject> JsonObject = MakeShared<FJsonObject>();
+
+	TArray<TSharedPtr<FJsonValue>> TextureValues;
+	for (const FTextureMemoryReport::FTexture& Texture : Report.Textures)
+	{
+		TSharedRef<FJsonObject> TextureObject = MemoryUsageToJson(Texture.Usage);
+		TextureObject->SetStringField(TEXT("Path"), Texture.FilePath);
+		TextureObject->SetStringField(TEXT("Mod"), Texture.Mod);
+
+		TArray<TSharedPtr<FJsonValue>> MaterialValues;
+		for (const FString& Material : Texture.Materials)
+			MaterialValues.Add(MakeShared<FJsonValueString>(Material));
+		TextureObject->SetArrayField(TEXT("Materials"), MaterialValues);
+
+		TextureValues.Add(MakeShared<FJsonValueObject>(TextureObject));
+	}
+	JsonObject->SetArrayField(TEXT("Textures"), TextureValues);
+
+	TSharedRef<FJsonObject> MaterialsObject = MakeShared<FJsonObject>();
+	for (const TPair<FString, FTextureMemoryUsage>& Material : Report.Materials)
+		MaterialsObject->SetObjectField(Material.Key, MemoryUsageToJson(Material.Value));
+	JsonObject->SetObjectField(TEXT("Materials"), MaterialsObject);
+
+	TSharedRef<FJsonObject> ModsObject = MakeShared<FJsonObject>();
+	for (const TPair<FString, FTextureMemoryUsage>& Mod : Report.Mods)
+		ModsObject->SetObjectField(Mod.Key, MemoryUsageToJson(Mod.Value));
+	JsonObject->SetObjectField(TEXT("Mods"), ModsObject);
+
+	JsonObject->SetObjectField(TEXT("Total"), MemoryUsageToJson(Report.Total));
+
+	FString JsonString;
+	TSharedRef<TJsonWriter<TCHAR>> JsonWriter = TJsonWriterFactory<TCHAR>::Create(&JsonString);
+	if (!FJsonSerializer::Serialize(JsonObject, JsonWriter) || !FFileHelper::SaveStringToFile(JsonString, *FilePath))
+	{
+		UE_LOG(LogTextureCache, Warning, TEXT("%s - Memory report can't be written!"), *FilePath);
+		return false;
+	}
+
+	UE_LOG(LogTextureCache, Log, TEXT("%s - Memory report was written!"), *FilePath);
+	return true;
+}
+
+bool FTextureCache::TickStreaming(float DeltaTime)
+{
+	if (CVarTextureStreamingEnable.GetValueOnGameThread() == 0 || StreamingLoader != nullptr)
+		return true;
+
+	const double CurrentTime = FApp::GetCurrentTime();
+	const double DropDelay = CVarTextureStreamingDropDelay.GetValueOnGameThread();
+	const int64 BudgetBytes = (int64)CVarTextureCacheBudget.GetValueOnGameThread() * 1024 * 1024;
+
+	// Smallest rendered texture gets its next mip first, the texture not rendered for the longest time drops its streamed mips first
+	FString UpgradeHash;
+	FTextureEntry* UpgradeEntry = nullptr;
+	FString DropHash;
+	FTextureEntry* DropEntry = nullptr;
+	double DropRenderTime = CurrentTime - DropDelay;
+	for (TPair<FString, FTextureEntry>& Pair : Textures)
+	{
+		FTextureEntry& Entry = Pair.Value;
+		const FTextureResource* Resource = Entry.Texture->GetResource();
+		if (!Entry.Texture->IsA<UTexture2D>() || Resource == nullptr || Entry.Layout.Mips.Num() == 0)
+			continue;
+
+		if (CurrentTime - Resource->LastRenderTime < 1.0) {
+			if (Entry.NumSkippedMips > 0 && !Entry.bFullyStreamed && (UpgradeEntry == nullptr || Entry.NumSkippedMips > UpgradeEntry->NumSkippedMips)) {
+				UpgradeHash = Pair.Key;
+				UpgradeEntry = &Entry;
+			}
+		}
+		else if (Entry.NumSkippedMips < Entry.NumStartSkippedMips && Resource->LastRenderTime < DropRenderTime) {
+			DropHash = Pair.Key;
+			DropEntry = &Entry;
+			DropRenderTime = Resource->LastRenderTime;
+		}
+	}
+
+	// Next mip has four times the size of the current one
+	if (UpgradeEntry != nullptr && Stats.ResidentBytes + UpgradeEntry->Bytes * 3 <= BudgetBytes) {
+		StreamTexture(UpgradeHash, *UpgradeEntry);
+	}
+	else if (UpgradeEntry != nullptr && DropEntry != nullptr) {
+		DropMips(*DropEntry);
+	}
+
+	return true;
+}
+
+void FTextureCache::StreamTexture(const FString& Hash, const FTextureEntry& Entry)
+{
+	StreamingLoader = NewObject<UDirectDrawSurfaceLoader>();
+
+	// Read the next mip on a worker, upload it from the game thread
+	Async(EAsyncExecution::ThreadPool, [Loader = StreamingLoader.Get(), Layout = Entry.Layout, MipLevel = Entry.NumSkippedMips - 1, Hash]()
+	{
+		EErrorCode ErrorCode = Loader->ParseMip(Layout, MipLevel);
+		AsyncTask(ENamedThreads::GameThread, [Hash, ErrorCode]()
+		{
+			// Module could have been shut down in the meantime
+			if (FTextureCache::IsAvailable())
+				FTextureCache::Get().FinishStreaming(Hash, ErrorCode);
+		});
+	});
+}
+
+void FTextureCache::FinishStreaming(const FString& Hash, EErrorCode ErrorCode)
+{
+	UDirectDrawSurfaceLoader* Loader = StreamingLoader;
+	StreamingLoader = nullptr;
+
+	// Texture might have been evicted or its mips dropped in the meantime
+	FTextureEntry* Entry = Textures.Find(Hash);
+	if (Entry == nullptr)
+		return;
+
+	// Size limit reached
+	if (ErrorCode == EErrorCode_OVERFLOW) {
+		Entry->bFullyStreamed = true;
+		return;
+	}
+
+	if (ErrorCode != EErrorCode_OK || Loader->GetNumSkippedMips() + 1 != Entry->NumSkippedMips || Loader->UpdateTexture(Cast<UTexture2D>(Entry->Texture)) != EErrorCode_OK)
+		return;
+
+	Entry->NumSkippedMips--;
+
+	Stats.ResidentBytes -= Entry->Bytes;
+	Entry->Bytes = Entry->Texture->CalcTextureMemorySizeEnum(TMC_AllMips);
+	Stats.ResidentBytes += Entry->Bytes;
+}
+
+void FTextureCache::DropMips(FTextureEntry& Entry)
+{
+	// Back to the start size, only the GPU copies the remaining mips
+	if (UDirectDrawSurfaceLoader::DropMips(Cast<UTexture2D>(Entry.Texture), Entry.NumStartSkippedMips - Entry.NumSkippedMips) != EErrorCode_OK)
+		return;
+
+	Entry.bFullyStreamed = false;
+	Entry.NumSkippedMips = Entry.NumStartSkippedMips;
+
+	Stats.ResidentBytes -= Entry.Bytes;
+	Entry.Bytes = Entry.Texture->CalcTextureMemorySizeEnum(TMC_AllMips);
+	Stats.ResidentBytes += Entry.Bytes;
+}
+
+void FTextureCache::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	for (TPair<FString, FTextureEntry>& Pair : Textures)
+		Collector.AddReferencedObject(Pair.Value.Texture);
+	Collector.AddReferencedObject(StreamingLoader);
+}
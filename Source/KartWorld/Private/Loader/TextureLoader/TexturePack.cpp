@@ -0,0 +1,312 @@
+// Copyright @ 2023 Fynn Haupt
+
+
+#include "Loader/TextureLoader/TexturePack.h"
+#include "Loader/TextureLoader/DirectDrawSurfaceLoader.h"
+#include "HAL/PlatformFileManager.h"
+#include "Async/ParallelFor.h"
+#include "Misc/SecureHash.h"
+#include "UObject/StrongObjectPtr.h"
+
+DEFINE_LOG_CATEGORY(LogTexturePack);
+
+const TCHAR* FTexturePack::FileName = TEXT("Textures.kwtex");
+
+// Folder to the pack responsible for it, folders without pack map to nullptr until the next bake
+static FCriticalSection PacksLock;
+static TMap<FString, TSharedPtr<FTexturePack, ESPMode::ThreadSafe>> Packs;
+
+TSharedPtr<FTexturePack, ESPMode::ThreadSafe> FTexturePack::FindPack(const FString& FilePath)
+{
+	FScopeLock Lock(&PacksLock);
+
+	// Walk up until a folder is known or has a pack
+	TArray<FString> VisitedFolders;
+	TSharedPtr<FTexturePack, ESPMode::ThreadSafe> Pack;
+	FString Folder = FPaths::GetPath(FilePath);
+	while (!Folder.IsEmpty())
+	{
+		if (const TSharedPtr<FTexturePack, ESPMode::ThreadSafe>* KnownPack = Packs.Find(Folder))
+		{
+			if (!KnownPack->IsValid() || (*KnownPack)->IsUpToDate())
+			{
+				Pack = *KnownPack;
+				break;
+			}
+
+			// Baked again since it was opened, every folder using it looks it up again
+			TSharedPtr<FTexturePack, ESPMode::ThreadSafe> StalePack = *KnownPack;
+			for (auto It = Packs.CreateIterator(); It; ++It)
+				if (It.Value() == StalePack)
+					It.RemoveCurrent();
+		}
+		VisitedFolders.Add(Folder);
+
+		FString CandidatePath = FPaths::Combine(Folder, FileName);
+		if (FPaths::FileExists(CandidatePath))
+		{
+			TSharedPtr<FTexturePack, ESPMode::ThreadSafe> NewPack = MakeShared<FTexturePack, ESPMode::ThreadSafe>();
+			if (NewPack->Open(CandidatePath))
+				Pack = NewPack;
+			break;
+		}
+
+		FString ParentFolder = FPaths::GetPath(Folder);
+		if (ParentFolder == Folder)
+			break;
+		Folder = ParentFolder;
+	}
+
+	for (const FString& VisitedFolder : VisitedFolders)
+		Packs.Add(VisitedFolder, Pack);
+	return Pack;
+}
+
+bool FTexturePack::Open(const FString& InPackPath)
+{
+	FFileStatData StatData = IFileManager::Get().GetStatData(*InPackPath);
+	TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*InPackPath));
+	if (!StatData.bIsValid || !Reader.IsValid())
+		return false;
+
+	uint32 PackMagic = 0;
+	uint32 PackVersion = 0;
+	int64 IndexOffset = 0;
+	*Reader << PackMagic;
+	*Reader << PackVersion;
+	*Reader << IndexOffset;
+
+	if (Reader->IsError() || PackMagic != Magic || PackVersion != Version || IndexOffset <= 0 || IndexOffset >= Reader->TotalSize())
+	{
+		UE_LOG(LogTexturePack, Warning, TEXT("%s - Pack is outdated, bake it again!"), *InPackPath);
+		return false;
+	}
+
+	Reader->Seek(IndexOffset);
+	*Reader << Entries;
+
+	if (Reader->IsError())
+	{
+		UE_LOG(LogTexturePack, Warning, TEXT("%s - Pack is corrupt!"), *InPackPath);
+		Entries.Empty();
+		return false;
+	}
+
+	// Mips have to be between the header and the index
+	const int64 HeaderSize = sizeof(uint32) * 2 + sizeof(int64);
+	for (const FTexturePackEntry& Entry : Entries)
+	{
+		bool bValid = Entry.NumSlices > 0 && Entry.PixelFormat > PF_Unknown && Entry.PixelFormat < PF_MAX && (uint32)Entry.Mips.Num() <= Entry.NumFileMips;
+		for (const FTexturePackMip& Mip : Entry.Mips)
+			bValid &= Mip.SizeX > 0 && Mip.SizeY > 0 && Mip.SizeZ > 0 && Mip.Size > 0 && Mip.Offset >= HeaderSize && Mip.Offset <= IndexOffset - Mip.Size;
+
+		if (!bValid)
+		{
+			UE_LOG(LogTexturePack, Warning, TEXT("%s - Pack is corrupt!"), *InPackPath);
+			Entries.Empty();
+			return false;
+		}
+	}
+
+	for (int32 EntryIndex = 0; EntryIndex < Entries.Num(); EntryIndex++)
+	{
+		PathIndex.Add(Entries[EntryIndex].Path, EntryIndex);
+		HashIndex.Add(Entries[EntryIndex].Hash, EntryIndex);
+	}
+
+	PackPath = InPackPath;
+	PackSize = Reader->TotalSize();
+	PackTimestamp = StatData.ModificationTime;
+	RootFolder = FPaths::GetPath(InPackPath);
+
+	UE_LOG(LogTexturePack, Log, TEXT("%s - Opened with %d textures!"), *PackPath, Entries.Num());
+	return true;
+}
+
+bool FTexturePack::IsUpToDate() const
+{
+	FFileStatData StatData = IFileManager::Get().GetStatData(*PackPath);
+	return StatData.bIsValid && StatData.FileSize == PackSize && StatData.ModificationTime == PackTimestamp;
+}
+
+const FTexturePackEntry* FTexturePack::FindByPath(const FString& FilePath) const
+{
+	FString RelativePath = FilePath;
+	if (!FPaths::MakePathRelativeTo(RelativePath, *(RootFolder / TEXT(""))))
+		return nullptr;
+
+	const int32* EntryIndex = PathIndex.Find(RelativePath);
+	return EntryIndex != nullptr ? &Entries[*EntryIndex] : nullptr;
+}
+
+const FTexturePackEntry* FTexturePack::FindByHash(const FString& Hash) const
+{
+	const int32* EntryIndex = HashIndex.Find(Hash);
+	return EntryIndex != nullptr ? &Entries[*EntryIndex] : nullptr;
+}
+
+FTexturePlatformData* FTexturePack::ReadPlatformData(const FTexturePackEntry& Entry, int32 FirstMip) const
+{
+	if (!Entry.Mips.IsValidIndex(FirstMip))
+		return nullptr;
+
+	const FTexturePackMip& TopMip = Entry.Mips[FirstMip];
+	FTexturePlatformData* PlatformData = new FTexturePlatformData();
+	PlatformData->SizeX = TopMip.SizeX;
+	PlatformData->SizeY = TopMip.SizeY;
+	PlatformData->SetNumSlices(Entry.NumSlices);
+	PlatformData->SetIsCubemap(Entry.bIsCubeMap);
+	PlatformData->PixelFormat = (EPixelFormat)Entry.PixelFormat;
+
+	// Own handle per read, so parallel loads don't wait for each other
+	TUniquePtr<IFileHandle> FileHandle(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*PackPath));
+
+	// Mips are stored after each other, so one seek is enough. A pack baked again since has a different layout.
+	if (!FileHandle.IsValid() || FileHandle->Size() != PackSize || !FileHandle->Seek(TopMip.Offset))
+	{
+		delete PlatformData;
+		return nullptr;
+	}
+
+	for (int32 MipIndex = FirstMip; MipIndex < Entry.Mips.Num(); MipIndex++)
+	{
+		const FTexturePackMip& PackMip = Entry.Mips[MipIndex];
+		FTexture2DMipMap* Mip = new FTexture2DMipMap(PackMip.SizeX, PackMip.SizeY, PackMip.SizeZ);
+		PlatformData->Mips.Add(Mip);
+
+		Mip->BulkData.Lock(LOCK_READ_WRITE);
+		bool bRead = FileHandle->Read((uint8*)Mip->BulkData.Realloc(PackMip.Size), PackMip.Size);
+		Mip->BulkData.Unlock();
+
+		if (!bRead)
+		{
+			UE_LOG(LogTexturePack, Error, TEXT("%s - Can't read %s!"), *PackPath, *Entry.Path);
+			delete PlatformData;
+			return nullptr;
+		}
+	}
+
+	return PlatformData;
+}
+
+bool FTexturePack::Bake(const FString& Folder)
+{
+	check(IsInGameThread());
+
+	FString PackFolder = FPaths::ConvertRelativePathToFull(Folder);
+	FPaths::NormalizeDirectoryName(PackFolder);
+
+	TArray<FString> Files;
+	IFileManager::Get().FindFilesRecursive(Files, *PackFolder, TEXT("*.dds"), true, false);
+
+	FString PackPath = FPaths::Combine(PackFolder, FileName);
+	// Name is unique, so two bakes of the same mod never write into the same file
+	FString TempPath = FPaths::CreateTempFilename(*PackFolder, *FileName, TEXT(".tmp"));
+	TUniquePtr<FArchive> Writer(IFileManager::Get().CreateFileWriter(*TempPath));
+	if (!Writer.IsValid())
+	{
+		UE_LOG(LogTexturePack, Error, TEXT("%s - Pack can't be written!"), *PackPath);
+		return false;
+	}
+
+	// Index offset is written once the data is done
+	uint32 PackMagic = Magic;
+	uint32 PackVersion = Version;
+	int64 IndexOffset = 0;
+	*Writer << PackMagic;
+	*Writer << PackVersion;
+	*Writer << IndexOffset;
+
+	// Parse in batches to bound the memory
+	const int32 BatchSize = 32;
+	TArray<FTexturePackEntry> PackEntries;
+	for (int32 BatchStart = 0; BatchStart < Files.Num(); BatchStart += BatchSize)
+	{
+		int32 BatchNum = FMath::Min(BatchSize, Files.Num() - BatchStart);
+
+		TArray<TStrongObjectPtr<UDirectDrawSurfaceLoader>> Loaders;
+		for (int32 Index = 0; Index < BatchNum; Index++)
+			Loaders.Emplace(NewObject<UDirectDrawSurfaceLoader>());
+
+		TArray<EErrorCode> Errors;
+		TArray<FString> Hashes;
+		Errors.SetNum(BatchNum);
+		Hashes.SetNum(BatchNum);
+		ParallelFor(BatchNum, [&](int32 Index)
+		{
+			const FString& FilePath = Files[BatchStart + Index];
+			Errors[Index] = Loaders[Index]->ParseTexture(FilePath, 0);
+			Hashes[Index] = LexToString(FMD5Hash::HashFile(*FilePath));
+		}, EParallelForFlags::Unbalanced);
+
+		for (int32 Index = 0; Index < BatchNum; Index++)
+		{
+			const FString& FilePath = Files[BatchStart + Index];
+			const FTexturePlatformData* PlatformData = Loaders[Index]->GetPlatformData();
+			if (Errors[Index] != EErrorCode_OK || PlatformData == nullptr)
+			{
+				UE_LOG(LogTexturePack, Warning, TEXT("%s - Can't be baked, stays a DDS file!"), *FilePath);
+				continue;
+			}
+
+			FFileStatData StatData = IFileManager::Get().GetStatData(*FilePath);
+
+			FTexturePackEntry& Entry = PackEntries.AddDefaulted_GetRef();
+			Entry.Path = FilePath;
+			FPaths::MakePathRelativeTo(Entry.Path, *(PackFolder / TEXT("")));
+			Entry.Hash = Hashes[Index];
+			Entry.SourceSize = StatData.FileSize;
+			Entry.SourceTimestamp = StatData.ModificationTime;
+			Entry.PixelFormat = (int32)PlatformData->PixelFormat;
+			Entry.NumSlices = PlatformData->GetNumSlices();
+			Entry.bIsCubeMap = PlatformData->IsCubemap();
+			Entry.NumFileMips = Loaders[Index]->GetNumFileMips();
+
+			// Start textures on page boundaries
+			static const uint8 Padding[4096] = {};
+			int64 PaddingSize = Align(Writer->Tell(), 4096) - Writer->Tell();
+			Writer->Serialize((void*)Padding, PaddingSize);
+
+			for (const FTexture2DMipMap& Mip : PlatformData->Mips)
+			{
+				FTexturePackMip& PackMip = Entry.Mips.AddDefaulted_GetRef();
+				PackMip.SizeX = Mip.SizeX;
+				PackMip.SizeY = Mip.SizeY;
+				PackMip.SizeZ = Mip.SizeZ;
+				PackMip.Offset = Writer->Tell();
+				PackMip.Size = Mip.BulkData.GetBulkDataSize();
+
+				const void* Data = Mip.BulkData.LockReadOnly();
+				Writer->Serialize(const_cast<void*>(Data), PackMip.Size);
+				Mip.BulkData.Unlock();
+			}
+		}
+	}
+
+	IndexOffset = Writer->Tell();
+	*Writer << PackEntries;
+	int64 PackSize = Writer->Tell();
+	Writer->Seek(sizeof(uint32) * 2);
+	*Writer << IndexOffset;
+
+	bool bError = Writer->IsError();
+	Writer->Close();
+	Writer.Reset();
+
+	// Write to a temporary file first, so a concurrent load never sees a half written pack
+	if (bError || !IFileManager::Get().Move(*PackPath, *TempPath))
+	{
+		UE_LOG(LogTexturePack, Error, TEXT("%s - Pack can't be written!"), *PackPath);
+		IFileManager::Get().Delete(*TempPath);
+		return false;
+	}
+
+	// Folders which had no pack so far look for it again
+	{
+		FScopeLock Lock(&PacksLock);
+		Packs.Empty();
+	}
+
+	UE_LOG(LogTexturePack, Log, TEXT("%s - Baked %d of %d textures into %.1f MB!"), *PackPath, PackEntries.Num(), Files.Num(), PackSize / (1024.0 * 1024.0));
+	return true;
+}
@@ -15,4 +15,10 @@ void UMainGameInstance::Init()
     TrackLoader->Initialize(GameUserDir);
     ChassiLoader->Initialize(GameUserDir);
     TireLoader->Initialize(GameUserDir);
+
+    // Scan installed mods once, loaders use the parsed configurations
+    ModCatalog->Initialize(TrackLoader, ChassiLoader, TireLoader);
+    TrackLoader->Catalog = ModCatalog;
+    ChassiLoader->Catalog = ModCatalog;
+    TireLoader->Catalog = ModCatalog;
 }
@@ -2,6 +2,7 @@
 
 
 #include "Meshes/ChassiMesh.h"
+#include "Meshes/MeshStreamBuilder.h"
 
 DEFINE_LOG_CATEGORY(LogChassiMesh);
 
@@ -20,6 +21,7 @@ void AChassiMesh::LoadMesh()
 	// Load models
 	ChassiModel = GameInstance->ChassiLoader->Load(ChassiName);
 	TireModel = GameInstance->TireLoader->Load(TireName);
+	TireMeshes.Reset();
 
 	// Check weather model was imported without errors
 	if (!ChassiModel.bSuccess) return;
@@ -66,37 +68,18 @@ USceneComponent* AChassiMesh::CreateNode(FNodeData& NodeData)
 		Mesh->AttachToComponent(Node, FAttachmentTransformRules::KeepRelativeTransform);
 	}
 
-	// Tire Front Left
-	if(NodeData.Name.Compare(ChassiModel.Linking.StubAxleLeft.Wheel) == 0) {
-		URealtimeMeshComponent* Mesh = CreateTireModel(TireModel.ModelFl);
-		Mesh->SetUsingAbsoluteScale(true);
-		Mesh->SetWorldRotation(FRotator(0.0f, 0.0f, -90.0f));
-		if (Mesh != nullptr) Mesh->AttachToComponent(Node, FAttachmentTransformRules::KeepRelativeTransform);
-	}
+	// Tires
+	if(NodeData.Name.Compare(ChassiModel.Linking.StubAxleLeft.Wheel) == 0)
+		AttachTire(Node, TireModel.Fl, FRotator(0.0f, 0.0f, -90.0f));
 
-	// Tire Front Right
-	if(NodeData.Name.Compare(ChassiModel.Linking.StubAxleRight.Wheel) == 0) {
-		URealtimeMeshComponent* Mesh = CreateTireModel(TireModel.ModelFr);
-		Mesh->SetUsingAbsoluteScale(true);
-		Mesh->SetWorldRotation(FRotator(0.0f, 0.0f, 90.0f));
-		if (Mesh != nullptr) Mesh->AttachToComponent(Node, FAttachmentTransformRules::KeepRelativeTransform);
-	}
+	if(NodeData.Name.Compare(ChassiModel.Linking.StubAxleRight.Wheel) == 0)
+		AttachTire(Node, TireModel.Fr, FRotator(0.0f, 0.0f, 90.0f));
 
-	// Tire Rear Left
-	if(NodeData.Name.Compare(ChassiModel.Linking.RearAxle.WheelLeft) == 0) {
-		URealtimeMeshComponent* Mesh = CreateTireModel(TireModel.ModelRl);
-		Mesh->SetUsingAbsoluteScale(true);
-		Mesh->SetWorldRotation(FRotator(0.0f, 90.0f, 0.0f));
-		if (Mesh != nullptr) Mesh->AttachToComponent(Node, FAttachmentTransformRules::KeepRelativeTransform);
-	}
+	if(NodeData.Name.Compare(ChassiModel.Linking.RearAxle.WheelLeft) == 0)
+		AttachTire(Node, TireModel.Rl, FRotator(0.0f, 90.0f, 0.0f));
 
-	// Tire Rear Right
-	if(NodeData.Name.Compare(ChassiModel.Linking.RearAxle.WheelRight) == 0) {
-		URealtimeMeshComponent* Mesh = CreateTireModel(TireModel.ModelRr);
-		Mesh->SetUsingAbsoluteScale(true);
-		Mesh->SetWorldRotation(FRotator(0.0f, 90.0f, 0.0f));
-		if (Mesh != nullptr) Mesh->AttachToComponent(Node, FAttachmentTransformRules::KeepRelativeTransform);
-	}
+	if(NodeData.Name.Compare(ChassiModel.Linking.RearAxle.WheelRight) == 0)
+		AttachTire(Node, TireModel.Rr, FRotator(0.0f, 90.0f, 0.0f));
 
 	return Node;
 }
@@ -117,26 +100,9 @@ URealtimeMeshComponent* AChassiMesh::CreateMesh(int32 MeshIndex)
 	// Create mesh
 	URealtimeMeshSimple* Mesh = MeshComponent->InitializeRealtimeMesh<URealtimeMeshSimple>();
 
-	FRealtimeMeshStreamSet StreamSet;
-	TRealtimeMeshBuilderLocal<uint16, FPackedNormal, FVector2DHalf, 1> Builder(StreamSet);
-	Builder.EnableTangents();
-	Builder.EnableTexCoords();
-	Builder.EnablePolyGroups();
-	Builder.EnableColors();
-
 	// Load mesh
-	for (int32 VertexIndex = 0; VertexIndex < MeshData.Verticies.Num(); VertexIndex++)
-	{
-		Builder.AddVertex(MeshData.Verticies[VertexIndex].Position)
-			.SetNormalAndTangent(MeshData.Verticies[VertexIndex].Normal, MeshData.Verticies[VertexIndex].Tangent)
-			.SetTexCoords(MeshData.Verticies[VertexIndex].UV0);
-	}
-
-	for (int32 TriangleIndex = 0; TriangleIndex < MeshData.Triangles.Num(); TriangleIndex++)
-	{
-		FTriangleData &Triangle = MeshData.Triangles[TriangleIndex];
-		Builder.AddTriangle(Triangle.UV0, Triangle.UV1, Triangle.UV2, 0);
-	}
+	FRealtimeMeshStreamSet StreamSet;
+	FMeshStreamBuilder::Build(MeshData, StreamSet);
 
 	// Setup material
 	int32 MaterialId = MeshData.MaterialId;
@@ -149,7 +115,20 @@ URealtimeMeshComponent* AChassiMesh::CreateMesh(int32 MeshIndex)
 	return MeshComponent;
 }
 
-URealtimeMeshComponent* AChassiMesh::CreateTireModel(FModelData& ModelData) {
+void AChassiMesh::AttachTire(USceneComponent* Node, const FTireCorner& Corner, FRotator Rotation) {
+	URealtimeMeshComponent* Mesh = CreateTireModel(Corner.ModelIndex);
+	if (Mesh == nullptr) return;
+
+	// Mirrored corners share the model of the other side
+	Mesh->SetUsingAbsoluteScale(true);
+	Mesh->SetRelativeScale3D(Corner.Mirror);
+	Mesh->SetWorldRotation(Rotation);
+	Mesh->AttachToComponent(Node, FAttachmentTransformRules::KeepRelativeTransform);
+}
+
+URealtimeMeshComponent* AChassiMesh::CreateTireModel(int32 ModelIndex) {
+	if (!TireModel.Models.IsValidIndex(ModelIndex)) return nullptr;
+
 	// Create mesh component
 	URealtimeMeshComponent* MeshComponent = NewObject<URealtimeMeshComponent>(this);
 	MeshComponent->SetMobility(EComponentMobility::Movable);
@@ -158,32 +137,24 @@ URealtimeMeshComponent* AChassiMesh::CreateTireModel(FModelData& ModelData) {
 	MeshComponent->RegisterComponent();
 	AddInstanceComponent(MeshComponent);
 
+	// Corners with the same model share one mesh and its GPU buffers
+	TireMeshes.SetNum(TireModel.Models.Num());
+	if (TireMeshes[ModelIndex] != nullptr) {
+		MeshComponent->SetRealtimeMesh(TireMeshes[ModelIndex]);
+		return MeshComponent;
+	}
+
 	// Create mesh
 	URealtimeMeshSimple* Mesh = MeshComponent->InitializeRealtimeMesh<URealtimeMeshSimple>();
+	TireMeshes[ModelIndex] = Mesh;
 
+	FModelData& ModelData = TireModel.Models[ModelIndex];
 	for(int32 MeshIndex = 0; MeshIndex < ModelData.Meshes.Num(); MeshIndex++) {
 		FMeshData& MeshData = ModelData.Meshes[MeshIndex];
 		
-		FRealtimeMeshStreamSet StreamSet;
-		TRealtimeMeshBuilderLocal<uint16, FPackedNormal, FVector2DHalf, 1> Builder(StreamSet);
-		Builder.EnableTangents();
-		Builder.EnableTexCoords();
-		Builder.EnablePolyGroups();
-		Builder.EnableColors();
-
 		// Load mesh
-		for (int32 VertexIndex = 0; VertexIndex < MeshData.Verticies.Num(); VertexIndex++)
-		{
-			Builder.AddVertex(MeshData.Verticies[VertexIndex].Position)
-				.SetNormalAndTangent(MeshData.Verticies[VertexIndex].Normal, MeshData.Verticies[VertexIndex].Tangent)
-				.SetTexCoords(MeshData.Verticies[VertexIndex].UV0);
-		}
-
-		for (int32 TriangleIndex = 0; TriangleIndex < MeshData.Triangles.Num(); TriangleIndex++)
-		{
-			FTriangleData &Triangle = MeshData.Triangles[TriangleIndex];
-			Builder.AddTriangle(Triangle.UV0, Triangle.UV1, Triangle.UV2, 0);
-		}
+		FRealtimeMeshStreamSet StreamSet;
+		FMeshStreamBuilder::Build(MeshData, StreamSet);
 
 		// Setup material
 		if (ModelData.Materials.IsValidIndex(MeshData.MaterialId))
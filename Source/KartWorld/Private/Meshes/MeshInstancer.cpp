@@ -0,0 +1,256 @@
+// Copyright @ 2023 Fynn Haupt
+
+
+#include "Meshes/MeshInstancer.h"
+#include "Meshes/MeshStreamBuilder.h"
+#include "Engine/StaticMesh.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "MeshDescription.h"
+#include "StaticMeshAttributes.h"
+#include "PhysicsEngine/BodySetup.h"
+
+DEFINE_LOG_CATEGORY(LogMeshInstancer);
+
+// Largest distance in cm between vertices of two occurrences in their own frame
+static constexpr float PositionTolerance = 0.1f;
+
+// Largest difference between normals or tangents of two occurrences in their own frame
+static constexpr float DirectionTolerance = 0.01f;
+
+// Directions of a world space mesh in the frame of the occurrence
+static TArray<FVector3f> GetLocalDirections(const TArray<FVector3f>& Directions, const FTransform& Transform)
+{
+	TArray<FVector3f> LocalDirections;
+	LocalDirections.SetNumUninitialized(Directions.Num());
+	for (int32 Index = 0; Index < Directions.Num(); Index++)
+		LocalDirections[Index] = FVector3f(Transform.InverseTransformVectorNoScale(FVector(Directions[Index])));
+	return LocalDirections;
+}
+
+static bool DirectionsMatch(const TArray<FVector3f>& Directions, const TArray<FVector3f>& LocalDirections, const FTransform& Transform)
+{
+	if (Directions.Num() != LocalDirections.Num())
+		return false;
+
+	for (int32 Index = 0; Index < Directions.Num(); Index++)
+		if (!FVector3f(Transform.InverseTransformVectorNoScale(FVector(Directions[Index]))).Equals(LocalDirections[Index], DirectionTolerance))
+			return false;
+
+	return true;
+}
+
+bool FMeshInstancer::GetTransform(const FMeshData& MeshData, FTransform& Transform)
+{
+	if (MeshData.NumVertices() < 3)
+		return false;
+
+	// First vertex far enough away for a stable direction
+	const FVector Origin = FVector(MeshData.Positions[0]);
+	int32 First = INDEX_NONE;
+	for (int32 VertexIndex = 1; VertexIndex < MeshData.NumVertices() && First == INDEX_NONE; VertexIndex++)
+		if (FVector::DistSquared(FVector(MeshData.Positions[VertexIndex]), Origin) > 1.0)
+			First = VertexIndex;
+
+	if (First == INDEX_NONE)
+		return false;
+
+	// Vertex clearly off that direction
+	const FVector X = (FVector(MeshData.Positions[First]) - Origin).GetUnsafeNormal();
+	for (int32 VertexIndex = First + 1; VertexIndex < MeshData.NumVertices(); VertexIndex++)
+	{
+		const FVector Direction = FVector(MeshData.Positions[VertexIndex]) - Origin;
+		const FVector Z = FVector::CrossProduct(X, Direction);
+		if (Z.SizeSquared() < 0.01 * Direction.SizeSquared())
+			continue;
+
+		const FVector ZAxis = Z.GetUnsafeNormal();
+		const FVector YAxis = FVector::CrossProduct(ZAxis, X);
+		Transform = FTransform(X, YAxis, ZAxis, Origin);
+		return true;
+	}
+
+	return false;
+}
+
+uint32 FMeshInstancer::GetGeometryHash(const FMeshData& MeshData)
+{
+	// Nothing of this changes when the mesh is rotated or moved, normals and tangents do and are only counted
+	uint32 Hash = HashCombine(GetTypeHash(MeshData.MaterialId), GetTypeHash(MeshData.NumVertices()));
+	Hash = HashCombine(Hash, HashCombine(GetTypeHash(MeshData.Normals.Num()), GetTypeHash(MeshData.Tangents.Num())));
+	Hash = FCrc::MemCrc32(MeshData.Indices.GetData(), MeshData.Indices.Num() * sizeof(int32), Hash);
+	Hash = FCrc::MemCrc32(MeshData.Colors.GetData(), MeshData.Colors.Num() * sizeof(FColor), Hash);
+	for (const TArray<FVector2f>* UVs : { &MeshData.UV0, &MeshData.UV1, &MeshData.UV2, &MeshData.UV3 })
+		Hash = FCrc::MemCrc32(UVs->GetData(), UVs->Num() * sizeof(FVector2f), HashCombine(Hash, GetTypeHash(UVs->Num())));
+	return Hash;
+}
+
+TArray<FInstancedMesh> FMeshInstancer::ExtractInstances(TArray<FMeshData>& Meshes, int32 MinInstances, FMeshInstancingReport& Report)
+{
+	struct FGroup
+	{
+		TArray<FVector3f> LocalPositions;
+		TArray<FVector3f> LocalNormals;
+		TArray<FVector3f> LocalTangents;
+		TArray<int32> MeshIndices;
+		TArray<FTransform> Transforms;
+	};
+
+	TArray<FGroup> Groups;
+	TMap<uint32, TArray<int32>> GroupsByHash;
+
+	for (int32 MeshIndex = 0; MeshIndex < Meshes.Num(); MeshIndex++)
+	{
+		// Lods of the track aren't configured, so only lod 0 is drawn
+		const FMeshData& MeshData = Meshes[MeshIndex];
+		FTransform Transform;
+		if (MeshData.LodData.Lod != 0 || !GetTransform(MeshData, Transform))
+			continue;
+
+		TArray<int32>& Candidates = GroupsByHash.FindOrAdd(GetGeometryHash(MeshData));
+
+		// Compare with the first occurrence of every group with the same hash
+		int32 FoundGroup = INDEX_NONE;
+		for (int32 GroupIndex : Candidates)
+		{
+			const FGroup& Group = Groups[GroupIndex];
+			const FMeshData& First = Meshes[Group.MeshIndices[0]];
+			if (First.Indices != MeshData.Indices || First.Colors != MeshData.Colors ||
+				First.UV0 != MeshData.UV0 || First.UV1 != MeshData.UV1 || First.UV2 != MeshData.UV2 || First.UV3 != MeshData.UV3)
+				continue;
+
+			if (!DirectionsMatch(MeshData.Normals, Group.LocalNormals, Transform) || !DirectionsMatch(MeshData.Tangents, Group.LocalTangents, Transform))
+				continue;
+
+			bool bMatches = true;
+			for (int32 VertexIndex = 0; VertexIndex < MeshData.NumVertices() && bMatches; VertexIndex++)
+			{
+				const FVector3f LocalPosition = FVector3f(Transform.InverseTransformPositionNoScale(FVector(MeshData.Positions[VertexIndex])));
+				bMatches = LocalPosition.Equals(Group.LocalPositions[VertexIndex], PositionTolerance);
+			}
+
+			if (bMatches)
+			{
+				FoundGroup = GroupIndex;
+				break;
+			}
+		}
+
+		if (FoundGroup == INDEX_NONE)
+		{
+			FoundGroup = Groups.AddDefaulted();
+			Candidates.Add(FoundGroup);
+
+			FGroup& Group = Groups[FoundGroup];
+			Group.LocalPositions.SetNumUninitialized(MeshData.NumVertices());
+			for (int32 VertexIndex = 0; VertexIndex < MeshData.NumVertices(); VertexIndex++)
+				Group.LocalPositions[VertexIndex] = FVector3f(Transform.InverseTransformPositionNoScale(FVector(MeshData.Positions[VertexIndex])));
+			Group.LocalNormals = GetLocalDirections(MeshData.Normals, Transform);
+			Group.LocalTangents = GetLocalDirections(MeshData.Tangents, Transform);
+		}
+
+		Groups[FoundGroup].MeshIndices.Add(MeshIndex);
+		Groups[FoundGroup].Transforms.Add(Transform);
+	}
+
+	// Move groups with enough occurrences into their own frame
+	TArray<FInstancedMesh> InstancedMeshes;
+	TBitArray<> Instanced(false, Meshes.Num());
+	for (FGroup& Group : Groups)
+	{
+		if (Group.MeshIndices.Num() < FMath::Max(MinInstances, 2))
+			continue;
+
+		FInstancedMesh& InstancedMesh = InstancedMeshes.AddDefaulted_GetRef();
+		InstancedMesh.MeshData = MoveTemp(Meshes[Group.MeshIndices[0]]);
+		InstancedMesh.MeshData.Positions = MoveTemp(Group.LocalPositions);
+		InstancedMesh.MeshData.Normals = MoveTemp(Group.LocalNormals);
+		InstancedMesh.MeshData.Tangents = MoveTemp(Group.LocalTangents);
+		InstancedMesh.Transforms = MoveTemp(Group.Transforms);
+
+		for (int32 MeshIndex : Group.MeshIndices)
+			Instanced[MeshIndex] = true;
+
+		const int32 NumInstances = InstancedMesh.Transforms.Num();
+		Report.NumInstancedMeshes++;
+		Report.NumInstances += NumInstances;
+		Report.SavedBytes += (int64)(NumInstances - 1) * FMeshStreamBuilder::GetStreamSize(InstancedMesh.MeshData) - (int64)NumInstances * sizeof(FInstancedStaticMeshInstanceData);
+
+		UE_LOG(LogMeshInstancer, Verbose, TEXT("Mesh with %d vertices - %d instances!"), InstancedMesh.MeshData.NumVertices(), NumInstances);
+	}
+
+	// Keep the other meshes in their order
+	int32 MeshIndex = 0;
+	Meshes.RemoveAll([&](const FMeshData&) { return Instanced[MeshIndex++]; });
+
+	return InstancedMeshes;
+}
+
+UStaticMesh* FMeshInstancer::BuildStaticMesh(UObject* Outer, const FMeshData& MeshData, UMaterialInterface* Material)
+{
+	FMeshDescription MeshDescription;
+	FStaticMeshAttributes Attributes(MeshDescription);
+	Attributes.Register();
+
+	TVertexAttributesRef<FVector3f> Positions = Attributes.GetVertexPositions();
+	TVertexInstanceAttributesRef<FVector3f> Normals = Attributes.GetVertexInstanceNormals();
+	TVertexInstanceAttributesRef<FVector3f> Tangents = Attributes.GetVertexInstanceTangents();
+	TVertexInstanceAttributesRef<FVector2f> UVs = Attributes.GetVertexInstanceUVs();
+	TVertexInstanceAttributesRef<FVector4f> Colors = Attributes.GetVertexInstanceColors();
+	TPolygonGroupAttributesRef<FName> SlotNames = Attributes.GetPolygonGroupMaterialSlotNames();
+
+	MeshDescription.ReserveNewVertices(MeshData.NumVertices());
+	MeshDescription.ReserveNewVertexInstances(MeshData.NumVertices());
+	MeshDescription.ReserveNewTriangles(MeshData.NumTriangles());
+
+	// Every channel up to the last one with coordinates
+	const TArray<FVector2f>* UVChannels[] = { &MeshData.UV0, &MeshData.UV1, &MeshData.UV2, &MeshData.UV3 };
+	int32 NumUVChannels = 1;
+	for (int32 Channel = 1; Channel < UE_ARRAY_COUNT(UVChannels); Channel++)
+		if (UVChannels[Channel]->Num() > 0)
+			NumUVChannels = Channel + 1;
+	UVs.SetNumChannels(NumUVChannels);
+
+	// One vertex instance per vertex, with the same defaults as the realtime mesh streams
+	TArray<FVertexInstanceID> VertexInstances;
+	VertexInstances.SetNumUninitialized(MeshData.NumVertices());
+	for (int32 VertexIndex = 0; VertexIndex < MeshData.NumVertices(); VertexIndex++)
+	{
+		const FVertexID Vertex = MeshDescription.CreateVertex();
+		Positions[Vertex] = MeshData.Positions[VertexIndex];
+
+		const FVertexInstanceID VertexInstance = MeshDescription.CreateVertexInstance(Vertex);
+		Normals[VertexInstance] = MeshData.Normals.IsValidIndex(VertexIndex) ? MeshData.Normals[VertexIndex] : FVector3f::ZAxisVector;
+		Tangents[VertexInstance] = MeshData.Tangents.IsValidIndex(VertexIndex) ? MeshData.Tangents[VertexIndex] : FVector3f::XAxisVector;
+		for (int32 Channel = 0; Channel < NumUVChannels; Channel++)
+			UVs.Set(VertexInstance, Channel, UVChannels[Channel]->IsValidIndex(VertexIndex) ? (*UVChannels[Channel])[VertexIndex] : FVector2f::ZeroVector);
+		Colors[VertexInstance] = MeshData.Colors.IsValidIndex(VertexIndex) ? FVector4f(FLinearColor(MeshData.Colors[VertexIndex])) : FVector4f(1.0f, 1.0f, 1.0f, 1.0f);
+		VertexInstances[VertexIndex] = VertexInstance;
+	}
+
+	const FPolygonGroupID PolygonGroup = MeshDescription.CreatePolygonGroup();
+	SlotNames[PolygonGroup] = FName("Material");
+
+	for (int32 Index = 0; Index + 2 < MeshData.Indices.Num(); Index += 3)
+	{
+		FVertexInstanceID Triangle[3] = { VertexInstances[MeshData.Indices[Index]], VertexInstances[MeshData.Indices[Index + 1]], VertexInstances[MeshData.Indices[Index + 2]] };
+		MeshDescription.CreateTriangle(PolygonGroup, Triangle);
+	}
+
+	UStaticMesh* StaticMesh = NewObject<UStaticMesh>(Outer);
+	StaticMesh->GetStaticMaterials().Add(FStaticMaterial(Material, FName("Material")));
+
+	// Props collide with their triangles like the realtime mesh, which needs the cpu copy for cooking at runtime
+	UStaticMesh::FBuildMeshDescriptionsParams Params;
+	Params.bBuildSimpleCollision = false;
+	Params.bFastBuild = true;
+	Params.bAllowCpuAccess = true;
+	StaticMesh->BuildFromMeshDescriptions({ &MeshDescription }, Params);
+
+	StaticMesh->CreateBodySetup();
+	UBodySetup* BodySetup = StaticMesh->GetBodySetup();
+	BodySetup->CollisionTraceFlag = CTF_UseComplexAsSimple;
+	BodySetup->InvalidatePhysicsData();
+	BodySetup->CreatePhysicsMeshes();
+
+	return StaticMesh;
+}
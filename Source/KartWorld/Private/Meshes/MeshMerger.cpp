@@ -0,0 +1,99 @@
+// Copyright @ 2023 Fynn Haupt
+
+
+#include "Meshes/MeshMerger.h"
+
+DEFINE_LOG_CATEGORY(LogMeshMerger);
+
+TArray<FMeshData> FMeshMerger::MergeByMaterialAndLod(const TArray<FMeshData>& Meshes)
+{
+	// Group by material id and lod
+	TMap<TPair<int32, int32>, int32> GroupIndices;
+	TArray<TArray<const FMeshData*>> Groups;
+	for (const FMeshData& MeshData : Meshes)
+	{
+		TPair<int32, int32> Key(MeshData.MaterialId, MeshData.LodData.Lod);
+		int32* GroupIndex = GroupIndices.Find(Key);
+		if (GroupIndex == nullptr)
+			GroupIndex = &GroupIndices.Add(Key, Groups.AddDefaulted());
+		Groups[*GroupIndex].Add(&MeshData);
+	}
+
+	// Merge each group
+	TArray<FMeshData> MergedMeshes;
+	MergedMeshes.SetNum(Groups.Num());
+	for (int32 GroupIndex = 0; GroupIndex < Groups.Num(); GroupIndex++)
+		Merge(Groups[GroupIndex], MergedMeshes[GroupIndex]);
+
+	UE_LOG(LogMeshMerger, Verbose, TEXT("Merged %d meshes into %d"), Meshes.Num(), MergedMeshes.Num());
+	return MergedMeshes;
+}
+
+/**
+ * Appends a channel of every mesh, meshes without the channel get the default value.
+ * The channel is left empty when none of the meshes has it.
+ */
+template <typename ElementType>
+static void MergeChannel(TConstArrayView<const FMeshData*> Meshes, TArray<ElementType> FMeshData::* Channel, const ElementType& Default, int32 NumVertices, TArray<ElementType>& MergedChannel)
+{
+	bool bAnyHasChannel = false;
+	for (const FMeshData* MeshData : Meshes)
+		bAnyHasChannel |= (MeshData->*Channel).Num() > 0;
+
+	if (!bAnyHasChannel)
+		return;
+
+	MergedChannel.Reserve(NumVertices);
+	for (const FMeshData* MeshData : Meshes)
+	{
+		const TArray<ElementType>& Source = MeshData->*Channel;
+		if (Source.Num() == MeshData->NumVertices())
+			MergedChannel.Append(Source);
+		else
+		{
+			int32 Start = MergedChannel.AddUninitialized(MeshData->NumVertices());
+			for (int32 VertexIndex = Start; VertexIndex < MergedChannel.Num(); VertexIndex++)
+				MergedChannel[VertexIndex] = Default;
+		}
+	}
+}
+
+void FMeshMerger::Merge(TConstArrayView<const FMeshData*> Meshes, FMeshData& MergedMesh)
+{
+	MergedMesh = FMeshData();
+	if (Meshes.Num() == 0)
+		return;
+
+	// Material and lod are the same for the whole group
+	MergedMesh.MaterialId = Meshes[0]->MaterialId;
+	MergedMesh.LodData = Meshes[0]->LodData;
+
+	int32 NumVertices = 0;
+	int32 NumIndices = 0;
+	for (const FMeshData* MeshData : Meshes)
+	{
+		NumVertices += MeshData->NumVertices();
+		NumIndices += MeshData->Indices.Num();
+	}
+
+	// Vertices
+	MergeChannel(Meshes, &FMeshData::Positions, FVector3f::ZeroVector, NumVertices, MergedMesh.Positions);
+	MergeChannel(Meshes, &FMeshData::Normals, FVector3f::ZAxisVector, NumVertices, MergedMesh.Normals);
+	MergeChannel(Meshes, &FMeshData::Tangents, FVector3f::XAxisVector, NumVertices, MergedMesh.Tangents);
+	MergeChannel(Meshes, &FMeshData::Colors, FColor::White, NumVertices, MergedMesh.Colors);
+	MergeChannel(Meshes, &FMeshData::UV0, FVector2f::ZeroVector, NumVertices, MergedMesh.UV0);
+	MergeChannel(Meshes, &FMeshData::UV1, FVector2f::ZeroVector, NumVertices, MergedMesh.UV1);
+	MergeChannel(Meshes, &FMeshData::UV2, FVector2f::ZeroVector, NumVertices, MergedMesh.UV2);
+	MergeChannel(Meshes, &FMeshData::UV3, FVector2f::ZeroVector, NumVertices, MergedMesh.UV3);
+
+	// Triangles, indices are shifted behind the vertices of the previous meshes
+	MergedMesh.Indices.SetNumUninitialized(NumIndices);
+	int32* Indices = MergedMesh.Indices.GetData();
+	int32 BaseVertex = 0;
+	for (const FMeshData* MeshData : Meshes)
+	{
+		for (int32 Index : MeshData->Indices)
+			*Indices++ = BaseVertex + Index;
+		BaseVertex += MeshData->NumVertices();
+	}
+}
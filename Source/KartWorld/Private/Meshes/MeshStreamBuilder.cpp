@@ -0,0 +1,81 @@
+// Copyright @ 2023 Fynn Haupt
+
+
+#include "Meshes/MeshStreamBuilder.h"
+
+DEFINE_LOG_CATEGORY(LogMeshStreamBuilder);
+
+int64 FMeshStreamBuilder::GetStreamSize(const FMeshData& MeshData)
+{
+	const int64 VertexSize = sizeof(FVector3f) + sizeof(FTangentType) + sizeof(FTexCoordType) + sizeof(FColor);
+	const int64 IndexSize = NeedsWideIndices(MeshData) ? sizeof(uint32) : sizeof(uint16);
+	return MeshData.NumVertices() * VertexSize + MeshData.NumTriangles() * (3 * IndexSize + sizeof(uint16));
+}
+
+bool FMeshStreamBuilder::Build(const FMeshData& MeshData, FRealtimeMeshStreamSet& StreamSet)
+{
+	if (!NeedsWideIndices(MeshData))
+	{
+		Build<uint16>(MeshData, StreamSet);
+		return false;
+	}
+
+	UE_LOG(LogMeshStreamBuilder, Log, TEXT("Mesh with %d vertices - Using 32 bit indices!"), MeshData.NumVertices());
+	Build<uint32>(MeshData, StreamSet);
+	return true;
+}
+
+template <typename IndexType>
+void FMeshStreamBuilder::Build(const FMeshData& MeshData, FRealtimeMeshStreamSet& StreamSet)
+{
+	const int32 NumVertices = MeshData.NumVertices();
+	const int32 NumTriangles = MeshData.NumTriangles();
+	check(NumVertices <= (int64)TNumericLimits<IndexType>::Max() + 1);
+
+	// Position
+	FRealtimeMeshStream& Positions = *StreamSet.AddStream(FRealtimeMeshStreams::Position, GetRealtimeMeshBufferLayout<FVector3f>());
+	Positions.Append(MeshData.Positions);
+
+	// Normal and tangent, missing channels fall back to the builder defaults
+	FRealtimeMeshStream& Tangents = *StreamSet.AddStream(FRealtimeMeshStreams::Tangents, GetRealtimeMeshBufferLayout<FTangentType>());
+	Tangents.SetNumUninitialized(NumVertices);
+	TArrayView<FTangentType> TangentView = Tangents.GetArrayView<FTangentType>();
+	const bool bHasNormals = MeshData.Normals.Num() == NumVertices;
+	const bool bHasTangents = MeshData.Tangents.Num() == NumVertices;
+	for (int32 VertexIndex = 0; VertexIndex < NumVertices; VertexIndex++)
+	{
+		TangentView[VertexIndex].SetNormalAndTangent(
+			bHasNormals ? MeshData.Normals[VertexIndex] : FVector3f::ZAxisVector,
+			bHasTangents ? MeshData.Tangents[VertexIndex] : FVector3f::XAxisVector);
+	}
+
+	// UV
+	FRealtimeMeshStream& TexCoords = *StreamSet.AddStream(FRealtimeMeshStreams::TexCoords, GetRealtimeMeshBufferLayout<FTexCoordType>());
+	TexCoords.SetNumUninitialized(NumVertices);
+	TArrayView<FTexCoordType> TexCoordView = TexCoords.GetArrayView<FTexCoordType>();
+	const bool bHasTexCoords = MeshData.UV0.Num() == NumVertices;
+	for (int32 VertexIndex = 0; VertexIndex < NumVertices; VertexIndex++)
+		TexCoordView[VertexIndex] = FTexCoordType(bHasTexCoords ? MeshData.UV0[VertexIndex] : FVector2f::ZeroVector);
+
+	// Color isn't used by the materials, keep the builder default
+	FRealtimeMeshStream& Colors = *StreamSet.AddStream(FRealtimeMeshStreams::Color, GetRealtimeMeshBufferLayout<FColor>());
+	Colors.SetNumUninitialized(NumVertices);
+	TArrayView<FColor> ColorView = Colors.GetArrayView<FColor>();
+	for (int32 VertexIndex = 0; VertexIndex < NumVertices; VertexIndex++)
+		ColorView[VertexIndex] = FColor::White;
+
+	// Triangles
+	FRealtimeMeshStream& Triangles = *StreamSet.AddStream(FRealtimeMeshStreams::Triangles, GetRealtimeMeshBufferLayout<TIndex3<IndexType>>());
+	Triangles.SetNumUninitialized(NumTriangles);
+	IndexType* TriangleData = reinterpret_cast<IndexType*>(Triangles.GetData());
+	const int32* Indices = MeshData.Indices.GetData();
+	for (int32 Index = 0; Index < NumTriangles * 3; Index++)
+		TriangleData[Index] = (IndexType)Indices[Index];
+
+	// All triangles are in the first poly group
+	FRealtimeMeshStream& PolyGroups = *StreamSet.AddStream(FRealtimeMeshStreams::PolyGroups, GetRealtimeMeshBufferLayout<uint16>());
+	PolyGroups.SetNumZeroed(NumTriangles);
+}
+
+template void FMeshStreamBuilder::Build<uint16>(const FMeshData& MeshData, FRealtimeMeshStreamSet& StreamSet);
+template void FMeshStreamBuilder::Build<uint32>(const FMeshData& MeshData, FRealtimeMeshStreamSet& StreamSet);
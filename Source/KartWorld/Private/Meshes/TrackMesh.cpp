@@ -2,14 +2,38 @@
 
 
 #include "Meshes/TrackMesh.h"
+#include "Meshes/MeshStreamBuilder.h"
+#include "Meshes/MeshMerger.h"
+#include "Meshes/ChassiMesh.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Async/Async.h"
+#include "Components/InstancedStaticMeshComponent.h"
 
 DEFINE_LOG_CATEGORY(LogTrackMesh);
 
+static TAutoConsoleVariable<int32> CVarTrackMeshMerge(
+	TEXT("kw.TrackMesh.Merge"),
+	1,
+	TEXT("Whether static track meshes with the same material and lod are merged into one section."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarTrackMeshMinInstances(
+	TEXT("kw.TrackMesh.MinInstances"),
+	4,
+	TEXT("Track meshes with the same geometry at this many places are drawn instanced, 0 disables instancing."),
+	ECVF_Default);
+
 // Sets default values
 ATrackMesh::ATrackMesh()
 {
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = false;
+	PrimaryActorTick.bCanEverTick = true;
+
+	// Only ticks while chunks are streamed
+	PrimaryActorTick.bStartWithTickEnabled = false;
+	PrimaryActorTick.TickInterval = 0.25f;
 
 	// LoadWorld
 	MeshComponent = CreateDefaultSubobject<URealtimeMeshComponent>(TEXT("MeshComponent"));
@@ -19,24 +43,430 @@ ATrackMesh::ATrackMesh()
 void ATrackMesh::LoadMesh()
 {
 	// Check weather game instance is not nullptr
-	if (!GameInstance) return;
+	if (!GameInstance)
+	{
+		FailLoad(EMeshLoadingResult_FAILED);
+		return;
+	}
 
 	// Load model
 	TrackModel = GameInstance->TrackLoader->Load(TrackName);
 
 	// Check weather model was imported without errors
-	if (!TrackModel.bSuccess) return;
+	if (!TrackModel.bSuccess)
+	{
+		FailLoad(EMeshLoadingResult_FAILED);
+		return;
+	}
+
+	BuildMesh();
+	OnLoaded.Broadcast(this);
+}
+
+void ATrackMesh::LoadMeshAsync()
+{
+	// Check weather game instance is not nullptr
+	if (!GameInstance)
+	{
+		FailLoad(EMeshLoadingResult_FAILED);
+		return;
+	}
+
+	// Only one load at a time
+	CancelLoad();
+
+	TWeakObjectPtr<ATrackMesh> WeakThis(this);
+	LoadHandle = GameInstance->TrackLoader->LoadAsync(
+		TrackName,
+		FOnTrackLoaded::CreateLambda([WeakThis](EMeshLoadingResult Result, FTrackModel& LoadedModel)
+		{
+			ATrackMesh* TrackMesh = WeakThis.Get();
+
+			// Handle of a cancelled load was already replaced
+			if (TrackMesh == nullptr || Result == EMeshLoadingResult_CANCELLED) return;
+
+			TrackMesh->LoadHandle.Reset();
+
+			// Check weather model was imported without errors
+			if (Result != EMeshLoadingResult_OK || !LoadedModel.bSuccess)
+			{
+				TrackMesh->FailLoad(Result != EMeshLoadingResult_OK ? Result : EMeshLoadingResult_FAILED);
+				return;
+			}
+
+			TrackMesh->TrackModel = MoveTemp(LoadedModel);
+
+			TrackMesh->BuildMesh();
+			TrackMesh->OnLoaded.Broadcast(TrackMesh);
+		}),
+		FOnMeshLoadProgress::CreateLambda([WeakThis](float Progress)
+		{
+			if (ATrackMesh* TrackMesh = WeakThis.Get())
+				TrackMesh->OnProgress.Broadcast(Progress);
+		}));
+}
+
+void ATrackMesh::FailLoad(EMeshLoadingResult Result)
+{
+	UE_LOG(LogTrackMesh, Error, TEXT("%s - Track can't be loaded!"), *TrackName);
+	OnLoadFailed.Broadcast(this, Result);
+}
+
+void ATrackMesh::CancelLoad()
+{
+	if (LoadHandle.IsValid())
+	{
+		LoadHandle->Cancel();
+		LoadHandle.Reset();
+	}
+}
+
+bool ATrackMesh::IsLoading() const
+{
+	return LoadHandle.IsValid() && !LoadHandle->IsDone();
+}
+
+void ATrackMesh::BuildMesh()
+{
+	// Drop what is left of a previous track
+	UnloadAllChunks();
+	Chunks.Reset();
+	DestroyInstances();
 
 	//LoadWorld
 	Mesh = MeshComponent->InitializeRealtimeMesh<URealtimeMeshSimple>();
-	for(int32 MeshIndex = 0; MeshIndex < TrackModel.Model.Meshes.Num(); MeshIndex++)
-		CreateMesh(MeshIndex);
+
+	// Repeated props are taken out before merging and chunking
+	BuildInstances();
+
+	if (bStreamChunks)
+	{
+		BuildChunks();
+		return;
+	}
+
+	// Static meshes with the same material and lod are drawn as one section
+	const TArray<FMeshData>* Meshes = &TrackModel.Model.Meshes;
+	TArray<FMeshData> MergedMeshes;
+	if (CVarTrackMeshMerge.GetValueOnGameThread() != 0)
+	{
+		MergedMeshes = FMeshMerger::MergeByMaterialAndLod(TrackModel.Model.Meshes);
+		Meshes = &MergedMeshes;
+	}
+
+	for (const FMeshData& MeshData : *Meshes)
+		CreateMesh(MeshData);
+
+	UE_LOG(LogTrackMesh, Log, TEXT("%s - %d sections with %d draw calls at lod 0, %d sections with %d draw calls without merging"),
+		*TrackName, Meshes->Num(), GetNumDrawCalls(*Meshes), TrackModel.Model.Meshes.Num(), GetNumDrawCalls(TrackModel.Model.Meshes));
+
+	// Report the chosen index widths
+	int32 NumWideMeshes = 0;
+	for (const FMeshData& MeshData : *Meshes)
+		if (FMeshStreamBuilder::NeedsWideIndices(MeshData))
+			NumWideMeshes++;
+	UE_LOG(LogTrackMesh, Log, TEXT("%s - %d meshes with 16 bit and %d with 32 bit indices"), *TrackName, Meshes->Num() - NumWideMeshes, NumWideMeshes);
 
 	// Create nodes with meshes
 	//USceneComponent* Scene = CreateNode(TrackModel.Model.NodeHierarchy);
 	//SetRootComponent(Scene);
 }
 
+void ATrackMesh::BuildInstances()
+{
+	const int32 MinInstances = CVarTrackMeshMinInstances.GetValueOnGameThread();
+	if (MinInstances <= 0)
+		return;
+
+	TArray<FInstancedMesh> InstancedMeshes = FMeshInstancer::ExtractInstances(TrackModel.Model.Meshes, MinInstances, InstancingReport);
+	for (const FInstancedMesh& InstancedMesh : InstancedMeshes)
+	{
+		int32 MaterialId = InstancedMesh.MeshData.MaterialId;
+		UMaterialInterface* Material = TrackModel.Model.Materials.IsValidIndex(MaterialId) ? TrackModel.Model.Materials[MaterialId] : nullptr;
+
+		// Create instanced component
+		UInstancedStaticMeshComponent* InstanceComponent = NewObject<UInstancedStaticMeshComponent>(this);
+		InstanceComponent->SetMobility(EComponentMobility::Movable);
+		InstanceComponent->SetGenerateOverlapEvents(false);
+		InstanceComponent->SetCollisionProfileName(UCollisionProfile::BlockAll_ProfileName);
+		InstanceComponent->SetStaticMesh(FMeshInstancer::BuildStaticMesh(InstanceComponent, InstancedMesh.MeshData, Material));
+		InstanceComponent->SetupAttachment(MeshComponent);
+		InstanceComponent->RegisterComponent();
+		AddInstanceComponent(InstanceComponent);
+
+		// Transforms are in the space of the track like the realtime meshes
+		InstanceComponent->AddInstances(InstancedMesh.Transforms, false);
+		InstanceComponents.Add(InstanceComponent);
+	}
+
+	UE_LOG(LogTrackMesh, Log, TEXT("%s - %d meshes drawn as %d instanced meshes, %.1f MB saved"),
+		*TrackName, InstancingReport.NumInstances, InstancingReport.NumInstancedMeshes, InstancingReport.SavedBytes / (1024.0 * 1024.0));
+}
+
+void ATrackMesh::DestroyInstances()
+{
+	for (UInstancedStaticMeshComponent* InstanceComponent : InstanceComponents)
+	{
+		if (InstanceComponent == nullptr) continue;
+		RemoveInstanceComponent(InstanceComponent);
+		InstanceComponent->DestroyComponent();
+	}
+
+	InstanceComponents.Reset();
+	InstancingReport = FMeshInstancingReport();
+}
+
+int32 ATrackMesh::GetNumDrawCalls(const TArray<FMeshData>& Meshes)
+{
+	// Every section has a single poly group, so it is one draw call when its lod is visible
+	int32 NumDrawCalls = 0;
+	for (const FMeshData& MeshData : Meshes)
+		if (MeshData.LodData.Lod == 0)
+			NumDrawCalls++;
+	return NumDrawCalls;
+}
+
+void ATrackMesh::BuildChunks()
+{
+	const float CellSize = FMath::Max(ChunkSize, 100.0f);
+
+	// Sort meshes into grid cells by the center of their bounds
+	TMap<FIntPoint, int32> ChunkIndices;
+	TArray<TArray<FMeshData>> ChunkMeshes;
+	for (FMeshData& MeshData : TrackModel.Model.Meshes)
+	{
+		FBox3f MeshBounds(MeshData.Positions);
+		FVector Center = FVector(MeshBounds.GetCenter());
+		FIntPoint Cell(FMath::FloorToInt32(Center.X / CellSize), FMath::FloorToInt32(Center.Y / CellSize));
+
+		int32* ChunkIndex = ChunkIndices.Find(Cell);
+		if (ChunkIndex == nullptr)
+		{
+			ChunkIndex = &ChunkIndices.Add(Cell, Chunks.AddDefaulted());
+			ChunkMeshes.AddDefaulted();
+			Chunks[*ChunkIndex].Cell = Cell;
+		}
+
+		Chunks[*ChunkIndex].Bounds += FBox(MeshBounds);
+		ChunkMeshes[*ChunkIndex].Add(MoveTemp(MeshData));
+	}
+
+	// Meshes now live in the chunks
+	TrackModel.Model.Meshes.Empty();
+
+	int64 TotalBytes = 0;
+	for (int32 ChunkIndex = 0; ChunkIndex < Chunks.Num(); ChunkIndex++)
+	{
+		FTrackChunk& Chunk = Chunks[ChunkIndex];
+		if (CVarTrackMeshMerge.GetValueOnGameThread() != 0)
+			ChunkMeshes[ChunkIndex] = FMeshMerger::MergeByMaterialAndLod(ChunkMeshes[ChunkIndex]);
+
+		for (const FMeshData& MeshData : ChunkMeshes[ChunkIndex])
+			Chunk.Bytes += FMeshStreamBuilder::GetStreamSize(MeshData);
+		TotalBytes += Chunk.Bytes;
+
+		Chunk.Meshes = MakeShared<TArray<FMeshData>, ESPMode::ThreadSafe>(MoveTemp(ChunkMeshes[ChunkIndex]));
+	}
+
+	UE_LOG(LogTrackMesh, Log, TEXT("%s - Split into %d chunks with %.1f MB"), *TrackName, Chunks.Num(), TotalBytes / (1024.0 * 1024.0));
+
+	UpdateChunks();
+	SetActorTickEnabled(true);
+}
+
+void ATrackMesh::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	if (Chunks.Num() > 0)
+		UpdateChunks();
+}
+
+void ATrackMesh::UpdateChunks()
+{
+	TArray<FVector> Locations;
+	GetViewerLocations(Locations);
+
+	// Distance of every chunk to the closest kart
+	TArray<TPair<double, int32>> Distances;
+	Distances.Reserve(Chunks.Num());
+	for (int32 ChunkIndex = 0; ChunkIndex < Chunks.Num(); ChunkIndex++)
+	{
+		double Distance = Locations.Num() > 0 ? TNumericLimits<double>::Max() : 0.0;
+		for (const FVector& Location : Locations)
+			Distance = FMath::Min(Distance, FMath::Sqrt(Chunks[ChunkIndex].Bounds.ComputeSquaredDistanceToPoint(Location)));
+		Distances.Emplace(Distance, ChunkIndex);
+	}
+	Distances.Sort([](const TPair<double, int32>& A, const TPair<double, int32>& B) { return A.Key < B.Key; });
+
+	// Unload chunks which are out of range
+	const double UnloadRadius = StreamingRadius * FMath::Max(UnloadRadiusScale, 1.0f);
+	for (const TPair<double, int32>& Distance : Distances)
+		if (Distance.Key > UnloadRadius && Chunks[Distance.Value].State != ETrackChunkState_UNLOADED)
+			UnloadChunk(Distance.Value);
+
+	// Load the closest chunks first while they fit into the budget
+	const int64 BudgetBytes = (int64)ResidencyBudgetMB * 1024 * 1024;
+
+	// Blueprints can set values below the clamp of the editor, nothing would ever load then
+	const int32 MaxLoads = FMath::Max(MaxConcurrentLoads, 1);
+	int64 PlannedBytes = 0;
+	for (const FTrackChunk& Chunk : Chunks)
+		if (Chunk.State != ETrackChunkState_UNLOADED)
+			PlannedBytes += Chunk.Bytes;
+
+	for (const TPair<double, int32>& Distance : Distances)
+	{
+		if (Distance.Key > StreamingRadius || NumLoadingChunks >= MaxLoads)
+			break;
+
+		FTrackChunk& Chunk = Chunks[Distance.Value];
+		if (Chunk.State != ETrackChunkState_UNLOADED)
+			continue;
+
+		// Make room by dropping the furthest chunks
+		for (int32 Index = Distances.Num() - 1; Index >= 0 && PlannedBytes + Chunk.Bytes > BudgetBytes; Index--)
+		{
+			FTrackChunk& FarChunk = Chunks[Distances[Index].Value];
+			if (Distances[Index].Key <= Distance.Key)
+				break;
+			if (FarChunk.State == ETrackChunkState_UNLOADED)
+				continue;
+
+			PlannedBytes -= FarChunk.Bytes;
+			UnloadChunk(Distances[Index].Value);
+		}
+
+		if (PlannedBytes + Chunk.Bytes > BudgetBytes)
+			break;
+
+		PlannedBytes += Chunk.Bytes;
+		LoadChunk(Distance.Value);
+	}
+}
+
+void ATrackMesh::LoadChunk(int32 ChunkIndex)
+{
+	FTrackChunk& Chunk = Chunks[ChunkIndex];
+	Chunk.State = ETrackChunkState_LOADING;
+	uint32 LoadSerial = ++Chunk.LoadSerial;
+	NumLoadingChunks++;
+
+	// Streams are built in background, only the upload runs on the game thread
+	TWeakObjectPtr<ATrackMesh> WeakThis(this);
+	TSharedPtr<const TArray<FMeshData>, ESPMode::ThreadSafe> Meshes = Chunk.Meshes;
+	Async(EAsyncExecution::ThreadPool, [WeakThis, ChunkIndex, LoadSerial, Meshes]()
+	{
+		TArray<FRealtimeMeshStreamSet> StreamSets;
+		StreamSets.SetNum(Meshes->Num());
+		for (int32 MeshIndex = 0; MeshIndex < Meshes->Num(); MeshIndex++)
+			FMeshStreamBuilder::Build((*Meshes)[MeshIndex], StreamSets[MeshIndex]);
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, ChunkIndex, LoadSerial, StreamSets = MoveTemp(StreamSets)]() mutable
+		{
+			if (ATrackMesh* TrackMesh = WeakThis.Get())
+				TrackMesh->FinishChunkLoad(ChunkIndex, LoadSerial, MoveTemp(StreamSets));
+		});
+	});
+}
+
+void ATrackMesh::FinishChunkLoad(int32 ChunkIndex, uint32 LoadSerial, TArray<FRealtimeMeshStreamSet>&& StreamSets)
+{
+	// Chunk was unloaded or the track was replaced in the meantime
+	if (!Chunks.IsValidIndex(ChunkIndex) || Chunks[ChunkIndex].LoadSerial != LoadSerial || Chunks[ChunkIndex].State != ETrackChunkState_LOADING)
+		return;
+
+	FTrackChunk& Chunk = Chunks[ChunkIndex];
+	NumLoadingChunks--;
+
+	// Create mesh component
+	URealtimeMeshComponent* ChunkComponent = NewObject<URealtimeMeshComponent>(this);
+	ChunkComponent->SetMobility(EComponentMobility::Movable);
+	ChunkComponent->SetGenerateOverlapEvents(false);
+	ChunkComponent->SetCollisionProfileName(UCollisionProfile::BlockAll_ProfileName);
+	ChunkComponent->SetupAttachment(MeshComponent);
+	ChunkComponent->RegisterComponent();
+	AddInstanceComponent(ChunkComponent);
+
+	// Create mesh
+	URealtimeMeshSimple* ChunkMesh = ChunkComponent->InitializeRealtimeMesh<URealtimeMeshSimple>();
+	for (int32 MeshIndex = 0; MeshIndex < StreamSets.Num(); MeshIndex++)
+	{
+		const FMeshData& MeshData = (*Chunk.Meshes)[MeshIndex];
+		int32 MaterialId = MeshData.MaterialId;
+
+		// Setup material
+		if (TrackModel.Model.Materials.IsValidIndex(MaterialId))
+			ChunkMesh->SetupMaterialSlot(MaterialId, EName::None, TrackModel.Model.Materials[MaterialId]);
+
+		const FRealtimeMeshSectionGroupKey GroupKey = FRealtimeMeshSectionGroupKey::CreateUnique(MeshData.LodData.Lod);
+		ChunkMesh->CreateSectionGroup(GroupKey, MoveTemp(StreamSets[MeshIndex]));
+
+		const FRealtimeMeshSectionKey PolyGroupKey = FRealtimeMeshSectionKey::CreateForPolyGroup(GroupKey, 0);
+		ChunkMesh->UpdateSectionConfig(PolyGroupKey, FRealtimeMeshSectionConfig(ERealtimeMeshSectionDrawType::Static, MaterialId), true);
+	}
+
+	Chunk.Component = ChunkComponent;
+	Chunk.State = ETrackChunkState_LOADED;
+	NumResidentChunks++;
+	ResidentBytes += Chunk.Bytes;
+
+	UE_LOG(LogTrackMesh, Verbose, TEXT("%s - Loaded chunk (%d, %d), %d chunks with %lld bytes resident"), *TrackName, Chunk.Cell.X, Chunk.Cell.Y, NumResidentChunks, ResidentBytes);
+}
+
+void ATrackMesh::UnloadChunk(int32 ChunkIndex)
+{
+	FTrackChunk& Chunk = Chunks[ChunkIndex];
+	Chunk.LoadSerial++;
+
+	if (Chunk.State == ETrackChunkState_LOADING)
+		NumLoadingChunks--;
+
+	if (Chunk.State == ETrackChunkState_LOADED)
+	{
+		NumResidentChunks--;
+		ResidentBytes -= Chunk.Bytes;
+	}
+
+	if (Chunk.Component != nullptr)
+	{
+		RemoveInstanceComponent(Chunk.Component);
+		Chunk.Component->DestroyComponent();
+		Chunk.Component = nullptr;
+	}
+
+	Chunk.State = ETrackChunkState_UNLOADED;
+
+	UE_LOG(LogTrackMesh, Verbose, TEXT("%s - Unloaded chunk (%d, %d), %d chunks with %lld bytes resident"), *TrackName, Chunk.Cell.X, Chunk.Cell.Y, NumResidentChunks, ResidentBytes);
+}
+
+void ATrackMesh::UnloadAllChunks()
+{
+	for (int32 ChunkIndex = 0; ChunkIndex < Chunks.Num(); ChunkIndex++)
+		if (Chunks[ChunkIndex].State != ETrackChunkState_UNLOADED)
+			UnloadChunk(ChunkIndex);
+
+	SetActorTickEnabled(false);
+}
+
+void ATrackMesh::GetViewerLocations(TArray<FVector>& Locations) const
+{
+	UWorld* World = GetWorld();
+	if (World == nullptr) return;
+
+	// Karts
+	for (TActorIterator<AChassiMesh> It(World); It; ++It)
+		Locations.Add(It->GetActorLocation());
+
+	// Cameras, e.g. while spectating
+	for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+	{
+		APlayerController* PlayerController = It->Get();
+		if (PlayerController != nullptr && PlayerController->PlayerCameraManager != nullptr)
+			Locations.Add(PlayerController->PlayerCameraManager->GetCameraLocation());
+	}
+}
+
 // Called when the game starts or when spawned
 void ATrackMesh::BeginPlay()
 {
@@ -47,6 +477,15 @@ void ATrackMesh::BeginPlay()
 	if (!GameInstance) UE_LOG(LogTrackMesh, Warning, TEXT("GameInstance can't be casted!"));
 }
 
+void ATrackMesh::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Don't keep importing a track nobody is waiting for
+	CancelLoad();
+	UnloadAllChunks();
+
+	Super::EndPlay(EndPlayReason);
+}
+
 /*USceneComponent* ATrackMesh::CreateNode(FNodeData& NodeData)
 {
 	// Create Node
@@ -90,26 +529,9 @@ void ATrackMesh::BeginPlay()
 	// Create mesh
 	URealtimeMeshSimple* Mesh = MeshComponent->InitializeRealtimeMesh<URealtimeMeshSimple>();
 
-	FRealtimeMeshStreamSet StreamSet;
-	TRealtimeMeshBuilderLocal<uint16, FPackedNormal, FVector2DHalf, 1> Builder(StreamSet);
-	Builder.EnableTangents();
-	Builder.EnableTexCoords();
-	Builder.EnablePolyGroups();
-	Builder.EnableColors();
-
 	// Load mesh
-	for (int32 VertexIndex = 0; VertexIndex < MeshData.Verticies.Num(); VertexIndex++)
-	{
-		Builder.AddVertex(MeshData.Verticies[VertexIndex].Position)
-			.SetNormalAndTangent(MeshData.Verticies[VertexIndex].Normal, MeshData.Verticies[VertexIndex].Tangent)
-			.SetTexCoords(MeshData.Verticies[VertexIndex].UV0);
-	}
-
-	for (int32 TriangleIndex = 0; TriangleIndex < MeshData.Triangles.Num(); TriangleIndex++)
-	{
-		FTriangleData &Triangle = MeshData.Triangles[TriangleIndex];
-		Builder.AddTriangle(Triangle.UV0, Triangle.UV1, Triangle.UV2, Triangle.PolyGroupIndex);
-	}
+	FRealtimeMeshStreamSet StreamSet;
+	FMeshStreamBuilder::Build(MeshData, StreamSet);
 
 	// Setup material
 	int32 MaterialId = MeshData.MaterialId;
@@ -125,32 +547,13 @@ void ATrackMesh::BeginPlay()
 	return MeshComponent;
 }*/
 
-URealtimeMeshComponent* ATrackMesh::CreateMesh(int32 MeshIndex)
+URealtimeMeshComponent* ATrackMesh::CreateMesh(const FMeshData& MeshData)
 {
-	if (!TrackModel.Model.Meshes.IsValidIndex(MeshIndex)) return nullptr;
-	FMeshData& MeshData = TrackModel.Model.Meshes[MeshIndex];
-
-	FRealtimeMeshStreamSet StreamSet;
-	TRealtimeMeshBuilderLocal<uint16, FPackedNormal, FVector2DHalf, 1> Builder(StreamSet);
-	Builder.EnableTangents();
-	Builder.EnableTexCoords();
-	Builder.EnablePolyGroups();
-	Builder.EnableColors();
-
 	// Load mesh
-	for (int32 VertexIndex = 0; VertexIndex < MeshData.Verticies.Num(); VertexIndex++)
-	{
-		Builder.AddVertex(MeshData.Verticies[VertexIndex].Position)
-			.SetNormalAndTangent(MeshData.Verticies[VertexIndex].Normal, MeshData.Verticies[VertexIndex].Tangent)
-			.SetTexCoords(MeshData.Verticies[VertexIndex].UV0);
-	}
+	FRealtimeMeshStreamSet StreamSet;
+	FMeshStreamBuilder::Build(MeshData, StreamSet);
 
 	int32 MaterialId = MeshData.MaterialId;
-	for (int32 TriangleIndex = 0; TriangleIndex < MeshData.Triangles.Num(); TriangleIndex++)
-	{
-		FTriangleData &Triangle = MeshData.Triangles[TriangleIndex];
-		Builder.AddTriangle(Triangle.UV0, Triangle.UV1, Triangle.UV2, 0);
-	}
 
 	// Setup material
 	if (TrackModel.Model.Materials.IsValidIndex(MaterialId))
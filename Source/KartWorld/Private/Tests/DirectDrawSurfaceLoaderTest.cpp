@@ -0,0 +1,76 @@
+// Copyright @ 2023 Fynn Haupt
+
+
+#include "Loader/TextureLoader/DirectDrawSurfaceLoader.h"
+#include "Tests/SyntheticDirectDrawSurface.h"
+#include "Misc/AutomationTest.h"
+#include "Engine/TextureCube.h"
+#include "Engine/Texture2DArray.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+static bool CheckSyntheticTexture(UTexture* Texture, FTexturePlatformData* PlatformData, UClass* ExpectedClass, uint32 MipCount, uint32 NumSlices)
+{
+	if (Texture == nullptr || !Texture->IsA(ExpectedClass) || PlatformData == nullptr)
+		return false;
+	if (PlatformData->Mips.Num() != (int32)MipCount || PlatformData->GetNumSlices() != (int32)NumSlices)
+		return false;
+
+	// Slices have to be laid out after each other within every mip
+	for (uint32 MipLevel = 0; MipLevel < MipCount; MipLevel++)
+	{
+		FTexture2DMipMap& Mip = PlatformData->Mips[MipLevel];
+		// Every mip has to have its data
+		const uint8* Data = (const uint8*)Mip.BulkData.LockReadOnly();
+		if (Data == nullptr || Mip.BulkData.GetBulkDataSize() < NumSlices) {
+			Mip.BulkData.Unlock();
+			return false;
+		}
+
+		int64 SliceSize = Mip.BulkData.GetBulkDataSize() / NumSlices;
+		bool bValid = true;
+		for (uint32 Slice = 0; Slice < NumSlices; Slice++)
+			bValid &= Data[SliceSize * Slice] == (uint8)(Slice * 16 + MipLevel) && Data[SliceSize * (Slice + 1) - 1] == (uint8)(Slice * 16 + MipLevel);
+		Mip.BulkData.Unlock();
+
+		if (!bValid)
+			return false;
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FDirectDrawSurfaceLoaderTest, "KartWorld.Loader.DirectDrawSurface",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::EngineFilter)
+
+// Writes synthetic 2D, array and cube map DDS files and checks that they load as a single texture each
+bool FDirectDrawSurfaceLoaderTest::RunTest(const FString& Parameters)
+{
+	FString Folder = FPaths::Combine(FPaths::AutomationTransientDir(), TEXT("DirectDrawSurfaceLoader"));
+	UDirectDrawSurfaceLoader* Loader = NewObject<UDirectDrawSurfaceLoader>();
+
+	auto RunCase = [&](const TCHAR* Name, uint32 ArraySize, bool bIsCubeMap, UClass* ExpectedClass, auto GetPlatformData)
+	{
+		const uint32 Size = 32;
+		const uint32 MipCount = 6;
+		FString FilePath = FPaths::Combine(Folder, FString(Name) + TEXT(".dds"));
+
+		if (!TestTrue(FString::Printf(TEXT("%s - File is written"), Name), FSyntheticDirectDrawSurface::Write(FilePath, Size, Size, MipCount, ArraySize, bIsCubeMap)))
+			return;
+		if (!TestEqual(FString::Printf(TEXT("%s - Load result"), Name), (int32)Loader->LoadTexture(FilePath), (int32)EErrorCode_OK))
+			return;
+		if (!TestEqual(FString::Printf(TEXT("%s - Number of textures"), Name), Loader->TextureArray.Num(), 1))
+			return;
+
+		TestTrue(FString::Printf(TEXT("%s - Class, mips and slices match"), Name),
+			CheckSyntheticTexture(Loader->TextureArray[0], GetPlatformData(Loader->TextureArray[0]), ExpectedClass, MipCount, bIsCubeMap ? 6 : ArraySize));
+	};
+
+	RunCase(TEXT("Texture2D"), 1, false, UTexture2D::StaticClass(), [](UTexture* Texture) { return Cast<UTexture2D>(Texture) ? Cast<UTexture2D>(Texture)->GetPlatformData() : nullptr; });
+	RunCase(TEXT("Texture2DArray"), 4, false, UTexture2DArray::StaticClass(), [](UTexture* Texture) { return Cast<UTexture2DArray>(Texture) ? Cast<UTexture2DArray>(Texture)->GetPlatformData() : nullptr; });
+	RunCase(TEXT("TextureCube"), 1, true, UTextureCube::StaticClass(), [](UTexture* Texture) { return Cast<UTextureCube>(Texture) ? Cast<UTextureCube>(Texture)->GetPlatformData() : nullptr; });
+
+	IFileManager::Get().DeleteDirectory(*Folder, false, true);
+	return true;
+}
+
+#endif
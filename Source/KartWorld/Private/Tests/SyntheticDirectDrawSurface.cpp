@@ -0,0 +1,50 @@
+// Copyright @ 2023 Fynn Haupt
+
+
+#include "Tests/SyntheticDirectDrawSurface.h"
+
+#if WITH_SYNTHETIC_FILES
+
+#include "Loader/TextureLoader/DirectDrawSurfaceLoader.h"
+
+bool FSyntheticDirectDrawSurface::Write(const FString& FilePath, uint32 Width, uint32 Height, uint32 MipCount, uint32 ArraySize, bool bIsCubeMap)
+{
+	DDS_HEADER Header = {};
+	Header.size = sizeof(DDS_HEADER);
+	Header.flags = DDS_HEADER_FLAGS_TEXTURE | DDS_HEADER_FLAGS_MIPMAP;
+	Header.width = Width;
+	Header.height = Height;
+	Header.depth = 1;
+	Header.mipMapCount = MipCount;
+	Header.ddspf.size = sizeof(DDS_PIXELFORMAT);
+	Header.ddspf.flags = DDS_FOURCC;
+	Header.ddspf.fourCC = MAKEFOURCC('D', 'X', '1', '0');
+
+	DDS_HEADER_DXT10 Header10 = {};
+	Header10.dxgiFormat = DXGI_FORMAT_BC1_UNORM;
+	Header10.resourceDimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+	Header10.miscFlag = bIsCubeMap ? 0x4 /* RESOURCE_MISC_TEXTURECUBE */ : 0;
+	Header10.arraySize = bIsCubeMap ? 1 : ArraySize;
+
+	TArray<uint8> File;
+	uint32 MagicValue = DDS_MAGIC;
+	File.Append((uint8*)&MagicValue, sizeof(uint32));
+	File.Append((uint8*)&Header, sizeof(DDS_HEADER));
+	File.Append((uint8*)&Header10, sizeof(DDS_HEADER_DXT10));
+
+	uint32 NumSlices = bIsCubeMap ? 6 : ArraySize;
+	for (uint32 Slice = 0; Slice < NumSlices; Slice++)
+	{
+		for (uint32 MipLevel = 0; MipLevel < MipCount; MipLevel++)
+		{
+			uint32 NumBlocksX = FMath::Max(1u, FMath::DivideAndRoundUp(FMath::Max(1u, Width >> MipLevel), 4u));
+			uint32 NumBlocksY = FMath::Max(1u, FMath::DivideAndRoundUp(FMath::Max(1u, Height >> MipLevel), 4u));
+			int32 Offset = File.AddUninitialized(NumBlocksX * NumBlocksY * 8);
+			FMemory::Memset(File.GetData() + Offset, (uint8)(Slice * 16 + MipLevel), NumBlocksX * NumBlocksY * 8);
+		}
+	}
+
+	return FFileHelper::SaveArrayToFile(File, *FilePath);
+}
+
+#endif
@@ -0,0 +1,22 @@
+// Copyright @ 2023 Fynn Haupt
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// Synthetic test files only exist in builds with automation tests or the editor
+#define WITH_SYNTHETIC_FILES (WITH_DEV_AUTOMATION_TESTS || WITH_EDITOR)
+
+#if WITH_SYNTHETIC_FILES
+
+/**
+ * Writes DDS files for the automation tests and the loader benchmark.
+ */
+class FSyntheticDirectDrawSurface
+{
+public:
+	// BC1 file with DX10 header, every block of a slice and mip is filled with the byte (Slice * 16 + Mip)
+	static bool Write(const FString& FilePath, uint32 Width, uint32 Height, uint32 MipCount, uint32 ArraySize = 1, bool bIsCubeMap = false);
+};
+
+#endif
@@ -0,0 +1,24 @@
+// Copyright @ 2023 Fynn Haupt
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "BakeTexturesCommandlet.generated.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogBakeTexturesCommandlet, Log, All);
+
+/**
+ * Bakes the DDS files of a mod into a texture pack.
+ * Usage: UnrealEditor-Cmd KartWorld.uproject -run=BakeTextures -Folder=<ModFolder>
+ */
+UCLASS()
+class KARTWORLD_API UBakeTexturesCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UBakeTexturesCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,29 @@
+// Copyright @ 2023 Fynn Haupt
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "BenchmarkLoadersCommandlet.generated.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogBenchmarkLoadersCommandlet, Log, All);
+
+/**
+ * Generates synthetic track, chassis and tire mods plus a set of 256 loose textures per scale and measures every loader on them.
+ * Each stage reports wall time, allocator calls and how much the used physical memory of the process grew, at the end and at its peak.
+ * Peaks are sampled every millisecond on a separate thread. Allocator calls need a build with stats and are -1 otherwise,
+ * both are process wide and include other threads. The first iteration runs without model and material file caches.
+ * Results are written as json.
+ * Needs a build with automation tests or the editor for the synthetic files, runs headless, eg. on a build server without a GPU:
+ * UnrealEditor-Cmd KartWorld.uproject -run=BenchmarkLoaders -nullrhi -unattended [-Scale=1] [-Iterations=3] [-Output=<File>] [-KeepFiles]
+ */
+UCLASS()
+class KARTWORLD_API UBenchmarkLoadersCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UBenchmarkLoadersCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
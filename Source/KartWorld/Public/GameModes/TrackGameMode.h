@@ -32,4 +32,11 @@ public:
 	AChassiMesh* ChassiMesh;
 
 	virtual void StartPlay() override;
+
+private:
+	UFUNCTION()
+	void OnTrackLoaded(ATrackMesh* LoadedTrackMesh);
+
+	UFUNCTION()
+	void OnTrackLoadFailed(ATrackMesh* FailedTrackMesh, TEnumAsByte<EMeshLoadingResult> Result);
 };
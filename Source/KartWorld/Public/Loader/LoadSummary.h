@@ -0,0 +1,87 @@
+// Copyright @ 2023 Fynn Haupt
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "LoadSummary.generated.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogLoadSummary, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("KartWorld Load"), STATGROUP_KartWorldLoad, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Ini"), STAT_KartWorldLoad_Ini, STATGROUP_KartWorldLoad, KARTWORLD_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Link"), STAT_KartWorldLoad_Link, STATGROUP_KartWorldLoad, KARTWORLD_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Model Cache"), STAT_KartWorldLoad_ModelCache, STATGROUP_KartWorldLoad, KARTWORLD_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Assimp"), STAT_KartWorldLoad_Assimp, STATGROUP_KartWorldLoad, KARTWORLD_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Lod"), STAT_KartWorldLoad_Lod, STATGROUP_KartWorldLoad, KARTWORLD_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Convert"), STAT_KartWorldLoad_Convert, STATGROUP_KartWorldLoad, KARTWORLD_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Material Files"), STAT_KartWorldLoad_MaterialFiles, STATGROUP_KartWorldLoad, KARTWORLD_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Textures"), STAT_KartWorldLoad_Textures, STATGROUP_KartWorldLoad, KARTWORLD_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Materials"), STAT_KartWorldLoad_Materials, STATGROUP_KartWorldLoad, KARTWORLD_API);
+
+USTRUCT(BlueprintType)
+struct KARTWORLD_API FLoadStage {
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	FString Name;
+
+	// Summed up when the stage runs more than once, eg. for every tire model
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	float Milliseconds = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 Count = 0;
+
+	// Bytes read or created by the stage, 0 when not tracked
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int64 Bytes = 0;
+};
+
+/**
+ * Timings and byte counts of the stages of a load, in the order they first ran.
+ */
+USTRUCT(BlueprintType)
+struct KARTWORLD_API FLoadSummary {
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	TArray<FLoadStage> Stages;
+
+	// Wall time of the whole load, stages can overlap with waiting for the game thread
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	float TotalMilliseconds = 0.0f;
+
+	FLoadStage& FindOrAddStage(const FString& Name);
+
+	void AddTime(const FString& Name, double Milliseconds);
+	void AddBytes(const FString& Name, int64 Bytes);
+
+	// Merges the stages of another summary, the total is left untouched
+	void Append(const FLoadSummary& Other);
+
+	void Log(const FString& Name) const;
+};
+
+/**
+ * Adds the time until the end of the scope to a stage of the summary.
+ */
+class KARTWORLD_API FLoadStageScope
+{
+private:
+	FLoadSummary& Summary;
+	const TCHAR* Name;
+	double StartTime;
+
+public:
+	FLoadStageScope(FLoadSummary& InSummary, const TCHAR* InName) : Summary(InSummary), Name(InName), StartTime(FPlatformTime::Seconds()) {}
+	~FLoadStageScope() { Summary.AddTime(Name, (FPlatformTime::Seconds() - StartTime) * 1000.0); }
+};
+
+// Trace event, cycle stat and summary stage of a load stage in one scope
+#define SCOPE_LOAD_STAGE(Summary, Stage) \
+	TRACE_CPUPROFILER_EVENT_SCOPE(KartWorldLoad_##Stage); \
+	SCOPE_CYCLE_COUNTER(STAT_KartWorldLoad_##Stage); \
+	FLoadStageScope LoadStageScope_##Stage(Summary, TEXT(#Stage))
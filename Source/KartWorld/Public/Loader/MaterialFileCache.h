@@ -0,0 +1,52 @@
+// Copyright @ 2023 Fynn Haupt
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Loader/MaterialLoader.h"
+#include "Misc/SecureHash.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogMaterialFileCache, Log, All);
+
+/**
+ * Parses .mat files once into FMaterialFile and keeps them in memory and as binary form (.kwmat) in the saved folder.
+ * Schema errors are reported when a file is parsed, not every time it is used.
+ */
+class KARTWORLD_API FMaterialFileCache
+{
+private:
+	// "KWMT"
+	static constexpr uint32 Magic = 0x544D574B;
+
+	// Increase whenever the layout of FMaterialFile changes
+	static constexpr uint32 Version = 1;
+
+	struct FEntry
+	{
+		int64 Size = 0;
+		FDateTime Timestamp;
+
+		// Invalid when the file can't be read
+		TSharedPtr<const FMaterialFile, ESPMode::ThreadSafe> MaterialFile;
+	};
+
+	static FCriticalSection EntriesLock;
+	static TMap<FString, FEntry> Entries;
+
+	// OutRefreshHash is set when only the timestamp of the material file changed, the cache should be saved again with it
+	static bool Load(const FString& MaterialPath, const FFileStatData& StatData, FMaterialFile& MaterialFile, FMD5Hash& OutRefreshHash);
+
+	static bool Save(const FString& MaterialPath, const FFileStatData& StatData, const FMD5Hash& Hash, FMaterialFile& MaterialFile);
+
+	// Reads the json and validates it against the material base
+	static bool Parse(const FString& MaterialPath, FMaterialFile& MaterialFile);
+
+	static void ResolvePaths(const FString& MaterialPath, FMaterialFile& MaterialFile);
+
+public:
+	// Mod folders stay untouched, the name is unique per material file
+	static FString GetCachePath(const FString& MaterialPath);
+
+	// Thread safe, returns an invalid pointer when the material file can't be read
+	static TSharedPtr<const FMaterialFile, ESPMode::ThreadSafe> Get(const FString& MaterialPath);
+};
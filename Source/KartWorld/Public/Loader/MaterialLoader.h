@@ -5,6 +5,8 @@
 #include "CoreMinimal.h"
 #include "UObject/NoExportTypes.h"
 #include "Loader/TextureLoader/DirectDrawSurfaceLoader.h"
+#include "Loader/TextureLoader/TextureCache.h"
+#include "Loader/LoadSummary.h"
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
@@ -20,6 +22,25 @@ enum EMaterialBase {
 	EMaterialBase_SpecGloss_Tiling		UMETA(DisplayName = "SpecGloss_Tiling")
 };
 
+USTRUCT(BlueprintType)
+struct KARTWORLD_API FMaterialReference {
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	FString Name;
+
+	// Diffuse texture path as written in the model, empty when the material has no diffuse texture
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	FString DiffusePath;
+
+	friend FArchive& operator<<(FArchive& Ar, FMaterialReference& MaterialReference)
+	{
+		Ar << MaterialReference.Name;
+		Ar << MaterialReference.DiffusePath;
+		return Ar;
+	}
+};
+
 USTRUCT(BlueprintType)
 struct KARTWORLD_API FOcclusionRoughnessMetallicMap {
 	GENERATED_BODY()
@@ -129,6 +150,103 @@ struct KARTWORLD_API FSpecGlossTilingJson {
 	FNormalMap NormalMap;
 };
 
+struct FMaterialFileMap {
+	bool bIsSet = false;
+
+	// Texture path as written in the material file, empty when the map has no texture
+	FString Path;
+
+	// Path relative to the material file resolved, not serialized
+	FString ResolvedPath;
+
+	friend FArchive& operator<<(FArchive& Ar, FMaterialFileMap& Map)
+	{
+		Ar << Map.bIsSet;
+		Ar << Map.Path;
+		return Ar;
+	}
+};
+
+/**
+ * Typed form of a .mat file, only holds the maps used by its material base.
+ * Parameters that aren't set keep the value of the base material.
+ */
+struct FMaterialFile {
+	EMaterialBase MaterialBase = EMaterialBase_MetalRoughness;
+
+	// Without maps only the base color or diffuse texture is set
+	bool bHasMaps = false;
+
+	TOptional<float> TilingScale;
+	TOptional<float> TilingVariation;
+
+	FMaterialFileMap OcclusionRoughnessMetallic;
+	TOptional<float> OcclusionStrength;
+	TOptional<float> RoughnessStrength;
+	TOptional<float> MetallicStrength;
+
+	FMaterialFileMap SpecGloss;
+	TOptional<float> SpecStrength;
+	TOptional<float> GlossStrength;
+
+	FMaterialFileMap Normal;
+	TOptional<float> NormalStrength;
+
+	FMaterialFileMap Emissive;
+	TOptional<float> EmissiveStrength;
+
+	void GetTexturePaths(TArray<FString>& OutPaths) const;
+
+	// Equal keys produce equal material instances
+	FString GetParameterKey() const;
+
+	friend FArchive& operator<<(FArchive& Ar, FMaterialFile& MaterialFile)
+	{
+		uint8 MaterialBase = (uint8)MaterialFile.MaterialBase;
+		Ar << MaterialBase;
+		MaterialFile.MaterialBase = (EMaterialBase)MaterialBase;
+
+		Ar << MaterialFile.bHasMaps;
+		Ar << MaterialFile.TilingScale;
+		Ar << MaterialFile.TilingVariation;
+		Ar << MaterialFile.OcclusionRoughnessMetallic;
+		Ar << MaterialFile.OcclusionStrength;
+		Ar << MaterialFile.RoughnessStrength;
+		Ar << MaterialFile.MetallicStrength;
+		Ar << MaterialFile.SpecGloss;
+		Ar << MaterialFile.SpecStrength;
+		Ar << MaterialFile.GlossStrength;
+		Ar << MaterialFile.Normal;
+		Ar << MaterialFile.NormalStrength;
+		Ar << MaterialFile.Emissive;
+		Ar << MaterialFile.EmissiveStrength;
+		return Ar;
+	}
+};
+
+struct FMaterialRequest {
+	int32 MaterialIndex = 0;
+
+	// Resolved diffuse texture path
+	FString TexturePath;
+
+	TSharedPtr<const FMaterialFile, ESPMode::ThreadSafe> MaterialFile;
+
+	// Base, textures and parameters, equal keys produce equal material instances
+	FString ParameterKey;
+};
+
+// Everything to create the materials of a model except the UObjects, prepared on a worker by the async mesh loader
+struct FMaterialPreload {
+	TArray<FMaterialRequest> Requests;
+
+	// Diffuse textures and maps of all requests
+	TArray<FString> TexturePaths;
+	FTexturePreload Textures;
+
+	double StartTime = 0.0;
+};
+
 /**
  * 
  */
@@ -160,16 +278,40 @@ public:
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
 	TArray<UMaterialInstanceDynamic*> Materials;
 
+	// Stages of the last LoadMaterials call
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	FLoadSummary LoadSummary;
+
 	UMaterialLoader();
 
 	TArray<UMaterialInstanceDynamic*> LoadMaterials(FString FolderPath, const aiScene* Scene);
 
+	TArray<UMaterialInstanceDynamic*> LoadMaterials(FString FolderPath, const TArray<FMaterialReference>& MaterialReferences);
+
+	// Collects everything needed to create the materials, doesn't touch any UObject
+	static TArray<FMaterialReference> GetMaterialReferences(const aiScene* Scene);
+
+	// Resolves the textures and material files of the references, doesn't touch any UObject and can run on a worker thread
+	static void PrepareMaterials(FString FolderPath, const TArray<FMaterialReference>& MaterialReferences, FMaterialPreload& Preload, FLoadSummary& Summary);
+
+	// Creates the material instances once the textures of the preload are in the texture cache, game thread only
+	TArray<UMaterialInstanceDynamic*> CreateMaterials(const TArray<FMaterialReference>& MaterialReferences, const FMaterialPreload& Preload, int32 NumLoadedTextures);
+
+	// Texture paths are either absolute or relative to the folder
+	static FString ResolveTexturePath(FString Path, const FString& FolderPath);
+
 private:
-	UMaterialInstanceDynamic* GenerateMetalRoughnessMaterial(FString BaseColorPath, aiMaterial* Material, TSharedPtr<FJsonObject> JsonObject);
+	bool HasBaseMaterials() const;
+
+	static void SetScalarParameter(UMaterialInstanceDynamic* MaterialInstance, FName Name, const TOptional<float>& Value);
+
+	static void SetTextureParameter(UMaterialInstanceDynamic* MaterialInstance, const FString& MaterialName, FName Name, const FMaterialFileMap& Map);
+
+	UMaterialInstanceDynamic* GenerateMetalRoughnessMaterial(FString BaseColorPath, const FString& MaterialName, const FMaterialFile& MaterialFile);
 
-	UMaterialInstanceDynamic* GenerateSpecGlossMaterial(FString DiffusePath, aiMaterial* Material, TSharedPtr<FJsonObject> JsonObject);
+	UMaterialInstanceDynamic* GenerateSpecGlossMaterial(FString DiffusePath, const FString& MaterialName, const FMaterialFile& MaterialFile);
 
-	UMaterialInstanceDynamic* GenerateMetalRoughnessTilingMaterial(FString BaseColorPath, aiMaterial* Material, TSharedPtr<FJsonObject> JsonObject);
+	UMaterialInstanceDynamic* GenerateMetalRoughnessTilingMaterial(FString BaseColorPath, const FString& MaterialName, const FMaterialFile& MaterialFile);
 
-	UMaterialInstanceDynamic* GenerateSpecGlossTilingMaterial(FString DiffusePath, aiMaterial* Material, TSharedPtr<FJsonObject> JsonObject);
+	UMaterialInstanceDynamic* GenerateSpecGlossTilingMaterial(FString DiffusePath, const FString& MaterialName, const FMaterialFile& MaterialFile);
 };
@@ -5,9 +5,12 @@
 #include "CoreMinimal.h"
 #include "UObject/NoExportTypes.h"
 #include "Loader/MaterialLoader.h"
+#include "Async/Future.h"
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
+#include <assimp/ProgressHandler.hpp>
+#include <atomic>
 #include "MeshLoader.generated.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(LogMeshLoader, Log, All);
@@ -18,9 +21,60 @@ enum EMeshLoadingResult
 	EMeshLoadingResult_OK = 0,
 	EMeshLoadingResult_NOFILE,
 	EMeshLoadingResult_NOSCENE,
-	EMeshLoadingResult_NOMESHES
+	EMeshLoadingResult_NOMESHES,
+	EMeshLoadingResult_CANCELLED,
+
+	// Anything else that prevents the load, e.g. a mod that can't be found
+	EMeshLoadingResult_FAILED
 };
 
+// Serializes an array of plain data in one block
+template <typename ElementType>
+FORCEINLINE void SerializePlainArray(FArchive& Ar, TArray<ElementType>& Array)
+{
+	static_assert(TIsPODType<ElementType>::Value, "Only plain data can be serialized in one block");
+
+	int32 Num = Array.Num();
+	Ar << Num;
+	if (Ar.IsLoading())
+	{
+		// Count comes from the file, a corrupt one must not allocate or read more than is left of it
+		const int64 RemainingBytes = Ar.TotalSize() - Ar.Tell();
+		if (Ar.IsError() || Num < 0 || (int64)Num * sizeof(ElementType) > RemainingBytes)
+		{
+			Ar.SetError();
+			Array.Empty();
+			return;
+		}
+		Array.SetNumUninitialized(Num);
+	}
+	Ar.Serialize(Array.GetData(), (int64)Num * sizeof(ElementType));
+}
+
+// Serializes an array element by element, same layout as the array operator
+template <typename ElementType>
+FORCEINLINE void SerializeArray(FArchive& Ar, TArray<ElementType>& Array)
+{
+	int32 Num = Array.Num();
+	Ar << Num;
+	if (Ar.IsLoading())
+	{
+		// Every element takes at least one byte, so a corrupt count can't allocate more than is left of the file
+		const int64 RemainingBytes = Ar.TotalSize() - Ar.Tell();
+		if (Ar.IsError() || Num < 0 || (int64)Num > RemainingBytes)
+		{
+			Ar.SetError();
+			Array.Empty();
+			return;
+		}
+		Array.Empty(Num);
+		Array.SetNum(Num);
+	}
+
+	for (int32 Index = 0; Index < Num && !Ar.IsError(); Index++)
+		Ar << Array[Index];
+}
+
 USTRUCT(BlueprintType)
 struct KARTWORLD_API FNodeData
 {
@@ -36,101 +90,255 @@ struct KARTWORLD_API FNodeData
 	TArray<int32> Meshes;
 
 	TArray<FNodeData> Nodes;
+
+	friend FArchive& operator<<(FArchive& Ar, FNodeData& NodeData)
+	{
+		Ar << NodeData.Name;
+		Ar << NodeData.Transform;
+		SerializePlainArray(Ar, NodeData.Meshes);
+		SerializeArray(Ar, NodeData.Nodes);
+		return Ar;
+	}
 };
 
 USTRUCT(BlueprintType)
-struct KARTWORLD_API FVertexData
+struct KARTWORLD_API FLodData
 {
 	GENERATED_BODY()
 
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
-	FVector3f Position;
+	int32 Lod = 0;
 
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
-	FVector3f Normal;
+	float ScreenSize = 0.0f;
+
+	friend FArchive& operator<<(FArchive& Ar, FLodData& LodData)
+	{
+		Ar << LodData.Lod;
+		Ar << LodData.ScreenSize;
+		return Ar;
+	}
+};
+
+USTRUCT(BlueprintType)
+struct KARTWORLD_API FMeshData
+{
+	GENERATED_BODY()
 
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
-	FVector3f Tangent;
+	int32 MaterialId = 0;
 
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
-	FLinearColor Color;
+	FLodData LodData;
 
+	// Vertex streams, all of them have the length of Positions or are empty when the model doesn't have the channel
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
-	FVector2f UV0;
+	TArray<FVector3f> Positions;
 
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
-	FVector2f UV1;
+	TArray<FVector3f> Normals;
 
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
-	FVector2f UV2;
+	TArray<FVector3f> Tangents;
 
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
-	FVector2f UV3;
-};
+	TArray<FColor> Colors;
 
-USTRUCT(BlueprintType)
-struct KARTWORLD_API FTriangleData
-{
-	GENERATED_BODY()
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	TArray<FVector2f> UV0;
 
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
-	int32 UV0 = 0;
+	TArray<FVector2f> UV1;
 
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
-	int32 UV1 = 0;
+	TArray<FVector2f> UV2;
 
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
-	int32 UV2 = 0;
+	TArray<FVector2f> UV3;
 
+	// Three indices per triangle
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
-	int32 PolyGroupIndex = 0;
+	TArray<int32> Indices;
+
+	int32 NumVertices() const { return Positions.Num(); }
+	int32 NumTriangles() const { return Indices.Num() / 3; }
+
+	friend FArchive& operator<<(FArchive& Ar, FMeshData& MeshData)
+	{
+		Ar << MeshData.MaterialId;
+		Ar << MeshData.LodData;
+
+		SerializePlainArray(Ar, MeshData.Positions);
+		SerializePlainArray(Ar, MeshData.Normals);
+		SerializePlainArray(Ar, MeshData.Tangents);
+		SerializePlainArray(Ar, MeshData.Colors);
+		SerializePlainArray(Ar, MeshData.UV0);
+		SerializePlainArray(Ar, MeshData.UV1);
+		SerializePlainArray(Ar, MeshData.UV2);
+		SerializePlainArray(Ar, MeshData.UV3);
+		SerializePlainArray(Ar, MeshData.Indices);
+
+		return Ar;
+	}
 };
 
 USTRUCT(BlueprintType)
-struct KARTWORLD_API FLodData
+struct KARTWORLD_API FModelData
 {
 	GENERATED_BODY()
 
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
-	int32 Lod = 0;
+	FNodeData NodeHierarchy;
 
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
-	float ScreenSize = 0.0f;
-};
-
-USTRUCT(BlueprintType)
-struct KARTWORLD_API FMeshData
-{
-	GENERATED_BODY()
+	TArray<FMeshData> Meshes;
 
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
-	int32 MaterialId;
+	TArray<FMaterialReference> MaterialReferences;
 
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
-	FLodData LodData;
+	TArray<UMaterialInstanceDynamic *> Materials;
 
+	// Stages of the import and the material creation, not serialized
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
-	TArray<FVertexData> Verticies;
+	FLoadSummary LoadSummary;
+
+	// Serializes everything except the materials, they get recreated from the material references
+	friend FArchive& operator<<(FArchive& Ar, FModelData& ModelData)
+	{
+		Ar << ModelData.NodeHierarchy;
+		SerializeArray(Ar, ModelData.Meshes);
+		SerializeArray(Ar, ModelData.MaterialReferences);
+		return Ar;
+	}
+};
 
-	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
-	TArray<FTriangleData> Triangles;
+/**
+ * Lookup tables of an assimp scene, built in a single pass over the node tree.
+ * Resolves the owning node of a mesh and the local and world matrix of a node without walking the tree again.
+ */
+class KARTWORLD_API FSceneIndex
+{
+private:
+	struct FNodeMatrices
+	{
+		FMatrix Local;
+		FMatrix World;
+	};
+
+	// Owning node of every mesh, nullptr when no node references the mesh
+	TArray<const aiNode*> MeshNodes;
+
+	TMap<const aiNode*, FNodeMatrices> NodeMatrices;
+
+	void AddNode(const aiNode* Node, const FMatrix& ParentWorldMatrix);
+
+public:
+	explicit FSceneIndex(const aiScene* InScene);
+
+	static FMatrix ConvertMatrix(const aiMatrix4x4& aiTransform);
+
+	const aiNode* GetMeshNode(int32 MeshIndex) const { return MeshNodes.IsValidIndex(MeshIndex) ? MeshNodes[MeshIndex] : nullptr; }
+
+	const FMatrix& GetLocalMatrix(const aiNode* Node) const { return NodeMatrices.FindChecked(Node).Local; }
+
+	const FMatrix& GetWorldMatrix(const aiNode* Node) const { return NodeMatrices.FindChecked(Node).World; }
 };
 
-USTRUCT(BlueprintType)
-struct KARTWORLD_API FModelData
+/**
+ * Lod settings of a model, read from the .lod file next to it.
+ * Loaded once per import and looked up by mesh name, safe to query from multiple threads.
+ */
+class KARTWORLD_API FLodTable
 {
-	GENERATED_BODY()
+private:
+	// Mesh names are compared case sensitive
+	struct FKeyFuncs : TDefaultMapKeyFuncs<FString, FLodData, false>
+	{
+		static FORCEINLINE bool Matches(const FString& A, const FString& B) { return A.Equals(B, ESearchCase::CaseSensitive); }
+		static FORCEINLINE uint32 GetKeyHash(const FString& Key) { return FCrc::StrCrc32(*Key); }
+	};
 
-	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
-	FNodeData NodeHierarchy;
+	TMap<FString, FLodData, FDefaultSetAllocator, FKeyFuncs> Entries;
 
-	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
-	TArray<FMeshData> Meshes;
+	mutable std::atomic<int32> NumLookups { 0 };
+	mutable std::atomic<int32> NumHits { 0 };
 
-	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
-	TArray<UMaterialInstanceDynamic *> Materials;
+public:
+	// Returns false when there is no lod file or it can't be read
+	bool Load(const FString& FilePath);
+
+	// Leaves the lod data untouched when the mesh has no entry
+	bool Find(const FString& MeshName, FLodData& LodData) const;
+
+	int32 Num() const { return Entries.Num(); }
+	int32 GetNumLookups() const { return NumLookups; }
+	int32 GetNumHits() const { return NumHits; }
 };
 
+DECLARE_DELEGATE_OneParam(FOnMeshLoadProgress, float /* Progress */);
+DECLARE_DELEGATE_TwoParams(FOnMeshLoadCompleted, EMeshLoadingResult /* Result */, FModelData& /* ModelData */);
+
+/**
+ * Handle of an asynchronous model import.
+ * Parsing, conversion and reading the material files and textures run on worker threads,
+ * only the textures and material instances are created on the game thread.
+ * Progress and completion callbacks are always executed on the game thread.
+ */
+class KARTWORLD_API FMeshLoadHandle : public TSharedFromThis<FMeshLoadHandle, ESPMode::ThreadSafe>
+{
+	friend class UMeshLoader;
+	friend class FMeshLoadProgressHandler;
+
+private:
+	FString FilePath;
+	bool bWorldSpace = false;
+
+	std::atomic<bool> bCancelled { false };
+	std::atomic<float> Progress { 0.0f };
+	std::atomic<float> ReportedProgress { 0.0f };
+
+	FOnMeshLoadProgress OnProgress;
+	FOnMeshLoadCompleted OnCompleted;
+
+	// Every load owns its importer, so multiple loads can run at the same time
+	Assimp::Importer Importer;
+
+	FModelData ModelData;
+
+	// Filled on a worker after the import, the game thread only creates the UObjects from it
+	FMaterialPreload MaterialPreload;
+
+	TPromise<EMeshLoadingResult> Promise;
+	TFuture<EMeshLoadingResult> Future;
+
+	void SetProgress(float NewProgress);
+
+public:
+	FMeshLoadHandle(FString InFilePath, bool bInWorldSpace);
+
+	// Requests cancellation, the completion callback is executed with EMeshLoadingResult_CANCELLED
+	void Cancel() { bCancelled = true; }
+
+	bool IsCancelled() const { return bCancelled; }
+
+	bool IsDone() const { return Future.IsReady(); }
+
+	// Only true when the load finished and the model was imported, false while loading, after a failure or a cancellation
+	bool IsSucceeded() const { return IsDone() && Future.Get() == EMeshLoadingResult_OK; }
+
+	// Progress between 0 and 1
+	float GetProgress() const { return Progress; }
+
+	const FString& GetFilePath() const { return FilePath; }
+
+	// Result of the load, becomes ready after the completion callback was executed
+	const TFuture<EMeshLoadingResult>& GetFuture() const { return Future; }
+};
+
+typedef TSharedRef<FMeshLoadHandle, ESPMode::ThreadSafe> FMeshLoadHandleRef;
+typedef TSharedPtr<FMeshLoadHandle, ESPMode::ThreadSafe> FMeshLoadHandlePtr;
+
 /**
  *
  */
@@ -143,28 +351,57 @@ private:
 	// Importer
 	Assimp::Importer Importer;
 
-	// Scene
-	const aiScene *Scene;
-
-	// Getting the FileManager
-	IPlatformFile& FileManager = FPlatformFileManager::Get().GetPlatformFile();
-
 public:
 	UFUNCTION(BlueprintCallable)
 	EMeshLoadingResult LoadRelative(
 		FString FilePath,
 		FModelData &ModelData);
 
+	// Bakes all meshes into world space, ready to upload as static geometry without a node hierarchy
 	UFUNCTION(BlueprintCallable)
 	EMeshLoadingResult LoadWorld(
 		FString FilePath,
 		FModelData &ModelData);
 
+	// Same as LoadWorld without creating materials, so the caller can skip them for models it doesn't keep
+	EMeshLoadingResult ImportWorld(
+		FString FilePath,
+		FModelData &ModelData);
+
+	// Creates the materials of a model imported with ImportWorld
+	void LoadMaterials(
+		FString FilePath,
+		FModelData &ModelData);
+
+	// Imports the model on a worker thread, the meshes keep the relative transform of their node
+	FMeshLoadHandleRef LoadRelativeAsync(
+		FString FilePath,
+		FOnMeshLoadCompleted OnCompleted,
+		FOnMeshLoadProgress OnProgress = FOnMeshLoadProgress());
+
+	// Imports the model on a worker thread, the meshes are transformed into world space
+	FMeshLoadHandleRef LoadWorldAsync(
+		FString FilePath,
+		FOnMeshLoadCompleted OnCompleted,
+		FOnMeshLoadProgress OnProgress = FOnMeshLoadProgress());
+
 private:
-	FTransform GetTransformOfNode(aiNode *Node);
-	FTransform GetWorldTransformOfNode(aiNode *Node);
-	FMatrix GetWorldTransformOfNode(aiNode *Node, FMatrix WorldMatrix);
-	FNodeData GetNodeHierarchy(aiNode *Node);
-	aiNode* GetParentNode(aiNode* Node, int32 SearchMeshIndex);
-	bool GetLodData(FString FilePath, FString SearchMeshName, FLodData& LodData);
+	// Import and material files on a worker, loaders of missing textures on the game thread,
+	// parsing the textures on a worker and creating textures and materials on the game thread
+	static FMeshLoadHandleRef StartAsyncLoad(FMeshLoadHandleRef Handle);
+	static void ParseTexturesAsync(FMeshLoadHandleRef Handle, EMeshLoadingResult Result);
+	static void FinishAsyncLoad(FMeshLoadHandleRef Handle, EMeshLoadingResult Result);
+
+	// Thread safe import stages, they don't touch any UObject
+	static EMeshLoadingResult ImportModel(Assimp::Importer& InImporter, const FString& FilePath, bool bWorldSpace, FModelData& ModelData, FMeshLoadHandle* Handle);
+	static EMeshLoadingResult ReadScene(Assimp::Importer& InImporter, const FString& FilePath, const aiScene*& OutScene);
+	static EMeshLoadingResult ConvertScene(const aiScene* InScene, const FString& FilePath, bool bWorldSpace, FModelData& ModelData, FMeshLoadHandle* Handle);
+
+	// Fill the mesh streams in bulk, channels the mesh doesn't have stay empty
+	// With a world matrix the vertices are baked into world space
+	static void ConvertVertices(const aiMesh* Mesh, const FMatrix* WorldMatrix, FMeshData& MeshData);
+	static void ConvertIndices(const aiMesh* Mesh, FMeshData& MeshData);
+
+	static FTransform GetTransformOfNode(const FSceneIndex& SceneIndex, const aiNode *Node);
+	static FNodeData GetNodeHierarchy(const FSceneIndex& SceneIndex, const aiNode *Node);
 };
@@ -141,6 +141,10 @@ public:
 	// Model
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
 	FModelData Model;
+
+	// Stages of the load, including the ones of the models
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	FLoadSummary LoadSummary;
 };
 
 /**
@@ -156,9 +160,11 @@ private:
 	IPlatformFile& FileManager = FPlatformFileManager::Get().GetPlatformFile();
 
 	bool GetLinking(FString FilePath, FChassiLinking& ChassiLinking);
-	bool GetConfiguration(FString FilePath, FChassiConfiguration& ChassiConfiguration);
 	
 public:
+	// Parses a mod ini file, thread safe
+	bool GetConfiguration(FString FilePath, FChassiConfiguration& ChassiConfiguration);
+
 	// Mods Directory
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
 	FString ModsDir;
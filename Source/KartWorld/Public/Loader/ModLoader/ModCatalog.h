@@ -0,0 +1,101 @@
+// Copyright @ 2023 Fynn Haupt
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/NoExportTypes.h"
+#include "Containers/Ticker.h"
+#include "Async/Future.h"
+#include "Loader/ModLoader/TrackLoader.h"
+#include "Loader/ModLoader/ChassiLoader.h"
+#include "Loader/ModLoader/TireLoader.h"
+#include "ModCatalog.generated.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogModCatalog, Log, All);
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnModCatalogChanged);
+
+/**
+ * Configurations of all installed mods, keyed by the name of their folder.
+ * Mods are scanned in the background and their ini files parsed in parallel, the mods directories are polled for changes.
+ * Lookups and enumeration only read memory and are game thread only.
+ */
+UCLASS()
+class KARTWORLD_API UModCatalog : public UObject
+{
+	GENERATED_BODY()
+
+private:
+	struct FScanResult
+	{
+		TMap<FString, FTrackConfiguration> Tracks;
+		TMap<FString, FChassiConfiguration> Chassis;
+		TMap<FString, FTireConfiguration> Tires;
+		uint32 Fingerprint = 0;
+	};
+
+	UPROPERTY()
+	TObjectPtr<UTrackLoader> TrackLoader;
+
+	UPROPERTY()
+	TObjectPtr<UChassiLoader> ChassiLoader;
+
+	UPROPERTY()
+	TObjectPtr<UTireLoader> TireLoader;
+
+	uint32 Fingerprint = 0;
+	bool bIsScanning = false;
+	bool bIsReady = false;
+	TFuture<void> ScanFuture;
+	FTSTicker::FDelegateHandle TickerHandle;
+
+	// Mod folders of a mods directory with the size and modification time of their ini file, thread safe
+	static uint32 GetFingerprint(const FString& ModsDir, uint32 Fingerprint);
+
+	// Only reads the ini files, thread safe
+	static void Scan(UTrackLoader* InTrackLoader, UChassiLoader* InChassiLoader, UTireLoader* InTireLoader, FScanResult& Result);
+
+	bool Poll(float DeltaTime);
+	void StartScan(bool bOnlyWhenChanged);
+	void FinishScan(FScanResult&& Result);
+
+public:
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	TMap<FString, FTrackConfiguration> Tracks;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	TMap<FString, FChassiConfiguration> Chassis;
+
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	TMap<FString, FTireConfiguration> Tires;
+
+	// Broadcast on the game thread whenever a scan found different mods
+	UPROPERTY(BlueprintAssignable)
+	FOnModCatalogChanged OnChanged;
+
+	// Loaders have to be initialized, their mods directories are scanned
+	void Initialize(UTrackLoader* InTrackLoader, UChassiLoader* InChassiLoader, UTireLoader* InTireLoader);
+
+	// Scans again in the background, eg. after installing a mod
+	UFUNCTION(BlueprintCallable)
+	void Refresh();
+
+	// False until the first scan finished
+	UFUNCTION(BlueprintPure)
+	bool IsReady() const { return bIsReady; }
+
+	UFUNCTION(BlueprintPure)
+	TArray<FString> GetTrackNames() const;
+
+	UFUNCTION(BlueprintPure)
+	TArray<FString> GetChassiNames() const;
+
+	UFUNCTION(BlueprintPure)
+	TArray<FString> GetTireNames() const;
+
+	bool FindTrack(const FString& Name, FTrackConfiguration& OutConfiguration) const;
+	bool FindChassi(const FString& Name, FChassiConfiguration& OutConfiguration) const;
+	bool FindTire(const FString& Name, FTireConfiguration& OutConfiguration) const;
+
+	virtual void BeginDestroy() override;
+};
@@ -6,6 +6,8 @@
 #include "UObject/NoExportTypes.h"
 #include "ModLoader.generated.h"
 
+class UModCatalog;
+
 /**
  * 
  */
@@ -20,6 +22,10 @@ protected:
 	FString GameModDir;
 
 public:
+	// Already parsed configurations of the installed mods, loaders read the ini file when a mod isn't in there
+	UPROPERTY()
+	TObjectPtr<UModCatalog> Catalog;
+
 	UModLoader();
 
 	// Initialize loader in game instance
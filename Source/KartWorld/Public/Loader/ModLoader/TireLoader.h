@@ -40,6 +40,22 @@ public:
 	FString ModelRr;
 };
 
+// Which of the unique tire models is used at a corner and how it is mirrored
+USTRUCT(BlueprintType)
+struct KARTWORLD_API FTireCorner
+{
+	GENERATED_BODY()
+
+public:
+	// Index into the models of the tire, INDEX_NONE when the model can't be loaded
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 ModelIndex = INDEX_NONE;
+
+	// Scale applied to the model, -1 on the mirrored axis
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	FVector Mirror = FVector::OneVector;
+};
+
 USTRUCT(BlueprintType)
 struct KARTWORLD_API FTireModel
 {
@@ -47,12 +63,7 @@ struct KARTWORLD_API FTireModel
 
 public:
 	FTireModel();
-	FTireModel(
-		FTireConfiguration Configuration,
-		FModelData ModelFl,
-		FModelData ModelFr,
-		FModelData ModelRl,
-		FModelData ModelRr);
+	FTireModel(FTireConfiguration Configuration);
 
 	// Success
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
@@ -62,21 +73,29 @@ public:
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
 	FTireConfiguration Configuration;
 
-	// Model Fl
+	// Unique models, corners with the same or a mirrored model share one
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	TArray<FModelData> Models;
+
+	// Corner Fl
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	FTireCorner Fl;
+
+	// Corner Fr
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
-	FModelData ModelFl;
+	FTireCorner Fr;
 
-	// Model Fr
+	// Corner Rl
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
-	FModelData ModelFr;
+	FTireCorner Rl;
 
-	// Model Rl
+	// Corner Rr
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
-	FModelData ModelRl;
+	FTireCorner Rr;
 
-	// Model Rr
+	// Stages of the load, including the ones of the models
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
-	FModelData ModelRr;
+	FLoadSummary LoadSummary;
 };
 
 /**
@@ -91,9 +110,14 @@ private:
 	// Getting the FileManager
 	IPlatformFile &FileManager = FPlatformFileManager::Get().GetPlatformFile();
 
-	bool GetConfiguration(FString FilePath, FTireConfiguration &TireConfiguration);
+	// Returns the scale which maps Model onto Other, false when they aren't copies or mirror images.
+	// Positions, normals, UV0 and triangles have to match, mirror images with reversed winding.
+	static bool FindMirror(const FModelData& Model, const FModelData& Other, FVector& Mirror);
 
 public:
+	// Parses a mod ini file, thread safe
+	bool GetConfiguration(FString FilePath, FTireConfiguration &TireConfiguration);
+
 	// Mods Directory
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
 	FString ModsDir;
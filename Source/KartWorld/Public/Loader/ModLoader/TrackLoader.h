@@ -70,8 +70,14 @@ public:
 
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
 	FModelData Model;
+
+	// Stages of the load, including the ones of the models
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	FLoadSummary LoadSummary;
 };
 
+DECLARE_DELEGATE_TwoParams(FOnTrackLoaded, EMeshLoadingResult /* Result */, FTrackModel& /* TrackModel */);
+
 /**
  * 
  */
@@ -83,10 +89,11 @@ class KARTWORLD_API UTrackLoader : public UModLoader
 private:
 	// Getting the FileManager
 	IPlatformFile& FileManager = FPlatformFileManager::Get().GetPlatformFile();
-
-	bool GetConfiguration(FString FilePath, FTrackConfiguration& TrackConfiguration);
 	
 public:
+	// Parses a mod ini file, thread safe
+	bool GetConfiguration(FString FilePath, FTrackConfiguration& TrackConfiguration);
+
 	// Mods Directory
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
 	FString ModsDir;
@@ -99,4 +106,12 @@ public:
 	// Load track mod by name
 	UFUNCTION(BlueprintCallable)
 	FTrackModel Load(FString TrackName);
+
+	// Load track mod by name without blocking the game thread, returns nullptr when the track can't be found.
+	// OnLoaded is also executed after a failure or cancellation, right away with EMeshLoadingResult_FAILED when the track can't be found.
+	// The model is only valid with EMeshLoadingResult_OK.
+	FMeshLoadHandlePtr LoadAsync(FString TrackName, FOnTrackLoaded OnLoaded, FOnMeshLoadProgress OnProgress = FOnMeshLoadProgress());
+
+private:
+	bool GetModelPath(FString TrackName, FTrackConfiguration& TrackConfiguration, FString& ModelPath);
 };
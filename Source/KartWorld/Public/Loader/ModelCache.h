@@ -0,0 +1,72 @@
+// Copyright @ 2023 Fynn Haupt
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Loader/MeshLoader.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogModelCache, Log, All);
+
+/**
+ * Pre-baked binary form (.kwmesh) of an imported model, stored next to the model file.
+ * A cache file is only used when it was baked from the same source file, lod file and files the importer read besides the source
+ * (e.g. the material library of an OBJ), which is checked by size and modification time and falls back to the content hash.
+ * Loaded models are validated, so a corrupt cache can't produce streams or indices the mesh builders would read past.
+ */
+class KARTWORLD_API FModelCache
+{
+private:
+	// "KWMS"
+	static constexpr uint32 Magic = 0x534D574B;
+
+	// Increase whenever the layout of FModelData changes
+	static constexpr uint32 Version = 4;
+
+	struct FDependencyStamp
+	{
+		// Relative to the folder of the source
+		FString Path;
+		int64 Size = 0;
+		FDateTime Timestamp;
+		FMD5Hash Hash;
+
+		friend FArchive& operator<<(FArchive& Ar, FDependencyStamp& Stamp)
+		{
+			Ar << Stamp.Path;
+			Ar << Stamp.Size;
+			Ar << Stamp.Timestamp;
+			Ar << Stamp.Hash;
+			return Ar;
+		}
+	};
+
+	struct FSourceStamp
+	{
+		int64 Size = 0;
+		FDateTime Timestamp;
+		FDateTime LodTimestamp;
+		FMD5Hash Hash;
+		TArray<FDependencyStamp> Dependencies;
+	};
+
+	static bool GetSourceStamp(const FString& SourcePath, FSourceStamp& OutStamp);
+
+	// Returns false when a dependency was changed or removed, bOutRefreshStamp is set when only modification times changed
+	static bool AreDependenciesUpToDate(const FString& SourcePath, TArray<FDependencyStamp>& Dependencies, bool& bOutRefreshStamp);
+
+	// Streams, indices and references of a model read from the cache
+	static bool IsValid(const FModelData& ModelData);
+	static bool IsValid(const FNodeData& NodeData, int32 NumMeshes);
+
+	// Stamp is passed in, so a refreshed stamp doesn't hash the files again
+	static bool Write(const FString& SourcePath, bool bWorldSpace, FModelData& ModelData, FSourceStamp& SourceStamp);
+
+public:
+	static FString GetCachePath(const FString& SourcePath);
+
+	// Returns false when there is no valid cache for the source file
+	static bool Load(const FString& SourcePath, bool bWorldSpace, FModelData& ModelData);
+
+	// Dependencies are the other files the importer read, eg. the material library of an OBJ
+	static bool Save(const FString& SourcePath, bool bWorldSpace, FModelData& ModelData, const TArray<FString>& Dependencies);
+};
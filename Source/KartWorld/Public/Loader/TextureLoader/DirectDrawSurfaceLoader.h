@@ -4,6 +4,8 @@
 
 #include "CoreMinimal.h"
 #include "Loader/TextureLoader/TextureLoader.h"
+#include "Loader/TextureLoader/PixelConverter.h"
+#include "Loader/TextureLoader/TexturePack.h"
 #include "DirextXTex/DDS.h"
 #include "DirectDrawSurfaceLoader.generated.h"
 
@@ -11,6 +13,21 @@ DECLARE_LOG_CATEGORY_EXTERN(LogDirectDrawLoader, Log, All);
 
 using namespace DirectX;
 
+// Where every mip of a single 2D texture is stored, kept after parsing so streaming can read one mip without parsing the file again
+struct FTextureFileLayout
+{
+	// DDS file or texture pack
+	FString FilePath;
+	int64 FileSize = 0;
+
+	EPixelFormat PixelFormat = PF_Unknown;
+	EPixelConversion Conversion = EPixelConversion_NONE;
+	TArray<uint32> Palette;
+
+	// One per mip of the source file, mips which weren't baked into a pack have no size
+	TArray<FTexturePackMip> Mips;
+};
+
 /**
  * 
  */
@@ -22,6 +39,23 @@ class KARTWORLD_API UDirectDrawSurfaceLoader : public UTextureLoader
 private:
 	const uint16 MaxSize = 8192;
 
+	// Parsed file waiting for CreateTextures, all faces and slices share one resource
+	FTexturePlatformData* PlatformData = nullptr;
+
+	uint32 NumFileMips = 0;
+	uint32 NumSkippedMips = 0;
+
+	// Only filled for single 2D textures
+	FTextureFileLayout Layout;
+
+	// Read by ParseMip, waiting for UpdateTexture
+	FTexture2DMipMap* ParsedMip = nullptr;
+
+	void ReleasePlatformData();
+
+	// Largest mip that gets loaded, streamable textures are additionally limited by the requested resolution
+	uint32 GetMaxMipSize(uint32 MaxResolution, bool bIsStreamable) const;
+
 	uint32 BitsPerPixel(DXGI_FORMAT Format);
 	DXGI_FORMAT GetDxgiFormat(const DDS_PIXELFORMAT& ddpf);
 	EPixelFormat GetPixelFormat(DXGI_FORMAT Format);
@@ -40,4 +74,32 @@ private:
 
 public:
 	virtual EErrorCode LoadTexture(FString FilePath) override;
+
+	// Reads the file and fills the mips, doesn't touch any UObject and can run on a worker thread.
+	// Mips larger than kw.Textures.MaxSize are skipped, MaxResolution further limits single 2D textures (0 for no limit).
+	EErrorCode ParseTexture(FString FilePath, uint32 MaxResolution);
+
+	// Reads the mips from a baked texture pack instead of the DDS file, can run on a worker thread
+	EErrorCode ParsePackedTexture(const class FTexturePack& Pack, const struct FTexturePackEntry& Entry, uint32 MaxResolution);
+
+	const FTexturePlatformData* GetPlatformData() const { return PlatformData; }
+
+	// Creates a UTexture2D, UTextureCube or UTexture2DArray of the parsed file, game thread only
+	EErrorCode CreateTextures();
+
+	// Reads a single mip of an earlier parsed 2D texture, can run on a worker thread.
+	// Returns EErrorCode_OVERFLOW when the mip is above the size limit or wasn't baked into the pack.
+	EErrorCode ParseMip(const FTextureFileLayout& FileLayout, uint32 MipLevel);
+
+	// Puts the parsed mip on top of an existing 2D texture, only that mip is uploaded, game thread only
+	EErrorCode UpdateTexture(UTexture2D* Texture);
+
+	// Removes the top mips of a 2D texture again, game thread only
+	static EErrorCode DropMips(UTexture2D* Texture, uint32 NumMips);
+
+	uint32 GetNumFileMips() const { return NumFileMips; }
+	uint32 GetNumSkippedMips() const { return NumSkippedMips; }
+	const FTextureFileLayout& GetLayout() const { return Layout; }
+
+	virtual void BeginDestroy() override;
 };
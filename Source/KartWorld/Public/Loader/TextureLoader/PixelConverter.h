@@ -0,0 +1,51 @@
+// Copyright @ 2023 Fynn Haupt
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "DirextXTex/DDS.h"
+
+using namespace DirectX;
+
+enum EPixelConversion {
+	EPixelConversion_NONE = 0,
+	EPixelConversion_RGB24,
+	EPixelConversion_PAL8,
+	EPixelConversion_B5G6R5,
+	EPixelConversion_B5G5R5A1,
+	EPixelConversion_B4G4R4A4,
+	EPixelConversion_B8G8R8X8,
+	EPixelConversion_YUY2,
+	EPixelConversion_MAX
+};
+
+/**
+ * Converts DDS pixel formats the RHI can't sample into B8G8R8A8 on the CPU.
+ * Rows are converted with SSE or NEON where the platform has it, scalar code handles the rest.
+ * Has no state and can be used from any thread.
+ */
+class KARTWORLD_API FPixelConverter
+{
+public:
+	// Legacy pixel formats without DXGI equivalent, like 24 bit RGB and 8 bit palettes
+	static EPixelConversion GetLegacyConversion(const DDS_PIXELFORMAT& PixelFormat);
+
+	// DXGI formats without matching EPixelFormat
+	static EPixelConversion GetConversion(DXGI_FORMAT Format);
+
+	static const TCHAR* GetName(EPixelConversion Conversion);
+
+	static uint32 GetSourceRowBytes(EPixelConversion Conversion, uint32 Width);
+
+	// Converts into tightly packed B8G8R8A8 rows, the palette is only used by PAL8 and holds 256 B8G8R8A8 colors
+	static void Convert(EPixelConversion Conversion, const uint8* Src, uint8* Dst, uint32 Width, uint32 Height, const uint32* Palette, bool bForceScalar = false);
+
+	// Converts the palette of a legacy file, stored as R8G8B8A8, into B8G8R8A8
+	static void ConvertPalette(const uint8* Src, uint32* Dst);
+
+private:
+	static void ConvertRowScalar(EPixelConversion Conversion, const uint8* Src, uint32* Dst, uint32 Width, const uint32* Palette);
+
+	// Returns the number of converted pixels, the scalar code converts the rest of the row
+	static uint32 ConvertRowVector(EPixelConversion Conversion, const uint8* Src, uint32* Dst, uint32 Width);
+};
@@ -0,0 +1,220 @@
+// Copyright @ 2023 Fynn Haupt
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/GCObject.h"
+#include "UObject/StrongObjectPtr.h"
+#include "Containers/Ticker.h"
+#include "GenericPlatform/GenericPlatformFile.h"
+#include "Loader/TextureLoader/TextureLoader.h"
+#include "Loader/TextureLoader/DirectDrawSurfaceLoader.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogTextureCache, Log, All);
+
+struct FTextureCacheStats
+{
+	int32 Hits = 0;
+	int32 Misses = 0;
+	int32 Evictions = 0;
+	int32 NumTextures = 0;
+	int64 ResidentBytes = 0;
+};
+
+struct FTextureMemoryUsage
+{
+	int32 NumTextures = 0;
+
+	// Mip bulk data kept in system memory
+	int64 CpuBytes = 0;
+
+	// Resident mips of the texture resource
+	int64 GpuBytes = 0;
+
+	void Add(const FTextureMemoryUsage& Other)
+	{
+		NumTextures += Other.NumTextures;
+		CpuBytes += Other.CpuBytes;
+		GpuBytes += Other.GpuBytes;
+	}
+};
+
+struct FTextureMemoryReport
+{
+	struct FTexture
+	{
+		FString FilePath;
+		FString Mod;
+		TArray<FString> Materials;
+		FTextureMemoryUsage Usage;
+	};
+
+	TArray<FTexture> Textures;
+
+	// Textures shared by several materials count towards each of them
+	TMap<FString, FTextureMemoryUsage> Materials;
+
+	// Keyed by "<Category>/<Mod>", each texture counts towards one mod
+	TMap<FString, FTextureMemoryUsage> Mods;
+
+	FTextureMemoryUsage Total;
+};
+
+// Preload split into its steps, so the file work can run on a worker while the textures are created on the game thread
+struct FTexturePreload
+{
+	// Normalized paths of the files which exist and the content hashes of their files
+	TArray<FString> Paths;
+	TArray<FFileStatData> StatData;
+	TArray<FString> Hashes;
+
+	// Textures which weren't cached yet, their loaders are created on the game thread
+	TArray<FString> MissingPaths;
+	TArray<FString> MissingHashes;
+	TArray<TStrongObjectPtr<class UDirectDrawSurfaceLoader>> Loaders;
+	TArray<EErrorCode> Errors;
+	uint32 StartResolution = 0;
+};
+
+/**
+ * Process wide cache of loaded textures, shared by all materials and models.
+ * Textures are keyed by the content hash of their file, so the same file behind different paths is only loaded once.
+ * A texture stays referenced while one of its owners is alive, unreferenced textures get evicted when the cache exceeds its budget.
+ * With kw.TextureStreaming.Enable, 2D textures start at a low top mip and stream in higher mips while they are rendered.
+ * Only usable from the game thread, except the preload steps marked thread safe.
+ * Created and destroyed by the module, so it never outlives the garbage collection or the core ticker.
+ */
+class KARTWORLD_API FTextureCache : public FGCObject
+{
+private:
+	struct FPathEntry
+	{
+		int64 Size = 0;
+		FDateTime Timestamp;
+		FString Hash;
+	};
+
+	struct FTextureOwner
+	{
+		TWeakObjectPtr<UObject> Object;
+
+		// Shown in the memory report, eg. the material name from the model file
+		FString Name;
+	};
+
+	struct FTextureEntry
+	{
+		TObjectPtr<UTexture> Texture;
+		TArray<FTextureOwner> Owners;
+		int64 Bytes = 0;
+		double LastUsed = 0.0;
+
+		// File the texture was loaded from and where its mips are, used to stream mips in
+		FString FilePath;
+		FTextureFileLayout Layout;
+		uint32 NumFileMips = 0;
+		uint32 NumSkippedMips = 0;
+		uint32 NumStartSkippedMips = 0;
+
+		// Size limit is reached, no more mips to stream in
+		bool bFullyStreamed = false;
+
+		// Loaded by Preload and not acquired yet, never evicted and its miss is already counted
+		bool bPreloaded = false;
+	};
+
+	// Normalized path to the content hash of the file, also read by HashFiles on workers
+	TMap<FString, FPathEntry> Paths;
+	mutable FCriticalSection PathsLock;
+
+	// Content hash to textures
+	TMap<FString, FTextureEntry> Textures;
+
+	FTextureCacheStats Stats;
+
+	// Only one texture streams at a time
+	TObjectPtr<class UDirectDrawSurfaceLoader> StreamingLoader;
+
+	FTSTicker::FDelegateHandle TickerHandle;
+
+	static TUniquePtr<FTextureCache> Instance;
+
+	FTextureCache();
+
+	bool GetHash(const FString& FilePath, FString& OutHash);
+	// Thread safe, OutHash is only set when the file wasn't changed since it was hashed
+	bool IsPathUpToDate(const FString& FilePath, const FFileStatData& StatData, FString& OutHash) const;
+	static FString HashFile(const FString& FilePath, const FFileStatData& StatData);
+
+	// Thread safe
+	static EErrorCode ParseTexture(class UDirectDrawSurfaceLoader* Loader, const FString& FilePath, const FString& Hash, uint32 MaxResolution);
+
+	FTextureEntry& AddEntry(const FString& Hash, const FString& FilePath, const class UDirectDrawSurfaceLoader* Loader);
+	static void AddOwner(FTextureEntry& Entry, UObject* Owner, const FString& OwnerName);
+	static bool IsReferenced(const FTextureEntry& Entry);
+
+	// Top mip size textures get loaded with, 0 when streaming is disabled
+	static uint32 GetStartResolution();
+
+	bool TickStreaming(float DeltaTime);
+	void StreamTexture(const FString& Hash, const FTextureEntry& Entry);
+	void FinishStreaming(const FString& Hash, EErrorCode ErrorCode);
+	void DropMips(FTextureEntry& Entry);
+
+public:
+	virtual ~FTextureCache();
+
+	// Called by the module on startup and shutdown
+	static void Startup();
+	static void Shutdown();
+
+	// Only valid between Startup and Shutdown
+	static FTextureCache& Get();
+	static bool IsAvailable() { return Instance.IsValid(); }
+
+	static FString NormalizePath(const FString& FilePath);
+
+	// "<Category>/<Mod>" for files inside the mods directory, the folder of the file otherwise
+	static FString GetModName(const FString& FilePath);
+
+	// Returns the first slice of the texture and keeps it alive for the owner, nullptr when the texture can't be loaded.
+	// The memory report lists the owner by OwnerName, or by its object name when none is given.
+	UTexture* Acquire(const FString& FilePath, UObject* Owner, const FString& OwnerName = FString());
+
+	// Hashes, reads and parses all files on worker threads, only the textures are created on the game thread.
+	// Newly loaded textures stay until they are acquired or ReleasePreloaded is called. Returns the number of newly loaded textures.
+	int32 Preload(const TArray<FString>& FilePaths);
+
+	// Steps of Preload in order, the async mesh loader runs HashFiles and ParseFiles on a worker.
+	// Thread safe, hashes the files which weren't hashed yet or changed since
+	void HashFiles(const TArray<FString>& FilePaths, FTexturePreload& Preload) const;
+
+	// Game thread, remembers the hashes and creates the loaders of textures which aren't cached yet
+	void BeginParse(FTexturePreload& Preload);
+
+	// Thread safe, reads and parses the missing textures
+	static void ParseFiles(FTexturePreload& Preload);
+
+	// Game thread, creates the parsed textures and releases the loaders. Returns the number of newly loaded textures.
+	int32 FinishPreload(FTexturePreload& Preload);
+
+	// Allows evicting preloaded textures nobody acquired and trims the cache, call once the owners are bound
+	void ReleasePreloaded();
+
+	// Evicts unreferenced textures, least recently used first, until the cache fits into the budget
+	void Trim(int64 BudgetBytes);
+	void Trim();
+
+	const FTextureCacheStats& GetStats() const { return Stats; }
+
+	void LogStats() const;
+	void LogTextures() const;
+
+	FTextureMemoryReport GetMemoryReport() const;
+	void LogMemoryReport() const;
+	bool DumpMemoryReport(const FString& FilePath) const;
+
+	// FGCObject
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override { return TEXT("FTextureCache"); }
+};
@@ -27,7 +27,7 @@ class KARTWORLD_API UTextureLoader : public UObject
 
 protected:
 	TArray<uint8> FileArray;
-	int32 FileSize = 0;
+	int64 FileSize = 0;
 	uint8* FileBuffer;
 	int32 ReadOffset = 0;
 
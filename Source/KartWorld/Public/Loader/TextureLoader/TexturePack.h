@@ -0,0 +1,101 @@
+// Copyright @ 2023 Fynn Haupt
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogTexturePack, Log, All);
+
+struct FTexturePackMip
+{
+	int32 SizeX = 0;
+	int32 SizeY = 0;
+	int32 SizeZ = 0;
+
+	// Absolute offset in the pack file
+	int64 Offset = 0;
+	int64 Size = 0;
+
+	friend FArchive& operator<<(FArchive& Ar, FTexturePackMip& Mip)
+	{
+		Ar << Mip.SizeX << Mip.SizeY << Mip.SizeZ << Mip.Offset << Mip.Size;
+		return Ar;
+	}
+};
+
+struct FTexturePackEntry
+{
+	// Source file relative to the folder of the pack
+	FString Path;
+
+	// Content hash of the source file, same as used by the texture cache
+	FString Hash;
+	int64 SourceSize = 0;
+	FDateTime SourceTimestamp;
+
+	int32 PixelFormat = 0;
+	int32 NumSlices = 1;
+	bool bIsCubeMap = false;
+
+	// Mips of the source file, the pack might hold less when they were capped while baking
+	uint32 NumFileMips = 0;
+
+	// Mips follow each other in the pack, in the layout of FTexturePlatformData
+	TArray<FTexturePackMip> Mips;
+
+	friend FArchive& operator<<(FArchive& Ar, FTexturePackEntry& Entry)
+	{
+		Ar << Entry.Path << Entry.Hash << Entry.SourceSize << Entry.SourceTimestamp;
+		Ar << Entry.PixelFormat << Entry.NumSlices << Entry.bIsCubeMap << Entry.NumFileMips;
+		Ar << Entry.Mips;
+		return Ar;
+	}
+};
+
+/**
+ * Baked textures of a mod (Textures.kwtex) in the root folder of the mod.
+ * Holds the mips of every DDS file below that folder ready for upload, together with an index of formats, mip offsets and content hashes,
+ * so loading a texture is a single seek and read without interpreting the DDS file. DDS files without entry are still loaded directly.
+ */
+class KARTWORLD_API FTexturePack
+{
+private:
+	// "KWTX"
+	static constexpr uint32 Magic = 0x5854574B;
+
+	// Increase whenever the layout of the pack changes
+	static constexpr uint32 Version = 1;
+
+	FString PackPath;
+	int64 PackSize = 0;
+	FDateTime PackTimestamp;
+	FString RootFolder;
+
+	TArray<FTexturePackEntry> Entries;
+	TMap<FString, int32> PathIndex;
+	TMap<FString, int32> HashIndex;
+
+	bool Open(const FString& InPackPath);
+
+	// False once the pack was baked again or deleted
+	bool IsUpToDate() const;
+
+public:
+	static const TCHAR* FileName;
+
+	// Pack of the closest folder above the file, nullptr when there is none
+	static TSharedPtr<FTexturePack, ESPMode::ThreadSafe> FindPack(const FString& FilePath);
+
+	// Bakes all DDS files below the folder into a pack in the folder
+	static bool Bake(const FString& Folder);
+
+	const FTexturePackEntry* FindByPath(const FString& FilePath) const;
+	const FTexturePackEntry* FindByHash(const FString& Hash) const;
+
+	// Reads the mips starting at the first one, every read opens its own handle, thread safe
+	FTexturePlatformData* ReadPlatformData(const FTexturePackEntry& Entry, int32 FirstMip) const;
+
+	int32 Num() const { return Entries.Num(); }
+	const FString& GetPackPath() const { return PackPath; }
+	int64 GetPackSize() const { return PackSize; }
+};
@@ -7,6 +7,7 @@
 #include "Loader/ModLoader/TrackLoader.h"
 #include "Loader/ModLoader/ChassiLoader.h"
 #include "Loader/ModLoader/TireLoader.h"
+#include "Loader/ModLoader/ModCatalog.h"
 #include "MainGameInstance.generated.h"
 
 /**
@@ -33,5 +34,9 @@ public:
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
 	UTireLoader* TireLoader = NewObject<UTireLoader>();
 
+	// Installed mods for menus, filled in the background after Init
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	UModCatalog* ModCatalog = NewObject<UModCatalog>();
+
 	virtual void Init() override;
 };
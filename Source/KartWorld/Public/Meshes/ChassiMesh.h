@@ -27,6 +27,10 @@ private:
 	UPROPERTY()
 	FTireModel TireModel;
 
+	// One mesh per unique tire model
+	UPROPERTY()
+	TArray<URealtimeMeshSimple*> TireMeshes;
+
 public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	FString ChassiName;
@@ -50,5 +54,6 @@ protected:
 private:
 	USceneComponent* CreateNode(FNodeData& NodeData);
 	URealtimeMeshComponent* CreateMesh(int32 MeshIndex);
-	URealtimeMeshComponent* CreateTireModel(FModelData& ModelData);
+	void AttachTire(USceneComponent* Node, const FTireCorner& Corner, FRotator Rotation);
+	URealtimeMeshComponent* CreateTireModel(int32 ModelIndex);
 };
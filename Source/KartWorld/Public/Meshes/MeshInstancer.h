@@ -0,0 +1,57 @@
+// Copyright @ 2023 Fynn Haupt
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Loader/MeshLoader.h"
+#include "MeshInstancer.generated.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogMeshInstancer, Log, All);
+
+class UStaticMesh;
+class UMaterialInterface;
+
+USTRUCT(BlueprintType)
+struct KARTWORLD_API FMeshInstancingReport
+{
+	GENERATED_BODY()
+
+	// Meshes drawn instanced, one per unique geometry
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumInstancedMeshes = 0;
+
+	// Occurrences of those meshes in the model
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int32 NumInstances = 0;
+
+	// Vertex and index data which isn't uploaded once per occurrence anymore, minus the instance transforms
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
+	int64 SavedBytes = 0;
+};
+
+// Geometry in its own frame together with the transforms of all of its occurrences
+struct KARTWORLD_API FInstancedMesh
+{
+	FMeshData MeshData;
+	TArray<FTransform> Transforms;
+};
+
+/**
+ * Finds world space meshes which are the same geometry placed with a different rotation and translation, e.g. cones or fence posts.
+ * Meshes are bucketed by a hash of everything a rigid transform doesn't change and compared vertex by vertex,
+ * positions, normals and tangents in the frame of the occurrence and colors and all uv channels as they are.
+ */
+class KARTWORLD_API FMeshInstancer
+{
+public:
+	// Moves lod 0 meshes which occur at least MinInstances times out of Meshes, the other meshes keep their order
+	static TArray<FInstancedMesh> ExtractInstances(TArray<FMeshData>& Meshes, int32 MinInstances, FMeshInstancingReport& Report);
+
+	// Static mesh for an instanced static mesh component, using its triangles as collision
+	static UStaticMesh* BuildStaticMesh(UObject* Outer, const FMeshData& MeshData, UMaterialInterface* Material);
+
+private:
+	// Frame spanned by the first vertex and two further vertices, false when all vertices are on a line
+	static bool GetTransform(const FMeshData& MeshData, FTransform& Transform);
+	static uint32 GetGeometryHash(const FMeshData& MeshData);
+};
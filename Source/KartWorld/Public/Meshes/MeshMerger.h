@@ -0,0 +1,22 @@
+// Copyright @ 2023 Fynn Haupt
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Loader/MeshLoader.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogMeshMerger, Log, All);
+
+/**
+ * Concatenates static meshes that share material and lod, so they are drawn as one section.
+ * Only meant for world space meshes, the node transforms of relative meshes would get lost.
+ */
+class KARTWORLD_API FMeshMerger
+{
+public:
+	// Groups the meshes by material id and lod, groups keep the order of their first mesh
+	static TArray<FMeshData> MergeByMaterialAndLod(const TArray<FMeshData>& Meshes);
+
+	// Appends all meshes into one, channels missing in some of the meshes are filled with defaults
+	static void Merge(TConstArrayView<const FMeshData*> Meshes, FMeshData& MergedMesh);
+};
@@ -0,0 +1,36 @@
+// Copyright @ 2023 Fynn Haupt
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RealtimeMeshSimple.h"
+#include "Loader/MeshLoader.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogMeshStreamBuilder, Log, All);
+
+/**
+ * Fills the RealtimeMesh streams of a section group straight from the mesh data streams.
+ * The streams are presized once and copied in bulk instead of adding vertex by vertex.
+ */
+class KARTWORLD_API FMeshStreamBuilder
+{
+public:
+	// Layout matches TRealtimeMeshBuilderLocal<IndexType, FPackedNormal, FVector2DHalf, 1>
+	typedef TRealtimeMeshTangents<FPackedNormal> FTangentType;
+	typedef TRealtimeMeshTexCoords<FVector2DHalf, 1> FTexCoordType;
+
+	// 16 bit indices can address at most this many vertices
+	static constexpr int32 MaxVerticesFor16BitIndices = MAX_uint16 + 1;
+
+	static bool NeedsWideIndices(const FMeshData& MeshData) { return MeshData.NumVertices() > MaxVerticesFor16BitIndices; }
+
+	// Size of the streams Build creates for the mesh
+	static int64 GetStreamSize(const FMeshData& MeshData);
+
+	// Picks 16 bit indices when they can address every vertex and 32 bit otherwise, returns true for 32 bit
+	static bool Build(const FMeshData& MeshData, FRealtimeMeshStreamSet& StreamSet);
+
+	// Supported index types are uint16 and uint32
+	template <typename IndexType>
+	static void Build(const FMeshData& MeshData, FRealtimeMeshStreamSet& StreamSet);
+};
@@ -7,10 +7,53 @@
 #include "RealtimeMeshComponent.h"
 #include "RealtimeMeshSimple.h"
 #include "MainGameInstance.h"
+#include "Meshes/MeshInstancer.h"
 #include "TrackMesh.generated.h"
 
 DECLARE_LOG_CATEGORY_EXTERN(LogTrackMesh, Log, All);
 
+class ATrackMesh;
+class UInstancedStaticMeshComponent;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnTrackMeshLoaded, ATrackMesh*, TrackMesh);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnTrackMeshProgress, float, Progress);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnTrackMeshLoadFailed, ATrackMesh*, TrackMesh, TEnumAsByte<EMeshLoadingResult>, Result);
+
+UENUM()
+enum ETrackChunkState
+{
+	ETrackChunkState_UNLOADED = 0,
+	ETrackChunkState_LOADING,
+	ETrackChunkState_LOADED
+};
+
+/**
+ * Grid cell of a streamed track with its own mesh component, section groups and collision.
+ */
+USTRUCT()
+struct KARTWORLD_API FTrackChunk
+{
+	GENERATED_BODY()
+
+	FIntPoint Cell = FIntPoint::ZeroValue;
+
+	FBox Bounds = FBox(ForceInit);
+
+	// Size of the uploaded streams
+	int64 Bytes = 0;
+
+	ETrackChunkState State = ETrackChunkState_UNLOADED;
+
+	// Increased on every load and unload, so the result of an outdated load gets dropped
+	uint32 LoadSerial = 0;
+
+	UPROPERTY()
+	URealtimeMeshComponent* Component = nullptr;
+
+	// Shared with the worker building the streams
+	TSharedPtr<const TArray<FMeshData>, ESPMode::ThreadSafe> Meshes;
+};
+
 UCLASS()
 class KARTWORLD_API ATrackMesh : public AActor
 {
@@ -26,6 +69,22 @@ private:
 	UPROPERTY()
 	FTrackModel TrackModel;
 
+	FMeshLoadHandlePtr LoadHandle;
+
+	UPROPERTY()
+	TArray<FTrackChunk> Chunks;
+
+	// Repeated props, one component per unique geometry
+	UPROPERTY()
+	TArray<UInstancedStaticMeshComponent*> InstanceComponents;
+
+	UPROPERTY()
+	FMeshInstancingReport InstancingReport;
+
+	int32 NumResidentChunks = 0;
+	int64 ResidentBytes = 0;
+	int32 NumLoadingChunks = 0;
+
 public:
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere)
 	URealtimeMeshComponent* MeshComponent;
@@ -33,12 +92,72 @@ public:
 	UPROPERTY(BlueprintReadWrite, EditAnywhere)
 	FString TrackName;
 
+	// Splits the track into a grid of chunks, only the chunks near the karts are uploaded
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Streaming")
+	bool bStreamChunks = false;
+
+	// Edge length of a chunk in cm
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Streaming")
+	float ChunkSize = 20000.0f;
+
+	// Chunks closer than this to a kart get loaded
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Streaming")
+	float StreamingRadius = 40000.0f;
+
+	// Loaded chunks are kept until they are further away than the streaming radius times this factor
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Streaming")
+	float UnloadRadiusScale = 1.25f;
+
+	// Maximum size of all resident chunks, the furthest chunks get unloaded first
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Streaming")
+	int32 ResidencyBudgetMB = 512;
+
+	// Chunks built at the same time, at least one
+	UPROPERTY(BlueprintReadWrite, EditAnywhere, Category = "Streaming", meta = (ClampMin = 1))
+	int32 MaxConcurrentLoads = 2;
+
 	// Sets default values for this actor's properties
 	ATrackMesh();
 
+	virtual void Tick(float DeltaSeconds) override;
+
+	// Called when the track was loaded, e.g. to hide the loading screen
+	UPROPERTY(BlueprintAssignable)
+	FOnTrackMeshLoaded OnLoaded;
+
+	// Called while the track is loading in background
+	UPROPERTY(BlueprintAssignable)
+	FOnTrackMeshProgress OnProgress;
+
+	// Called instead of OnLoaded when the track can't be loaded, not after CancelLoad
+	UPROPERTY(BlueprintAssignable)
+	FOnTrackMeshLoadFailed OnLoadFailed;
+
 	UFUNCTION(BlueprintCallable)
 	void LoadMesh();
 
+	// Loads the track in background, OnLoaded or OnLoadFailed gets called when finished
+	UFUNCTION(BlueprintCallable)
+	void LoadMeshAsync();
+
+	UFUNCTION(BlueprintCallable)
+	void CancelLoad();
+
+	UFUNCTION(BlueprintCallable)
+	bool IsLoading() const;
+
+	UFUNCTION(BlueprintCallable)
+	int32 GetNumChunks() const { return Chunks.Num(); }
+
+	UFUNCTION(BlueprintCallable)
+	int32 GetNumResidentChunks() const { return NumResidentChunks; }
+
+	UFUNCTION(BlueprintCallable)
+	int64 GetResidentBytes() const { return ResidentBytes; }
+
+	UFUNCTION(BlueprintCallable)
+	FMeshInstancingReport GetInstancingReport() const { return InstancingReport; }
+
 	UFUNCTION(BlueprintCallable)
 	inline FTrackConfiguration GetConfiguration() const { return TrackModel.Configuration; }
 
@@ -46,7 +165,25 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 private:
+	void BuildMesh();
+	void FailLoad(EMeshLoadingResult Result);
 	USceneComponent* CreateNode(FNodeData& NodeData);
-	URealtimeMeshComponent* CreateMesh(int32 MeshIndex);
+	URealtimeMeshComponent* CreateMesh(const FMeshData& MeshData);
+	static int32 GetNumDrawCalls(const TArray<FMeshData>& Meshes);
+
+	// Instancing
+	void BuildInstances();
+	void DestroyInstances();
+
+	// Chunk streaming
+	void BuildChunks();
+	void UpdateChunks();
+	void LoadChunk(int32 ChunkIndex);
+	void FinishChunkLoad(int32 ChunkIndex, uint32 LoadSerial, TArray<FRealtimeMeshStreamSet>&& StreamSets);
+	void UnloadChunk(int32 ChunkIndex);
+	void UnloadAllChunks();
+	void GetViewerLocations(TArray<FVector>& Locations) const;
 };